@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Messages.h"
+
+/**
+ * @brief Pure aggregation accumulator (atomic update + emit).
+ */
+class AggregateAccumulator {
+public:
+  void reset(uint32_t startMs);
+  void add(const SensorSampleMsg& s);
+  /** @brief t0/t1 are the first/last sample times; false if no samples. */
+  bool emit(AggregateMsg& out, bool partial = false) const;
+
+  uint32_t count() const { return _n; }
+
+  /** @brief SessionClock session of the samples held (valid if count() > 0). */
+  uint32_t session() const { return _session; }
+
+  /** @brief True if s may join: the window is empty or holds the same session. */
+  bool accepts(const SensorSampleMsg& s) const { return _n == 0 || s.session == _session; }
+
+private:
+  uint32_t _t0 = 0;
+  uint32_t _t1 = 0;
+  uint32_t _n  = 0;
+  bool     _ok = true;
+  uint32_t _session = 0;
+
+  char  _k0[8] = {0};
+  char  _k1[8] = {0};
+
+  float _v0_min = 0;
+  float _v0_max = 0;
+  float _v0_sum = 0;
+
+  float _v1_min = 0;
+  float _v1_max = 0;
+  float _v1_sum = 0;
+};
+
+/**
+ * @brief Turns the sample stream into aggregates that never mix sessions.
+ *
+ * The aggregator thread decides when a window closes (period end, flush at
+ * a stop); this decides what goes into it. A sample of another session
+ * closes the open window first, and every aggregate carries the id of the
+ * session its samples were timed against, also when it is emitted after a
+ * new session has started (a sample that was in flight during the stop
+ * flush). The ids of the current and the previous session are kept.
+ *
+ * Pure logic with no RTOS/board dependency.
+ */
+class AggregateAssembler {
+public:
+  AggregateAssembler() { _acc.reset(0); }
+
+  /** @brief Record the id of session (the caller reads both from SessionClock together). */
+  void noteSession(uint32_t session, const char* serverId);
+
+  /**
+   * @brief Add a sample to the open window.
+   * @param closed receives the window s closed (partial), if any
+   * @return true if closed was filled
+   */
+  bool add(const SensorSampleMsg& s, AggregateMsg& closed);
+
+  /**
+   * @brief Close the open window.
+   * @return false if it held no samples (out untouched)
+   */
+  bool close(bool partial, AggregateMsg& out);
+
+  /** @brief Samples in the open window. */
+  uint32_t pending() const { return _acc.count(); }
+
+private:
+  struct Tag {
+    bool     known = false;
+    uint32_t session = 0;
+    char     id[sizeof(AggregateMsg::sessionId)] = {0};
+  };
+
+  AggregateAccumulator _acc;
+  Tag                  _cur;
+  Tag                  _prev;
+
+  void stamp(AggregateMsg& out) const;
+};
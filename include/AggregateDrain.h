@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Messages.h"
+
+/**
+ * @brief Decides which queued aggregates go out in one comms pump pass.
+ *
+ * Aggregates leave only over a live link, at most maxPerPass per pass. One
+ * whose publish fails is held (its mail slot stays allocated) and is the
+ * first one tried on the next pass, so a stalled socket or a full client
+ * buffer delays data instead of dropping it.
+ *
+ * Pure logic with no RTOS/GSM dependency: the queue, the link state and the
+ * publish itself come through Port (CommsPump on the device, a fake modem in
+ * the host test).
+ */
+class AggregateDrain {
+public:
+  class Port {
+  public:
+    virtual ~Port() = default;
+
+    /** @brief Next queued aggregate, nullptr if none. */
+    virtual AggregateMsg* take() = 0;
+
+    /** @brief Return a published aggregate's slot. */
+    virtual void release(AggregateMsg* a) = 0;
+
+    virtual bool linkUp() = 0;
+
+    /** @brief Send a; false leaves it with the drain for the next pass. */
+    virtual bool publish(const AggregateMsg& a) = 0;
+  };
+
+  /** @return aggregates published in this pass */
+  uint8_t run(Port& port, uint8_t maxPerPass);
+
+  /** @brief True while a failed aggregate waits for the next pass. */
+  bool holding() const { return _held != nullptr; }
+
+private:
+  AggregateMsg* _held = nullptr;
+};
@@ -3,46 +3,19 @@
 #include <mbed.h>
 #include <atomic>
 
+#include "AggregateAccumulator.h"
 #include "AppConfig.h"
 #include "Messages.h"
 #include "SettingsManager.h"
 #include "SessionClock.h"
-#include "EventBus.h"
 #include "CommsEgress.h"
+#include "RuntimeStatus.h"
+#include "StopUtil.h"
 
 template <uint32_t DEPTH>
 using AggInMail = rtos::Mail<SensorSampleMsg, DEPTH>;
 
 
-/**
- * @brief Pure aggregation accumulator (atomic update + emit).
- */
-class AggregateAccumulator {
-public:
-  void reset(uint32_t startMs);
-  void add(const SensorSampleMsg& s);
-  bool emit(AggregateMsg& out) const;
-
-private:
-  static void threadEntry(void* ctx);
-
-  uint32_t _t0 = 0;
-  uint32_t _t1 = 0;
-  uint32_t _n  = 0;
-  bool     _ok = true;
-
-  char  _k0[8] = {0};
-  char  _k1[8] = {0};
-
-  float _v0_min = 0;
-  float _v0_max = 0;
-  float _v0_sum = 0;
-
-  float _v1_min = 0;
-  float _v1_max = 0;
-  float _v1_sum = 0;
-};
-
 /**
  * @brief Aggregation thread: consumes samples and emits aggregated packets.
  */
@@ -52,16 +25,23 @@ public:
                    CommsEgress& commsEgress,
                    SettingsManager& settings,
                    SessionClock& clock,
-                   EventBus& eventBus);
+                   RuntimeStatus& runtimeStatus);
 
   /**
    * @brief Start RTOS thread.
    */
   void start();
+
+  /** @brief Close the running window (partial aggregates are emitted) and let the thread exit. */
   void stop();
 
   /**
    * @brief Enable or disable aggregation.
+   *
+   * Disabling flushes the running window: samples already queued are added
+   * and it is emitted marked partial, even if aggregation is re-enabled
+   * before the thread gets to it. A sample still in flight arrives later and
+   * is emitted on its own, with its own session's id.
    */
   void setEnabled(bool en);
 
@@ -72,21 +52,36 @@ public:
 
 private:
   static void threadEntry(void* ctx);
+  static void wakeEntry(void* ctx);
 
   AggInMail<QUEUE_DEPTH_SENSOR_TO_AGG>& _inMail;
   CommsEgress&                          _commsEgress;
   SettingsManager&                        _settings;
   SessionClock&                         _clock;
-  EventBus&                             _eventBus;
+  RuntimeStatus&                        _runtimeStatus;
 
   rtos::Thread     _thread;
   rtos::EventFlags _flags;
+  stoputil::StopSignal _stop;
 
-  static constexpr uint32_t FLAG_WAKE  = 1u << 0;
   static constexpr uint32_t FLAG_RESET = 1u << 1;
+  static constexpr uint32_t FLAG_FLUSH = 1u << 2;
 
   std::atomic<bool> _enabled{false};
 
-  AggregateAccumulator _acc;
+  SettingsSubscription _settingsSub;  // Schedule group: agg_period_s
+  uint32_t             _windowMs = 0;
+  uint16_t             _windowStretch = 0;  // power stretch _windowMs was scaled with
+
+  AggregateAssembler _windows;
+
   void run();
+  void wake();
+  void refreshWindow();
+  void noteSession();
+  bool takeNext(rtos::Kernel::Clock::duration_u32 timeout);
+  void take(const SensorSampleMsg& s);
+  void drain();
+  void closeWindow(bool partial);
+  void publish(const AggregateMsg& out);
 };
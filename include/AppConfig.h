@@ -29,6 +29,7 @@ static constexpr osPriority PRIO_COMMS = osPriorityAboveNormal;
 static constexpr osPriority PRIO_AGG   = osPriorityNormal;
 static constexpr osPriority PRIO_SENS  = osPriorityNormal;
 static constexpr osPriority PRIO_UI    = osPriorityLow;
+static constexpr osPriority PRIO_LOG   = osPriorityLow;
 
 // ---------------- Thread stacks ----------------
 static constexpr uint32_t STACK_ORCH  = 6 * 1024;
@@ -36,6 +37,7 @@ static constexpr uint32_t STACK_COMMS = 14 * 1024;
 static constexpr uint32_t STACK_AGG   = 6 * 1024;
 static constexpr uint32_t STACK_SENS  = 14 * 1024;
 static constexpr uint32_t STACK_UI    = 6 * 1024;
+static constexpr uint32_t STACK_LOG   = 3 * 1024;
 
 // ---------------- Mail queue depths ----------------
 static constexpr uint32_t QUEUE_DEPTH_SENSOR_TO_AGG = 32;
@@ -43,18 +45,106 @@ static constexpr uint32_t QUEUE_DEPTH_AGG_TO_COMMS  = 16;
 
 static constexpr uint32_t QUEUE_DEPTH_UI_TO_ORCH      = 16;
 static constexpr uint32_t QUEUE_DEPTH_COMMS_TO_ORCH   = 16;
-static constexpr uint32_t QUEUE_DEPTH_WORKER_TO_ORCH  = 8;
 static constexpr uint32_t QUEUE_DEPTH_ORCH_TO_COMMS   = 16;
 
+// ---------------- Payload pool (size classes) ----------------
+// Variable-length text carried by UI/comms/orchestrator mail lives here and
+// is referenced by handle. Most events are short ("up", "mqtt", "key"); only
+// server commands and JSON status blobs need a large slot.
+static constexpr uint32_t PAYLOAD_SMALL_BYTES  = 32;
+static constexpr uint32_t PAYLOAD_SMALL_COUNT  = 32;
+static constexpr uint32_t PAYLOAD_MEDIUM_BYTES = 128;
+static constexpr uint32_t PAYLOAD_MEDIUM_COUNT = 8;
+static constexpr uint32_t PAYLOAD_LARGE_BYTES  = 384;
+static constexpr uint32_t PAYLOAD_LARGE_COUNT  = 6;
+
+// ---------------- Log ring ----------------
+// Producers append binary records (format pointer + raw args); the LOG thread
+// formats and prints them. Must be a power of two. Overflow drops records.
+static constexpr uint32_t LOG_RING_SLOTS = 64;
+
+// ---------------- Crash log ----------------
+// Printed lines are also kept in a reset-surviving RAM ring (CrashLog). After
+// a crash the newest CRASHLOG_EXCERPT_BYTES are deflated and published once to
+// /log. Each hibernate stores the same excerpt in a two-sector flash journal,
+// for crashes that also wipe RAM (brown-out in standby).
+static constexpr uint32_t CRASHLOG_RAM_BYTES        = 8192; // power of two
+static constexpr uint32_t CRASHLOG_EXCERPT_BYTES    = 4096;
+static constexpr uint32_t CRASHLOG_UPLOAD_MAX_BYTES = 2048; // compressed
+static constexpr uint8_t  CRASHLOG_UPLOAD_TRIES     = 3;
+
 // ---------------- MQTT topics ----------------
 static constexpr const char* MQTT_TOPIC_PREFIX = "hastigNode";
 static constexpr const char* MQTT_TOPIC_POSTFIX_CMD = "cmd";
 static constexpr const char* MQTT_TOPIC_POSTFIX_CFG = "cfg";
+// Outbound binary (MessagePack) config snapshots, see getConfig "format".
+static constexpr const char* MQTT_TOPIC_POSTFIX_CONFIG = "config";
+// Outbound post-mortem log excerpts (binary, see CrashLog.h).
+static constexpr const char* MQTT_TOPIC_POSTFIX_LOG = "log";
+// Outbound runtime metrics snapshots (see Metrics.h).
+static constexpr const char* MQTT_TOPIC_POSTFIX_METRICS = "metrics";
 static constexpr uint32_t MIN_SAMPLE_PERIOD_MS = 200;
 
-// Grace time after publishing final status before hibernate.
+// Boot: wait at most this long for a USB serial monitor (only when USB-powered).
+static constexpr uint32_t BOOT_SERIAL_WAIT_MS = 2500UL;
+
+// Keep the sensor powered this long after sampling stops, so a stop/start
+// (e.g. startSampling with new parameters) skips the warmup.
+static constexpr uint32_t SENSOR_IDLE_HOLD_MS = 30000UL;
+
+// Energy ledger: integrate the fuel gauge's average current this often.
+static constexpr uint32_t ENERGY_SAMPLE_MS = 5000UL;
+
+// Metrics snapshot on /metrics: this often while awake, plus once before hibernate.
+static constexpr uint32_t METRICS_PUBLISH_INTERVAL_S = 900UL;
+
+// Thread profiler (ThreadProfiler.h): CPU share window and stack watermark reads.
+static constexpr uint32_t THREAD_PROFILE_WINDOW_MS = 60000UL;
+
+// Battery policy (PowerPolicy): how often state of charge is re-evaluated.
+static constexpr uint32_t POWER_POLICY_PERIOD_MS = 60000UL;
+
+// Hibernate: how long a thread may take to flush and acknowledge a stop
+// before it is terminated.
+static constexpr uint32_t THREAD_STOP_ACK_MS = 1500UL;
+
+// ---------------- Idle ----------------
+// Threads block on events and deadlines; these cap how long a thread waits
+// without one, so seconds-level timers stay roughly on time. With the
+// lowPowerIdle setting (on by default) the M7 enters Stop mode while all
+// threads wait (on battery only; see WakeLock.h for what keeps it awake).
+static constexpr uint32_t ORCH_IDLE_MAX_MS       = 1000UL;
+static constexpr uint32_t COMMS_IDLE_MAX_MS      = 1000UL;
+static constexpr uint32_t COMMS_POLL_MS          = 20UL;   // link active: PubSubClient is polled
+static constexpr uint32_t UI_IDLE_REFRESH_MS     = 1000UL;
+
+// Staged /cfg transactions ("txn":"begin") are rolled back if not committed in time.
+static constexpr uint32_t CFG_TXN_TIMEOUT_MS = 60000UL;
+
+// Upper bound for draining the comms outbox (final status, last aggregates)
+// before hibernate; the drain ends as soon as the outbox is empty.
 static constexpr uint32_t HIBERNATE_STATUS_GRACE_MS = 1500;
 // Comms boot gating
 static constexpr uint32_t HASTIG_COMMS_READY_GRACE_MS = 30000UL;
 static constexpr uint32_t HASTIG_MQTT_CONNECT_TIMEOUT_MS = 120000UL;
 static constexpr uint32_t HASTIG_NO_NETWORK_HIBERNATE_S = 900UL;
+
+// ---------------- Radio duty cycling (CAT-M1 PSM/eDRX) ----------------
+// Aggregates and periodic status are held until a shared wake window opens.
+// The window period is the status interval, shortened so the agg->comms mail
+// never fills up between windows.
+static constexpr bool     RADIO_DUTY_CYCLE_ENABLED = true;
+static constexpr uint32_t RADIO_WAKE_WINDOW_MS     = 10000UL;
+static constexpr uint16_t MQTT_MIN_KEEPALIVE_S     = 30;
+// Connect with cleanSession=false and QoS 1 subscriptions so the broker keeps
+// subscriptions and queues commands across reconnects and PSM sleep.
+static constexpr bool     MQTT_PERSISTENT_SESSION  = true;
+// Requested PSM timers (T3412 periodic TAU, T3324 active time).
+static constexpr uint32_t RADIO_PSM_TAU_S    = 3600UL;
+static constexpr uint32_t RADIO_PSM_ACTIVE_S = 10UL;
+// eDRX for LTE-M (AcT 4), 4-bit cycle code per 3GPP TS 27.007 (0101 = 81.92 s).
+static constexpr const char* RADIO_EDRX_CYCLE = "0101";
+
+// Periodic status rides on the next /data publish if one is due within this
+// tolerance of the status being queued; otherwise it is sent standalone.
+static constexpr uint32_t STATUS_COALESCE_TOLERANCE_MS = 30000UL;
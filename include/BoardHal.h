@@ -35,6 +35,7 @@ public:
     float minimumVoltage = 0.0f;
     float current        = 0.0f;
     float averageCurrent = 0.0f;
+    float remainingMah   = 0.0f;  ///< fuel-gauge estimate
   };
 
   /** Configure all GPIO directions and default states early in setup(). */
@@ -56,6 +57,8 @@ public:
 
   /**
    * Detect factory reset combo at boot (hold UP+DOWN for holdMs).
+   * Returns at once if neither button is down on entry, so normal boots
+   * do not pay for the window.
    * @return true if combo held for holdMs within windowMs.
    */
   static bool detectFactoryResetButtonCombo(uint32_t windowMs = 3500u, uint32_t holdMs = 3000u);
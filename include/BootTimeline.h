@@ -0,0 +1,35 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Boot timeline: kernel-uptime timestamps for each startup stage.
+ *
+ * Stages are recorded from setup() and, for the network milestones, from
+ * the comms pump. The table is printed once at the end of setup() and sent
+ * once with the first "aware" status. Both run in the Arduino main context
+ * (setup/loop), so there is no locking. Stage names must be string literals
+ * (only the pointer is stored).
+ */
+namespace boottimeline {
+
+static constexpr size_t kMaxStages = 16;
+
+/** @brief Record stage at the current uptime (ignored when the table is full). */
+void mark(const char* stage);
+
+/** @brief Record stage only if it was not recorded before (e.g. first network attach). */
+void markOnce(const char* stage);
+
+/** @brief Number of recorded stages. */
+size_t count();
+
+/** @brief Log every stage with its absolute time and the delta to the previous one. */
+void log();
+
+/** @brief Add {"<stage>": ms, ...} under key to doc. */
+void addToJson(JsonDocument& doc, const char* key);
+
+} // namespace boottimeline
@@ -2,6 +2,8 @@
 
 #include <stdint.h>
 
+#include "PayloadPool.h"
+
 /**
  * @brief Commands from orchestrator-facing code to the comms subsystem.
  *
@@ -12,12 +14,16 @@
 enum class OrchCommandType : uint8_t {
   PublishAwake,
   PublishHibernating,
+  PublishStatus,  // periodic battery status; may be deferred to the next radio wake window
   ApplySettingsJson,
   PublishConfig,
 };
 
+/**
+ * payload lives in the payload pool; CommsInbox::freeOrch() releases it.
+ */
 struct OrchCommandMsg {
   OrchCommandType type;
   uint32_t        ts_ms;
-  char            payload[256];
+  PayloadRef      payload;
 };
@@ -20,13 +20,23 @@ public:
 
   bool sendAggregate(const AggregateMsg& msg);
 
+  /** @brief True while aggregates are still queued for the comms pump. */
+  bool aggregatesPending() const { return !_aggToCommsMail.empty(); }
+
   // Higher-level helpers: keep callers decoupled from OrchCommandType.
   bool publishAwake();
   bool publishAwakeJson(const char* json);
   bool publishModeChange(const char* mode, const char* previousMode);
-  bool publishStatus(const BoardHal::BatterySnapshot& bs, const char* mode);
+  /** @brief Periodic status; powerStretch (permille) is reported when not nominal. */
+  bool publishStatus(const BoardHal::BatterySnapshot& bs, const char* mode, uint16_t powerStretch = 1000);
   bool publishLowBatteryAlert(const BoardHal::BatterySnapshot& bs, const char* mode);
-  bool publishConfig();
+  /**
+   * @brief Request a config snapshot (JSON or MessagePack).
+   *
+   * If hasDigest and digest matches the current config, only a configDigest
+   * reply is published.
+   */
+  bool publishConfig(bool binary = false, bool hasDigest = false, uint32_t digest = 0);
   bool applySettingsJson(const char* json);
 
   // Hibernate-related helpers.
@@ -22,9 +22,13 @@ public:
   CommsInbox(AggMailT& aggToCommsMail, OrchToCommsMailT& orchToCommsMail);
 
   OrchCommandMsg* tryGetOrch();
+  bool            orchEmpty() const;
+  // Releases the pooled payload and returns the message to the mailbox.
   void            freeOrch(OrchCommandMsg* msg);
 
   AggregateMsg* tryGetAggregate();
+  bool          aggregatesFull() const;
+  bool          aggregatesEmpty() const;
   void          freeAggregate(AggregateMsg* msg);
 
 private:
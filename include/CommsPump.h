@@ -4,12 +4,15 @@
 
 #include <mbed.h>
 
+#include "AggregateDrain.h"
 #include "AppConfig.h"
 #include "CommsInbox.h"
 #include "CommsCommands.h"
 #include "Messages.h"
 #include "SettingsManager.h"
 #include "EventBus.h"
+#include "ProtocolCodec.h"
+#include "RadioDutyCycle.h"
 
 template <uint32_t DEPTH>
 using AggMail = rtos::Mail<AggregateMsg, DEPTH>;
@@ -27,7 +30,7 @@ using OrchToCommsMail = rtos::Mail<OrchCommandMsg, DEPTH>;
  *
  * This class owns comms processing and is executed by main loop() via loopOnce().
  */
-class CommsPump {
+class CommsPump : private AggregateDrain::Port {
 public:
   CommsPump(CommsInbox& inbox,
             EventBus& eventBus,
@@ -38,6 +41,22 @@ public:
    */
   void begin();
 
+  /**
+   * @brief Bring the cellular link up now (call from setup() after starting threads).
+   * @return true if the network is attached.
+   */
+  bool attachNetwork();
+
+  /**
+   * @brief Keep the radio off for durationMs (scheduled session after a warm wake).
+   *
+   * loopOnce() leaves commands and aggregates queued until the hold ends.
+   */
+  void holdOffline(uint32_t durationMs);
+
+  /** @brief Reported once, with the boot timeline, in the first aware status. */
+  void setRestartReason(const char* reason) { _restartReason = reason; }
+
   /**
    * @brief One iteration of comms processing (call frequently from loop()).
    */
@@ -46,6 +65,9 @@ public:
   /** @brief True if MQTT is connected. */
   bool is_mqtt_connected() const { return _mqttConnected; }
 
+  /** @brief Time from the last (re)connect attempt to its first successful publish. */
+  uint32_t lastReconnectToPublishMs() const { return _lastReconnectToPublishMs; }
+
   /** @brief Milliseconds since begin(). */
   uint32_t uptimeMs() const;
 
@@ -54,12 +76,26 @@ public:
   void shutdownForHibernate();
 
   /**
-   * @brief Prepare for hibernate: stop new connect attempts and tear down links non-blocking.
+   * @brief Prepare for hibernate: no new connect attempts and no inbound processing.
    *
+   * An established link stays up so loopOnce() can drain the outbox
+   * (wake windows are ignored); shutdownForHibernate() tears it down.
    * This is safe to call multiple times.
    */
   void prepareHibernate();
 
+  /** @brief True once nothing is left queued for publishing (link up or not). */
+  bool outboxDrained() const;
+
+  /**
+   * @brief How long the main loop may sleep before the next loopOnce().
+   *
+   * COMMS_POLL_MS while a wake window is open (inbound MQTT is polled);
+   * otherwise until the window or the offline hold ends, capped at
+   * COMMS_IDLE_MAX_MS.
+   */
+  uint32_t idleWaitMs() const;
+
 private:
   CommsInbox&       _inbox;
   EventBus&         _eventBus;
@@ -67,6 +103,18 @@ private:
 
   bool _wantConnected = true;
   bool _hibernatePending = false;
+  bool _modemAwake       = false;  // holds wakelock::Holder::Modem
+  bool     _offline        = false;
+  uint32_t _offlineUntilMs = 0;
+  bool     _uploadAfterHold = false; ///< keep the radio up until the held data is out
+
+  // Orchestrator publishes that need the radio, parked (latest-wins) during the offline hold.
+  struct HeldCommand {
+    bool           valid = false;
+    OrchCommandMsg msg   = {};
+  };
+  HeldCommand _heldMode   = {};  // PublishAwake / PublishHibernating
+  HeldCommand _heldConfig = {};  // PublishConfig
 
   bool     _netConnected  = false;
   bool     _mqttConnected = false;
@@ -79,27 +127,83 @@ private:
 
   uint32_t _bootMs = 0;
 
+  RadioDutyCycle _duty;
+  AggregateDrain _drain;
+  SettingsSubscription _dutySub;  // Schedule group: status/agg periods
+  bool           _dutyConfigured = false;
+  bool           _bootTimelineSent = false;
+  bool           _psmConfigured = false;
+  PayloadRef     _pendingStatus = {};
+  uint32_t       _pendingStatusMs   = 0;
+  uint32_t       _lastDataPublishMs = 0;
+  uint32_t       _dataIntervalMs    = 0;
+
+  // Boot report and reconnect timing.
+  const char* _restartReason         = nullptr;
+  uint32_t _reconnectStartMs         = 0;
+  uint32_t _lastReconnectToPublishMs = 0;
+  bool     _awaitFirstPublish        = false;
+
+  // Links to re-establish after a committed settings change.
+  enum class Relink : uint8_t { None = 0, Mqtt, Network };
+  Relink _relink             = Relink::None;
+  bool   _topicsCheckPending = false;
+
+  char _hwId[32]        = {0};
+  char _topicNode[48]   = {0};
   char _topicCmd[96]    = {0};
   char _topicCfg[96]    = {0};
   char _topicData[96]   = {0};
   char _topicStatus[96] = {0};
+  char _topicConfig[96] = {0};
+  char _topicLog[96]    = {0};
+  char _topicMetrics[96] = {0};
+
+  uint32_t _lastMetricsMs  = 0;
+  bool     _metricsOnSleep = false; ///< final snapshot still owed before hibernate
 
   void postEvent(CommsEventType type, const char* topic, const char* payload);
+  void postCommand(const char* topic, const protocol::Command& cmd);
 
-  void handleOrchCommand(const OrchCommandMsg& cmd);
+  void handleOrchCommand(OrchCommandMsg& cmd);
+  void deferOrchCommand(OrchCommandMsg& cmd);
+  static void holdCommand(HeldCommand& slot, OrchCommandMsg& cmd);
+  void replayHeldCommands();
+
+  void requestRelink(uint8_t changedSections);
+  void applyPendingRelink();
+
+  void updateDutyCycle();
+  void configureRadioPowerSave();
+  bool windowOpen(uint32_t nowMs) const;
+  void setModemAwake(bool awake);
 
   bool ensureNetwork();
   bool ensureMqtt();
 
+  bool     refreshTopics(const AppSettings& s);
+  bool     subscribeTopics(const char* when);
+
   void teardownLinks(bool endGsm);
 
-  bool publishStatus(const char* mode, const char* extraJsonKVsOrNull);
-  bool publishConfigSnapshot();
+  bool publishStatus(const char* mode, const char* extraJsonKVsOrNull, bool withConfigDigest = false);
+  bool publishConfigSnapshot(const char* optionsJsonOrNull);
+  bool publishConfigDigest(uint32_t digest, bool unchanged);
   bool publishConfigChunk(uint8_t chunk, uint8_t total, const char* section,
                           SettingsManager::ConfigSection configSection);
-  bool publishAggregate(const AggregateMsg& a);
+  bool publishAggregate(const AggregateMsg& a, const char* statusJsonOrNull, bool* statusSentOrNull);
+
+  // AggregateDrain::Port
+  AggregateMsg* take() override;
+  void          release(AggregateMsg* a) override;
+  bool          linkUp() override;
+  bool          publish(const AggregateMsg& a) override;
+  bool statusCanRideOnData(uint32_t nowMs) const;
+  bool publishMetrics();
 
   bool publishJson(const char* topic, const JsonDocument& doc);
+  bool publishBinary(const char* topic, const uint8_t* data, size_t len);
+  void onPublishResult(const char* topic, bool ok);
 
   void onMqttMessage(char* topic, uint8_t* payload, unsigned int len);
   static void mqttCallbackTrampoline(char* topic, uint8_t* payload, unsigned int len);
@@ -17,5 +17,7 @@ void printSettingsToSerial(const SettingsManager& settingsManager, Stream& out);
  * Supported commands:
  * - help / ?
  * - show / config / settings
+ * - log [spec]: print or set logLevels (e.g. "log info,COMMS=debug"), saved like /cfg
+ * - threads: per-thread stack high-water and CPU share (ThreadProfiler)
  */
 void handleSerialConsole(SettingsManager& settingsManager);
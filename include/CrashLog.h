@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "RestartReason.h"
+
+/**
+ * @brief Post-mortem log: the newest printed lines, kept across crashes.
+ *
+ * Every line the LOG thread prints is also appended to a RetainedLog in a
+ * no-init RAM section, which survives watchdog, fault and software resets
+ * (not standby or power loss). Before hibernating, the newest text is
+ * deflated into a flash journal (two sectors below the settings journal;
+ * one record per hibernate, one sector erase per ~60 hibernates).
+ *
+ * After an abnormal restart (unexpectedReboot, brownOut) begin() prepares one
+ * upload: the RAM ring if it survived, else the last flash record. CommsPump
+ * publishes it to /log when a link is up. Payload (little-endian):
+ *
+ *   "HLOG" | version u8 (1) | source u8 (1 = RAM, 2 = flash) | reason u8 |
+ *   0 u8 | rawLen u32 | seq u32 | raw DEFLATE of rawLen bytes of text
+ *
+ * seq is the RAM ring's boot count or the flash record's sequence number.
+ *
+ * An upload still waiting for a link at hibernate is parked in the journal
+ * instead of that wake's text (byte 7 then holds the attempts made) and
+ * kWakeFlagCrashLogParked is set, so the next boot retries it.
+ */
+namespace crashlog {
+
+/**
+ * @brief Attach the retained ring, capture an upload if previous was abnormal
+ *        and tee printed log lines into the ring.
+ *
+ * Call once, early in setup() (before Logger::begin() so no line is missed).
+ * @param parked warm wake with kWakeFlagCrashLogParked: reload the parked upload.
+ */
+void begin(RestartReasonCode previous, bool parked);
+
+/**
+ * @brief Store the newest text in the flash journal (hibernate path).
+ * @return true if a pending upload was parked instead (set kWakeFlagCrashLogParked).
+ */
+bool spill();
+
+/** @brief Payload waiting for upload; false if there is none. */
+bool pending(const uint8_t*& data, size_t& len);
+
+/** @brief Result of publishing pending(); gives up after CRASHLOG_UPLOAD_TRIES. */
+void uploaded(bool ok);
+
+} // namespace crashlog
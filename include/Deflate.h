@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Minimal raw DEFLATE (RFC 1951) compressor for log excerpts.
+ *
+ * One final block with the fixed Huffman tables and greedy LZ77 matching:
+ * hash chains over a 4 KB window, up to 32 candidates per position. Inputs
+ * stay below 32 KB so positions fit 16 bits.
+ * Any inflate implementation reads the output, e.g. zlib.decompress(data, -15).
+ * Log text typically shrinks to a third.
+ *
+ * Pure logic with no RTOS/board dependency. Not reentrant: the match tables
+ * are static (10 KB), callers serialize (boot and hibernate paths only).
+ */
+namespace deflate {
+
+/** @brief Largest input accepted by compress(). */
+static constexpr size_t kMaxInput = 32768;
+
+/**
+ * @brief Compress in[0..len) into out.
+ * @return compressed size, or 0 if it does not fit cap (or len is too large).
+ */
+size_t compress(const uint8_t* in, size_t len, uint8_t* out, size_t cap);
+
+} // namespace deflate
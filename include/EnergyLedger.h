@@ -0,0 +1,74 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Charge drawn from the battery, attributed to states and activities.
+ *
+ * The orchestrator samples the fuel gauge's average current every
+ * ENERGY_SAMPLE_MS and charges the interval to the current state bucket.
+ * Activities (link bring-up, publish, sensor warmup) are timed with
+ * begin()/end() from any thread and get current x active time of each
+ * interval, so they overlap the state buckets rather than adding to them.
+ * Hibernate charge is the gauge's capacity drop across the sleep.
+ *
+ * Totals survive hibernate and resets via the RTC backup registers
+ * (see WakeContext) and restart from zero on power loss.
+ */
+namespace energyledger {
+
+enum class Bucket : uint8_t {
+  Aware = 0,
+  Sampling,
+  Hibernating,
+  Attach,   ///< activity: GSM attach, TCP + MQTT connect
+  Publish,  ///< activity: MQTT publish
+  Warmup    ///< activity: sensor power-up warmup
+};
+
+static constexpr size_t kBucketCount = 6;
+
+/** @brief Load totals carried over from the previous run. */
+void restore(const uint32_t uah[kBucketCount], uint32_t trackedS);
+
+/** @brief Copy out the totals (µAh) and the seconds they cover. */
+void save(uint32_t uah[kBucketCount], uint32_t& trackedS);
+
+/** @brief Mark an activity bucket as running (nesting allowed). */
+void begin(Bucket activity);
+
+/** @brief End one begin() of an activity bucket. */
+void end(Bucket activity);
+
+/** @brief begin()/end() for a block. */
+class Scope {
+public:
+  explicit Scope(Bucket activity) : _activity(activity) { begin(activity); }
+  ~Scope() { end(_activity); }
+
+  Scope(const Scope&)            = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  Bucket _activity;
+};
+
+/**
+ * @brief Integrate since the previous call.
+ * @param state        Aware or Sampling bucket for the elapsed time.
+ * @param currentMa    Fuel-gauge average current (negative = discharging).
+ */
+void sample(Bucket state, float currentMa, uint32_t nowMs);
+
+/** @brief Add measured charge that was not sampled (hibernate). */
+void addCharge(Bucket bucket, uint32_t uah, uint32_t seconds);
+
+/**
+ * @brief Add "energyUah":[aware, sampling, hibernating, attach, publish, warmup]
+ *        and, once an hour is tracked, "daysToEmpty" from remainingMah.
+ */
+void addToJson(JsonDocument& doc, float remainingMah);
+
+} // namespace energyledger
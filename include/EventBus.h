@@ -12,14 +12,13 @@
  * the underlying mailboxes.
  */
 struct DeviceEvent {
-  enum class Type : uint8_t { Ui, Comms, Worker };
+  enum class Type : uint8_t { Ui, Comms };
 
   Type type;
 
   union {
     UiEventMsg ui;
     CommsEventMsg comms;
-    WorkerEventMsg worker;
   } data;
 };
 
@@ -33,23 +32,30 @@ struct DeviceEvent {
 class EventBus {
 public:
   EventBus(rtos::Mail<UiEventMsg, QUEUE_DEPTH_UI_TO_ORCH>& uiToOrchMail,
-           rtos::Mail<CommsEventMsg, QUEUE_DEPTH_COMMS_TO_ORCH>& commsToOrchMail,
-           rtos::Mail<WorkerEventMsg, QUEUE_DEPTH_WORKER_TO_ORCH>& workerToOrchMail);
+           rtos::Mail<CommsEventMsg, QUEUE_DEPTH_COMMS_TO_ORCH>& commsToOrchMail);
 
   // Publish a comms-originated event to the orchestrator stream.
+  // Takes ownership of the pooled topic/payload (released on failure).
   bool publish(const CommsEventMsg& evt);
 
   // Publish a UI-originated event to the orchestrator stream.
+  // Takes ownership of the pooled value (released on failure).
   bool publishUi(const UiEventMsg& evt);
 
-  // Publish a worker-originated event to the orchestrator stream.
-  bool publishWorker(const WorkerEventMsg& evt);
-
-  // Retrieve next UI or Comms event. Returns true if an event was received.
+  // Retrieve next UI or Comms event, blocking up to timeoutMs.
+  // Returns true if an event was received.
   bool tryGetNext(DeviceEvent& outEvt, uint32_t timeoutMs);
 
+  // Release pooled payloads held by an event returned from tryGetNext().
+  static void release(DeviceEvent& evt);
+
 private:
   rtos::Mail<UiEventMsg, QUEUE_DEPTH_UI_TO_ORCH>& _uiToOrchMail;
   rtos::Mail<CommsEventMsg, QUEUE_DEPTH_COMMS_TO_ORCH>& _commsToOrchMail;
-  rtos::Mail<WorkerEventMsg, QUEUE_DEPTH_WORKER_TO_ORCH>& _workerToOrchMail;
+
+  // Set on every put, so the reader sleeps instead of polling the mailboxes.
+  rtos::EventFlags _ready;
+  static constexpr uint32_t FLAG_READY = 1u << 0;
+
+  bool tryTake(DeviceEvent& outEvt);
 };
@@ -2,39 +2,235 @@
 
 #include <Arduino.h>
 #include <mbed.h>
-#include <platform/ScopedLock.h>
 #include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "AppConfig.h"
 
 /**
- * @brief Simple serial logger for Hastig.
+ * @brief Asynchronous serial logger for Hastig.
+ *
+ * A log call only copies its timestamp, tag, format pointer and raw arguments
+ * into a lock-free ring; formatting and the (possibly blocking) serial write
+ * happen later on the low-priority LOG thread, or in flush(). A slow or stalled
+ * USB host therefore costs dropped lines, never sampling time.
+ *
+ * Tags and formats are stored by pointer and must be string literals (or
+ * otherwise outlive the record). %s arguments are copied into the record,
+ * truncated if the record runs out of space.
  */
 class Logger {
 public:
   enum class Level : uint8_t { Trace = 0, Debug, Info, Warn, Error, None };
 
   /**
-   * @brief Initialize logger output.
+   * @brief Initialize logger output and start the drain thread.
+   *
+   * Records logged before this call are kept and printed once it runs.
    */
   static void begin(Stream& s, uint32_t baud);
 
   /**
-   * @brief Set runtime verbosity.
+   * @brief Set the runtime level for tags without their own level.
    */
   static void set_runtime_level(Level lvl);
 
   /**
-   * @brief Print formatted log line.
+   * @brief Apply a level spec such as "info,COMMS=debug,SENS=warn".
+   *
+   * A bare level sets the default, TAG=level overrides one tag (at most
+   * kMaxTagLevels). Names: trace, debug, info, warn, error, none. An empty
+   * spec means "info" with no overrides.
+   *
+   * @return false (and nothing applied) if the spec does not parse.
+   */
+  static bool setLevels(const char* spec);
+
+  /** @brief True if setLevels() would accept spec. */
+  static bool validLevels(const char* spec);
+
+  /**
+   * @brief True if a record at lvl from tag would be kept.
+   *
+   * Rejects and accepts by the table's min/max level first, so the per-tag
+   * lookup only runs for levels that some override treats differently.
+   */
+  static bool enabled(Level lvl, const char* tag)
+  {
+    const LevelTable& t = _tables[_active.load(std::memory_order_acquire)];
+    if (lvl < t.lo || lvl == Level::None) {
+      return false;
+    }
+    if (lvl >= t.hi) {
+      return true;
+    }
+    return lvl >= tagLevel(t, tag);
+  }
+
+  /**
+   * @brief Queue a log record; printed asynchronously.
+   *
+   * Does not filter; use the LOGx macros, which check enabled() first.
    */
-  static void log(Level lvl, const char* tag, const char* fmt, ...);
+  template <typename... Args>
+  static void log(Level lvl, const char* tag, const char* fmt, Args... args)
+  {
+    Record* r = claim(lvl, tag, fmt);
+    if (r == nullptr) {
+      return;
+    }
+    Packer p(*r);
+    int expand[] = {0, (p.add(args), 0)...};
+    (void)expand;
+    publish(r);
+  }
+
+  /**
+   * @brief Format and print every queued record on the calling thread.
+   *
+   * Used before hibernate/reset so the last lines are not lost.
+   */
+  static void flush();
+
+  /**
+   * @brief Records dropped because the ring was full.
+   */
+  static uint32_t dropped();
+
+  /** @brief Receives every printed line (without newline) on the printing thread. */
+  using Tap = void (*)(const char* line, size_t len);
+
+  /** @brief Install a second sink next to the stream (CrashLog); nullptr removes it. */
+  static void setTap(Tap tap);
+
+  enum class ArgType : uint8_t { I32, I64, F64, Str, Ptr };
+
+  static constexpr uint8_t kMaxArgs     = 10;
+  static constexpr uint8_t kDataBytes   = 96;
+  static constexpr uint8_t kMaxTagLevels = 8;
+
+  struct Record {
+    std::atomic<uint32_t> seq;
+    uint32_t              tsMs;
+    const char*           tag;
+    const char*           fmt;
+    Level                 lvl;
+    uint8_t               nargs;
+    uint8_t               len;
+    ArgType               types[kMaxArgs];
+    uint8_t               data[kDataBytes];
+  };
 
 private:
-  static Stream*     _out;
-  static Level       _lvl;
-  static rtos::Mutex _mx;
+  struct TagLevel {
+    char  tag[8];
+    Level lvl;
+  };
+
+  /** @brief Default level, per-tag overrides and their min/max for quick checks. */
+  struct LevelTable {
+    Level    global;
+    Level    lo;
+    Level    hi;
+    uint8_t  count;
+    TagLevel tags[kMaxTagLevels];
+  };
+
+  /**
+   * @brief Appends typed arguments to a claimed record.
+   *
+   * Arguments that no longer fit are left off; the formatter prints "?".
+   */
+  struct Packer {
+    Record& r;
+    bool    full = false;
+    explicit Packer(Record& rec) : r(rec) {}
+
+    void raw(ArgType t, const void* v, size_t n)
+    {
+      if (full || r.nargs >= kMaxArgs || r.len + n > sizeof(r.data)) {
+        full = true;
+        return;
+      }
+      memcpy(&r.data[r.len], v, n);
+      r.types[r.nargs++] = t;
+      r.len              = (uint8_t)(r.len + n);
+    }
+
+    void add(const char* s)
+    {
+      if (full || r.nargs >= kMaxArgs || r.len >= sizeof(r.data)) {
+        full = true;
+        return;
+      }
+      if (s == nullptr) {
+        s = "(null)";
+      }
+      const size_t n = strnlen(s, sizeof(r.data) - r.len - 1u);
+      memcpy(&r.data[r.len], s, n);
+      r.data[r.len + n]  = '\0';
+      r.types[r.nargs++] = ArgType::Str;
+      r.len              = (uint8_t)(r.len + n + 1u);
+    }
+    void add(char* s) { add((const char*)s); }
+    void add(double v) { raw(ArgType::F64, &v, sizeof(v)); }
+    void add(float v) { add((double)v); }
+    void add(std::nullptr_t) { add((const void*)nullptr); }
+
+    template <typename T>
+    void add(T* p)
+    {
+      uintptr_t v = (uintptr_t)p;
+      raw(ArgType::Ptr, &v, sizeof(v));
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type add(T v)
+    {
+      if (sizeof(T) > sizeof(uint32_t)) {
+        int64_t w = (int64_t)v;
+        raw(ArgType::I64, &w, sizeof(w));
+      } else {
+        uint32_t w = (uint32_t)v;
+        raw(ArgType::I32, &w, sizeof(w));
+      }
+    }
+  };
+
+  static Level   tagLevel(const LevelTable& t, const char* tag);
+  static bool    parseLevels(const char* spec, LevelTable& out);
+  static void    updateBounds(LevelTable& t);
+  static void    install(const LevelTable& t);
+  static Record* claim(Level lvl, const char* tag, const char* fmt);
+  static void    publish(Record* r);
+  static void    drain();
+  static void    threadEntry();
+
+  static Stream* _out;
+
+  // Double-buffered so producers never see a half-written table.
+  static LevelTable           _tables[2];
+  static std::atomic<uint8_t> _active;
 };
 
-#define LOGT(TAG, FMT, ...) Logger::log(Logger::Level::Trace, TAG, FMT, ##__VA_ARGS__)
-#define LOGD(TAG, FMT, ...) Logger::log(Logger::Level::Debug, TAG, FMT, ##__VA_ARGS__)
-#define LOGI(TAG, FMT, ...) Logger::log(Logger::Level::Info, TAG, FMT, ##__VA_ARGS__)
-#define LOGW(TAG, FMT, ...) Logger::log(Logger::Level::Warn, TAG, FMT, ##__VA_ARGS__)
-#define LOGE(TAG, FMT, ...) Logger::log(Logger::Level::Error, TAG, FMT, ##__VA_ARGS__)
+// Compile-time floor: calls below it are removed entirely (arguments are not
+// evaluated). Set with -DHASTIG_LOG_MIN_LEVEL=<0..5> (0 = Trace, 5 = None).
+#ifndef HASTIG_LOG_MIN_LEVEL
+#define HASTIG_LOG_MIN_LEVEL 1
+#endif
+
+#define HASTIG_LOG(LVL, TAG, FMT, ...)                                                   \
+  do {                                                                                   \
+    if ((int)(LVL) >= HASTIG_LOG_MIN_LEVEL && Logger::enabled(LVL, TAG)) {               \
+      Logger::log(LVL, TAG, FMT, ##__VA_ARGS__);                                         \
+    }                                                                                    \
+  } while (0)
+
+#define LOGT(TAG, FMT, ...) HASTIG_LOG(Logger::Level::Trace, TAG, FMT, ##__VA_ARGS__)
+#define LOGD(TAG, FMT, ...) HASTIG_LOG(Logger::Level::Debug, TAG, FMT, ##__VA_ARGS__)
+#define LOGI(TAG, FMT, ...) HASTIG_LOG(Logger::Level::Info, TAG, FMT, ##__VA_ARGS__)
+#define LOGW(TAG, FMT, ...) HASTIG_LOG(Logger::Level::Warn, TAG, FMT, ##__VA_ARGS__)
+#define LOGE(TAG, FMT, ...) HASTIG_LOG(Logger::Level::Error, TAG, FMT, ##__VA_ARGS__)
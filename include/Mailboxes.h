@@ -18,6 +18,5 @@ struct SystemMailboxes {
 
   rtos::Mail<UiEventMsg, QUEUE_DEPTH_UI_TO_ORCH>        uiToOrchMail;
   rtos::Mail<CommsEventMsg, QUEUE_DEPTH_COMMS_TO_ORCH>  commsToOrchMail;
-  rtos::Mail<WorkerEventMsg, QUEUE_DEPTH_WORKER_TO_ORCH> workerToOrchMail;
   rtos::Mail<OrchCommandMsg, QUEUE_DEPTH_ORCH_TO_COMMS> orchToCommsMail;
 };
@@ -2,13 +2,18 @@
 
 #include <stdint.h>
 
+#include "PayloadPool.h"
+
 /**
  * @brief UI-to-orchestrator event message.
+ *
+ * topic is a short routing word ("key", "cmd", "setup", ...). The value text
+ * lives in the payload pool and is released by the consumer.
  */
 struct UiEventMsg {
-  uint32_t ts_ms;
-  char     topic[64];
-  char     value[128];
+  uint32_t   ts_ms;
+  char       topic[16];
+  PayloadRef value;
 };
 
 /**
@@ -16,11 +21,13 @@ struct UiEventMsg {
  */
 struct SensorSampleMsg {
   uint32_t relMs;
+  uint32_t session;  ///< SessionClock session relMs counts from
   char     k0[8];
   float    v0;
   char     k1[8];
   float    v1;
   bool     ok;
+  bool     wake;     ///< no sample: only wakes the aggregator (see AggregatorThread::wake())
 };
 
 /**
@@ -43,26 +50,7 @@ struct AggregateMsg {
 
   uint32_t n;
   bool     ok;
-};
-
-/**
- * @brief Lightweight worker events for orchestrator visibility.
- *
- * These are intentionally small and do not replace the existing data
- * mailboxes (sensor->agg, agg->comms). They provide observability and a
- * single event stream in the orchestrator.
- */
-enum class WorkerEventType : uint8_t {
-  SampleTaken,
-  AggregateReady,
-};
-
-struct WorkerEventMsg {
-  WorkerEventType type;
-  uint32_t        ts_ms;
-  uint32_t        relMs;
-  uint32_t        n;
-  bool            ok;
+  bool     partial;  ///< window closed early (stop, hibernate) instead of by agg period
 };
 
 /**
@@ -74,14 +62,19 @@ enum class CommsEventType : uint8_t {
   NetDown,
   MqttUp,
   MqttDown,
-  AggregatePublishAttempted,
+  AggregatePublished,
   ServerCommand,
   PublishFailed,
 };
 
+/**
+ * topic and payload live in the payload pool and are released by the consumer.
+ * For ServerCommand the payload slot holds a decoded protocol::Command (raw
+ * bytes, copy out with memcpy) instead of text.
+ */
 struct CommsEventMsg {
   CommsEventType type;
   uint32_t       ts_ms;
-  char           topic[64];
-  char           payload[256];
+  PayloadRef     topic;
+  PayloadRef     payload;
 };
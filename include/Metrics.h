@@ -0,0 +1,71 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Runtime counters, mailbox depths and latency histograms.
+ *
+ * Every slot is a statically allocated atomic, so any thread (and the hot
+ * sampling path) records without locks or mail. CommsPump publishes a
+ * snapshot to /metrics every METRICS_PUBLISH_INTERVAL_S and before
+ * hibernate. Values count from boot; standby restarts them from zero.
+ */
+namespace metrics {
+
+enum class Counter : uint8_t {
+  SamplesProduced = 0,
+  SampleErrors,       ///< sensor read failed
+  AggregatesProduced,
+  Publishes,          ///< MQTT publishes that succeeded
+  PublishFailures,
+  MqttConnects,
+  FlashWrites,        ///< journal records programmed (settings, crash log)
+  FlashErases
+};
+
+static constexpr size_t kCounterCount = 8;
+
+/** @brief Inter-thread mailboxes whose depth is tracked. */
+enum class Queue : uint8_t {
+  SensorToAgg = 0,
+  AggToComms,
+  CommsToOrch,
+  UiToOrch,
+  OrchToComms
+};
+
+static constexpr size_t kQueueCount = 5;
+
+enum class Histogram : uint8_t {
+  PublishMs = 0 ///< duration of one MQTT publish call
+};
+
+static constexpr size_t kHistogramCount = 1;
+
+/** @brief Buckets per histogram; the last one has no upper bound. */
+static constexpr size_t kHistogramBuckets = 8;
+
+void count(Counter c, uint32_t n = 1u);
+
+uint32_t value(Counter c);
+
+/** @brief A message was put into q; updates the high-water mark. */
+void enqueued(Queue q);
+
+/** @brief A message was taken out of q. */
+void dequeued(Queue q);
+
+/** @brief A put into q failed because the mailbox was full. */
+void queueFull(Queue q);
+
+void observe(Histogram h, uint32_t v);
+
+/**
+ * @brief Add "c":[counters], "qHw":[high-water], "qFull":[full drops],
+ *        "pubMs":[buckets], "pubMsMax" and "logDrop".
+ */
+void addToJson(JsonDocument& doc);
+
+} // namespace metrics
@@ -3,9 +3,12 @@
 #include <mbed.h>
 #include <stdint.h>
 
+#include "PowerPolicy.h"
+#include "SettingsManager.h"
+#include "StopUtil.h"
+
 class EventBus;
 class CommsEgress;
-class SettingsManager;
 class SessionClock;
 class SamplingThread;
 class AggregatorThread;
@@ -13,6 +16,10 @@ class PowerManager;
 class RuntimeStatus;
 struct UiEventMsg;
 
+namespace protocol {
+struct Command;
+}
+
 
 /**
  * @brief Application orchestrator (state machine).
@@ -42,10 +49,20 @@ public:
   void start();
   void stop();
 
+  /**
+   * @brief Run the scheduled (autonomous) session right after boot (warm wake with a pending session).
+   *
+   * Call before start().
+   */
+  void startSamplingOnBoot() { _samplingOnBoot = true; }
+
+  /** @brief True if the settings describe a usable session schedule (duration shorter than the interval). */
+  static bool scheduleEnabled(const AppSettings& s);
+
 private:
   enum class State : uint8_t { Aware, Sampling, Hibernating };
 
-  enum class HibernateReason : uint8_t { Inactivity, Forced, EmergencyPowerSave, NoNetwork };
+  enum class HibernateReason : uint8_t { Inactivity, Forced, EmergencyPowerSave, NoNetwork, Schedule };
 
   EventBus& _eventBus;
   CommsEgress& _commsEgress;
@@ -58,6 +75,7 @@ private:
   RuntimeStatus&    _runtimeStatus;
 
   rtos::Thread _thread;
+  stoputil::StopSignal _stop;
 
   State    _state          = State::Aware;
   uint32_t _stateEnterMs   = 0;
@@ -68,9 +86,27 @@ private:
   uint32_t _bootMs         = 0;
   uint32_t _mqttUpMs       = 0;
   bool     _noNetworkHibernateRequested = false;
+  bool     _samplingOnBoot = false;
+
+  // Scheduled session: sample with the radio off until _autoEndMs, then
+  // upload (_uploadStartMs != 0) and hibernate until the next slot.
+  bool     _autonomous    = false;
+  uint32_t _autoEndMs     = 0;
+  uint32_t _uploadStartMs = 0;
 
   uint32_t _lastActivityMs = 0;
+  uint32_t _seenSamples    = 0; ///< metrics SamplesProduced at the last activity check
   uint32_t _lastStatusMs   = 0;
+  uint32_t _lastEnergyMs   = 0;
+  uint32_t _lastProfileMs  = 0;
+
+  // Battery-aware stretch of sample/aggregation/status periods and sleeps.
+  PowerPolicy _powerPolicy;
+  uint32_t    _lastPolicyMs = 0;
+
+  // logLevels changes (from /cfg or the console) are applied to Logger here,
+  // lowPowerIdle changes (Power group) to the idle wake lock.
+  SettingsSubscription _logSub;
 
   uint32_t _forcedHibernateS          = 0;
   HibernateReason _hibernateReason    = HibernateReason::Inactivity;
@@ -83,9 +119,16 @@ private:
 
   void enterState(State s);
 
-  void handleServerCommand(const char* topic, const char* json);
+  void handleServerCommand(const protocol::Command& cmd);
   void handleUiEvent(const UiEventMsg& uiEvt);
   void handleAck();
 
   void checkTimeouts();
+  uint32_t idleWaitMs(uint32_t nowMs) const;
+  void updatePowerPolicy(uint32_t nowMs, float lowBattV);
+  void updateThreadProfile(uint32_t nowMs);
+
+  void startScheduledSession();
+  void checkScheduledSession(uint32_t nowMs);
+  void hibernateUntilNextSlot(uint32_t sleepS);
 };
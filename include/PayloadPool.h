@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Handle to a variable-length payload stored in the shared payload pool.
+ *
+ * Mailbox messages carry this small handle instead of fixed-size char arrays.
+ * The producer stores the text, the consumer releases it after handling.
+ * Kept trivial so it can live in unions (DeviceEvent); PayloadRef{} is empty.
+ */
+struct PayloadRef {
+  char*   ptr;
+  uint8_t cls;
+};
+
+/**
+ * @brief Size-classed slab pool for inter-thread payloads.
+ *
+ * Three size classes (small/medium/large, see AppConfig.h) are served from
+ * static storage. Allocation and release are lock-free (atomic bitmask per
+ * class) and therefore safe from any thread. Requests that do not fit a full
+ * class spill over into the next larger one.
+ */
+namespace payloadpool {
+
+/**
+ * @brief Allocate a zero-terminated slot with room for at least `bytes` bytes.
+ * @return false if no slot is available (out is left empty).
+ */
+bool alloc(size_t bytes, PayloadRef& out);
+
+/**
+ * @brief Copy a C string into the pool (truncated to the largest class).
+ * @return false if no slot is available (out is left empty).
+ */
+bool store(const char* text, PayloadRef& out);
+
+/** @brief Capacity in bytes of the slot referenced by ref (0 if empty). */
+size_t capacity(const PayloadRef& ref);
+
+/** @brief Return the stored text, or "" for an empty handle. */
+const char* str(const PayloadRef& ref);
+
+/** @brief Return the slot to its pool and clear the handle. Safe on empty handles. */
+void release(PayloadRef& ref);
+
+/** @brief Number of currently allocated slots in size class `cls` (diagnostics). */
+uint32_t inUse(uint8_t cls);
+
+} // namespace payloadpool
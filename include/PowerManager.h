@@ -10,6 +10,7 @@ class UiThread;
 class Orchestrator;
 class AggregatorThread;
 class SamplingThread;
+class SettingsManager;
 class Board;
 class RestartReasonStore;
 
@@ -17,13 +18,15 @@ class RestartReasonStore;
  * @brief Executes the "sleep transaction" from the Arduino loop context.
  *
  * Orchestrator requests sleep via requestSleep(). The loop calls service()
- * to perform: comms grace -> thread shutdown -> comms teardown -> enter hibernate.
+ * to perform: cooperative thread stop (each flushes) -> drain comms outbox
+ * (bounded) -> comms teardown -> save wake context -> enter hibernate.
  */
 class PowerManager {
 public:
   struct SleepRequest {
     RestartReasonCode reasonCode = RestartReasonCode::UnexpectedReboot;
     uint32_t expectedDurationS   = 0;
+    uint32_t wakeFlags           = 0;  // kWakeFlag*, applied on the next (warm) boot
   };
 
   PowerManager(Board& board,
@@ -32,11 +35,12 @@ public:
                UiThread& ui,
                AggregatorThread& agg,
                SamplingThread& sampling,
+               SettingsManager& settings,
                uint8_t wakePin);
 
   void setOrchestrator(Orchestrator& orch);
 
-  void requestSleep(RestartReasonCode reasonCode, uint32_t expectedDurationS);
+  void requestSleep(RestartReasonCode reasonCode, uint32_t expectedDurationS, uint32_t wakeFlags = 0);
 
   /**
    * @brief Called frequently from loop(). Performs the sleep transaction if requested.
@@ -57,6 +61,7 @@ private:
   Orchestrator* _orch = nullptr;
   AggregatorThread& _agg;
   SamplingThread& _sampling;
+  SettingsManager& _settings;
 
   const uint8_t _wakePin;
 
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Battery-aware duty scaling.
+ *
+ * Turns fuel-gauge readings into one stretch factor (permille, 1000 =
+ * configured values) that the sampler, aggregator, status timer and
+ * hibernate durations multiply their settings by. The factor grows
+ * continuously as state of charge falls, and further when the discharge
+ * trend would reach the floor within kHorizonH. Charging relaxes it again.
+ *
+ * Targets are quantised to kSteps; stepping up is immediate, stepping down
+ * needs kRelaxUpdates consecutive lower targets, so a noisy gauge does not
+ * thrash the schedule. Pure logic with no RTOS/board dependency: the same
+ * reading sequence always yields the same decisions, so recorded battery
+ * traces can be replayed through update() on the host.
+ */
+class PowerPolicy {
+public:
+  struct Reading {
+    uint32_t tMs            = 0;
+    float    socPct         = 100.0f;  ///< fuel-gauge state of charge
+    float    currentMa      = 0.0f;    ///< average current, negative = discharging
+    float    minimumVoltage = 0.0f;
+  };
+
+  static constexpr uint16_t kNominal = 1000;
+
+  /** @brief Forget the trend and return to the nominal factor. */
+  void reset();
+
+  /**
+   * @brief Feed one reading; returns the factor to apply from now on.
+   * @param lowBattV  emergency threshold (settings low_batt_min_v).
+   */
+  uint16_t update(const Reading& r, float lowBattV);
+
+  uint16_t stretchPermille() const { return kSteps[_step]; }
+
+  /** @brief SoC trend in %/h (negative = discharging), 0 until known. */
+  float socPerHour() const { return _socPerHour; }
+
+  /** @brief base scaled by a stretch factor (permille), saturating at UINT32_MAX. */
+  static uint32_t scale(uint32_t base, uint16_t permille);
+
+private:
+  static constexpr uint16_t kSteps[]      = {1000, 1250, 1500, 2000, 3000, 4000, 6000, 8000};
+  static constexpr uint8_t  kStepCount    = sizeof(kSteps) / sizeof(kSteps[0]);
+  static constexpr float    kFullSocPct   = 60.0f;   ///< at or above: nominal
+  static constexpr float    kFloorSocPct  = 10.0f;   ///< at or below: maximum stretch
+  static constexpr float    kHorizonH     = 72.0f;   ///< keep at least this much runtime
+  static constexpr float    kVoltageMarginV = 0.10f; ///< near lowBattV: maximum stretch
+  static constexpr float    kChargingMa   = 20.0f;
+  static constexpr uint32_t kTrendMinDtMs = 10u * 60u * 1000u;
+  static constexpr float    kTrendAlpha   = 0.3f;
+  static constexpr uint8_t  kRelaxUpdates = 3;
+
+  uint8_t  _step        = 0;
+  uint8_t  _relaxCount  = 0;
+  bool     _hasAnchor   = false;
+  uint32_t _anchorMs    = 0;
+  float    _anchorSoc   = 0.0f;
+  bool     _hasTrend    = false;
+  float    _socPerHour  = 0.0f;
+
+  float   targetFactor(const Reading& r, float lowBattV) const;
+  uint8_t stepFor(float factor) const;
+  void    updateTrend(const Reading& r);
+};
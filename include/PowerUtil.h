@@ -31,4 +31,24 @@ void preparePinsForLowPower(uint8_t wakePin);
  */
 void hibernate(Board& board, uint8_t wakePin, uint32_t expectedDurationS);
 
+/**
+ * @brief Let the idle thread enter Stop mode whenever no deep-sleep lock is held.
+ *
+ * mbed tickless idle then sleeps until the next thread deadline or IRQ.
+ * Locks come from wakelock holders and from drivers (USB serial holds one
+ * while connected, so this only pays off on battery).
+ */
+void enableIdleDeepSleep();
+
+/**
+ * @brief Apply the lowPowerIdle setting: false holds a wake lock so Stop is never entered.
+ *
+ * Takes effect at once (no reboot), so energy can be compared with Stop on
+ * and off on the same unit. Safe to call repeatedly and from any thread.
+ */
+void setIdleDeepSleep(bool allowed);
+
+/** @brief True if Stop mode may be entered when idle (on battery and the setting on). */
+bool idleDeepSleepActive();
+
 } // namespace powerutil
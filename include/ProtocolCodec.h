@@ -23,6 +23,12 @@ static constexpr const char* kKeySleepSeconds = "sleepSeconds";
 static constexpr const char* kKeySamplingInterval = "samplingInterval";
 static constexpr const char* kKeyAggPeriodS = "aggPeriodS";
 static constexpr const char* kKeySessionId = "sessionID";
+static constexpr const char* kKeyFormat = "format";
+static constexpr const char* kKeyDigest = "digest";
+
+// getConfig "format" values
+static constexpr const char* kFormatJson = "json";
+static constexpr const char* kFormatMsgPack = "msgpack";
 
 // Outbound payload helpers
 static constexpr const char* kKeyReason = "reason";
@@ -32,6 +38,10 @@ static constexpr const char* kKeyExpectedDuration = "expectedDuration";
 // Example output: {"reason":"forced","expectedDuration":30}
 bool encodeHibernatingExtra(const char* reason, uint32_t expectedDurationS, char* out, size_t outLen);
 
+// Encode getConfig options for the comms layer.
+// Example output: {"format":"msgpack","digest":305419896}
+bool encodeConfigRequest(bool binary, bool hasDigest, uint32_t digest, char* out, size_t outLen);
+
 struct Command
 {
   enum class Type : uint8_t {
@@ -60,12 +70,24 @@ struct Command
 
   bool hasSessionId = false;
   char sessionId[48] = {0};
+
+  // getConfig options
+  bool configBinary = false;  // "format":"msgpack"
+  bool hasConfigDigest = false;
+  uint32_t configDigest = 0;  // digest the server already holds
 };
 
 // Decode an inbound /cmd payload.
 // Returns false if JSON is invalid.
 bool decodeCommand(const char* json, Command& out);
 
+// Decode an inbound /cmd payload that is not null-terminated (MQTT buffer).
+// Returns false if JSON is invalid.
+bool decodeCommand(const uint8_t* json, size_t len, Command& out);
+
+// Map a command "type" string to Command::Type (length check, then one compare per kCmd* entry).
+Command::Type decodeType(const char* type, size_t len);
+
 // ---------------- MQTT topic helpers ----------------
 // Topics are typically: <prefix>/<nodeId>/<postfix>
 
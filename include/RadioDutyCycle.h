@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Wake-window scheduler for the cellular radio (PSM/eDRX duty cycling).
+ *
+ * Deferrable uplink traffic (aggregates, periodic status) is only sent while a
+ * wake window is open. Windows repeat every periodMs starting at the anchor
+ * (the last MQTT connect), so data and status leave in the same radio
+ * transaction and the modem can stay in PSM in between.
+ *
+ * Urgent traffic (mode changes, config replies) opens an ad-hoc window via
+ * openNow(). Pure logic with no RTOS/GSM dependency.
+ */
+class RadioDutyCycle {
+public:
+  /**
+   * @brief Set schedule. Disabled (or periodMs == 0) means "always open".
+   */
+  void configure(bool enabled, uint32_t periodMs, uint32_t windowMs);
+
+  /** @brief Align window starts to nowMs (call on MQTT connect). */
+  void anchor(uint32_t nowMs);
+
+  /** @brief Open a window right now for windowMs (urgent traffic). */
+  void openNow(uint32_t nowMs);
+
+  bool     enabled() const { return _enabled && _periodMs > 0u; }
+  uint32_t periodMs() const { return _periodMs; }
+
+  /** @brief True if deferrable traffic may be sent at nowMs. */
+  bool isWindowOpen(uint32_t nowMs) const;
+
+  /** @brief Milliseconds until the next scheduled window opens (0 if open). */
+  uint32_t msUntilNextWindow(uint32_t nowMs) const;
+
+  /**
+   * @brief MQTT keepalive that spans a full sleep period between windows.
+   *
+   * Returns minKeepAliveS when duty cycling is disabled.
+   */
+  uint16_t keepAliveS(uint16_t minKeepAliveS) const;
+
+private:
+  bool     _enabled   = false;
+  uint32_t _periodMs  = 0;
+  uint32_t _windowMs  = 0;
+
+  bool     _anchored  = false;
+  uint32_t _anchorMs  = 0;
+
+  bool     _urgent        = false;
+  uint32_t _urgentUntilMs = 0;
+};
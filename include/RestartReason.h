@@ -1,13 +1,13 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 /**
  * @brief Restart reason codes stored across hibernate using battery-backed domain.
  *
- * Implementation note:
- * On Portenta H7 this should be backed by RTC backup registers.
- * For now we provide a thin abstraction with a stub backend that can be replaced.
+ * Stored in the RTC backup registers, which survive standby and resets but
+ * not a loss of battery power (then the store reads as PowerOn).
  */
 enum class RestartReasonCode : uint32_t {
   UnexpectedReboot     = 1,
@@ -16,19 +16,61 @@ enum class RestartReasonCode : uint32_t {
   Forced               = 4,
   EmergencyPowerSave   = 5,
   BrownOut             = 6,
+  PowerOn              = 7,
 };
 
 /**
- * @brief Persistent restart-reason storage.
+ * @brief State carried from a controlled hibernate into the next boot.
+ */
+struct WakeContext {
+  RestartReasonCode reason          = RestartReasonCode::PowerOn;
+  uint32_t          sleepS          = 0;  ///< requested hibernate duration
+  uint32_t          wakeCount       = 0;  ///< consecutive controlled wakes
+  uint32_t          settingsDigest  = 0;  ///< SettingsManager::configDigest() at hibernate
+  uint32_t          flags           = 0;  ///< kWakeFlag*
+
+  // Energy ledger carried over the sleep (see energyledger::save).
+  static constexpr size_t kEnergyBuckets = 6;
+  uint32_t          energyUah[kEnergyBuckets] = {0};
+  uint32_t          energyTrackedS  = 0;
+  uint32_t          capacityMah     = 0;  ///< fuel-gauge remaining capacity at hibernate
+};
+
+/** @brief Start a sampling session right after a warm wake. */
+static constexpr uint32_t kWakeFlagSampleOnWake = 1u << 0;
+
+/** @brief The newest crash-log journal record is an upload still to be published. */
+static constexpr uint32_t kWakeFlagCrashLogParked = 1u << 1;
+
+/**
+ * @brief Persistent restart-reason and wake-context storage.
+ *
+ * On STM32H7 targets the RTC backup registers are used; other builds (host
+ * tests) get a RAM array with the same layout.
  */
 class RestartReasonStore {
 public:
-  /** @brief Initialize backend. */
+  /** @brief Initialize backend and capture the context left by the previous run. */
   void begin();
 
   /** @brief Read last stored reason. */
   RestartReasonCode read() const;
 
-  /** @brief Write reason to persistent storage. */
+  /** @brief Write reason to persistent storage (keeps the rest of the context). */
   void write(RestartReasonCode code) const;
+
+  /** @brief Store the full context right before hibernate. */
+  void writeContext(const WakeContext& ctx) const;
+
+  /** @brief Context as found by begin() (reason PowerOn if none was valid). */
+  const WakeContext& bootContext() const { return _boot; }
+
+  /** @brief True if the previous run ended in a controlled hibernate (not a crash or power loss). */
+  bool isWarmWake() const;
+
+  /** @brief Short name for logs and status messages. */
+  static const char* name(RestartReasonCode code);
+
+private:
+  WakeContext _boot;
 };
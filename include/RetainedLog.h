@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Text ring over a memory region that survives resets.
+ *
+ * The region starts with a small header; the rest holds the newest log text,
+ * wrapping around. attach() decides whether the previous run left valid
+ * content (header intact) or whether the region is garbage (power-on,
+ * standby) and must be formatted.
+ *
+ * Pure logic with no RTOS/board dependency: where the memory lives (a
+ * no-init RAM section on the device) is up to the caller, so a host test
+ * simulates a reset by attaching a second instance to the same buffer.
+ * Single writer; the caller serializes append().
+ */
+class RetainedLog {
+public:
+  struct Header {
+    uint32_t magic;
+    uint32_t size;  ///< text capacity in bytes (a power of two keeps positions stable when head wraps)
+    uint32_t check; ///< ~magic ^ size
+    uint32_t head;  ///< total bytes ever appended (wraps)
+    uint32_t boots; ///< attaches that found valid content
+  };
+
+  /** @param mem region of bytes >= sizeof(Header) + 64, 4-byte aligned. */
+  RetainedLog(void* mem, size_t bytes);
+
+  /**
+   * @brief Validate the region; format it if it holds no valid ring.
+   * @return true if text from a previous run is present.
+   */
+  bool attach();
+
+  void append(const char* s, size_t n);
+
+  /**
+   * @brief Copy the newest text, at most max bytes, starting on a line boundary.
+   * @return bytes copied.
+   */
+  size_t excerpt(char* out, size_t max) const;
+
+  /** @brief Bytes held (up to the capacity). */
+  size_t used() const;
+
+  /** @brief Boots that kept this ring (0 after formatting). */
+  uint32_t boots() const { return _hdr->boots; }
+
+  /** @brief Address and length of the bytes the last append() touched (for cache maintenance). */
+  const void* lastWrite(size_t& len) const;
+
+private:
+  static constexpr uint32_t kMagic = 0x524C4F47; // 'RLOG'
+
+  Header* _hdr;
+  char*   _text;
+  size_t  _cap;
+
+  const char* _lastAt  = nullptr;
+  size_t      _lastLen = 0;
+};
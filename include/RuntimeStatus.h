@@ -23,10 +23,15 @@ public:
   void setLastSample(const SensorSampleMsg& sample);
   bool getLastSample(SensorSampleMsg& outSample) const;
 
+  /** @brief Battery policy stretch factor (permille, see PowerPolicy). */
+  void setPowerStretch(uint16_t permille);
+  uint16_t powerStretch() const;
+
 private:
   std::atomic<uint8_t>  _mode;
   std::atomic<uint32_t> _lastActivityMs;
   std::atomic<uint32_t> _awareTimeoutS;
+  std::atomic<uint16_t> _powerStretch;
 
   mutable rtos::Mutex _sampleMx;
   SensorSampleMsg     _lastSample;
@@ -8,8 +8,8 @@
 #include "SettingsManager.h"
 #include "SessionClock.h"
 #include "Sensor.h"
-#include "EventBus.h"
 #include "RuntimeStatus.h"
+#include "StopUtil.h"
 
 template <uint32_t DEPTH>
 using SensorMail = rtos::Mail<SensorSampleMsg, DEPTH>;
@@ -22,13 +22,14 @@ public:
   SamplingThread(SensorMail<QUEUE_DEPTH_SENSOR_TO_AGG>& outMail,
              SettingsManager& settings,
              SessionClock& clock,
-             EventBus& eventBus,
              RuntimeStatus& runtimeStatus);
 
   /**
    * @brief Start RTOS thread.
    */
   void start();
+
+  /** @brief Stop sampling, power the sensor down and let the thread exit. */
   void stop();
 
   /**
@@ -40,18 +41,29 @@ private:
   SensorMail<QUEUE_DEPTH_SENSOR_TO_AGG>& _outMail;
   SettingsManager&                         _settings;
   SessionClock&                          _clock;
-  EventBus&                              _eventBus;
   RuntimeStatus&                         _runtimeStatus;
 
   rtos::Thread     _thread;
   rtos::EventFlags _flags;
+  stoputil::StopSignal _stop;
+
+  static constexpr uint32_t FLAG_WAKE     = 1u << 0;
+  static constexpr uint32_t FLAG_SETTINGS = 1u << 1;
 
-  static constexpr uint32_t FLAG_WAKE = 1u << 0;
+  SettingsSubscription _settingsSub;
 
   std::atomic<bool> _enabled{false};
 
-  Sensor* _sensor = nullptr;
+  // Current sensor and the settings it was opened with (type/address/baud).
+  Sensor*  _sensor        = nullptr;
+  bool     _sensorPowered = false;
+  uint32_t _sensorType    = 0;
+  uint8_t  _sensorAddr    = 0;
+  uint32_t _sensorBaud    = 0;
 
   static void threadEntry(void* ctx);
   void run();
+  bool sensorMatches(const AppSettings& s) const;
+  bool openSensor(const AppSettings& s);
+  void closeSensor(bool powerOff);
 };
@@ -27,18 +27,28 @@ public:
   /**
    * @brief Get server-provided session id for current session, if any.
    *
+   * @param sessionOut if set, receives the session number (see relMs(uint32_t&))
    * @return true if current session was started with server session id.
    */
-  bool getServerSessionId(char* out, size_t outLen) const;
+  bool getServerSessionId(char* out, size_t outLen, uint32_t* sessionOut = nullptr) const;
 
   /**
    * @brief Milliseconds since reference start.
    */
   uint32_t relMs() const;
 
+  /**
+   * @brief relMs() and the session it counts from, read together.
+   *
+   * Sessions are numbered by startNewSession(), so a sample stamped just
+   * before a new session starts is not mistaken for one of the new session.
+   */
+  uint32_t relMs(uint32_t& sessionOut) const;
+
 private:
   mutable rtos::Mutex _mx;
   uint32_t            _refMs = 0;
+  uint32_t            _session = 0;
   char                _sessionId[48] = {0};
   bool                _hasServerSessionId = false;
 
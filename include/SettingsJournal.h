@@ -0,0 +1,94 @@
+#pragma once
+
+#include <mbed.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Append-only, wear-levelled record journal at the end of flash.
+ *
+ * Each save appends a page-aligned record {magic, seq, len, crc, payload} to
+ * the active sector; no erase is needed until the sector is full. Then the
+ * other sector is erased and the new record starts it (compaction: only the
+ * newest record matters). On boot the newest record with a valid CRC wins,
+ * so a power cut mid-save falls back to the previous record.
+ *
+ * Settings use the last kSectorCount sectors; CrashLog keeps its own
+ * journal right below them, with a different record magic.
+ *
+ * Not thread-safe; the owner (SettingsManager, CrashLog) serializes access.
+ */
+class SettingsJournal {
+public:
+  static constexpr uint32_t kSectorCount   = 2;
+  static constexpr uint32_t kSettingsMagic = 0x4A544553;  // 'SETJ'
+
+  /**
+   * @param sectorsFromEnd  sectors between this journal and the end of flash
+   * @param magic           record magic, distinct per journal
+   */
+  explicit SettingsJournal(uint32_t sectorsFromEnd = 0, uint32_t magic = kSettingsMagic)
+      : _sectorsFromEnd(sectorsFromEnd), _magic(magic)
+  {
+  }
+
+  /**
+   * @brief Open flash and scan all sectors for the newest valid record.
+   * @return false if flash is unavailable. Safe to call more than once.
+   */
+  bool begin();
+
+  /**
+   * @brief Copy the newest valid record into out.
+   *
+   * A shorter record (written by older firmware before fields were appended)
+   * is only accepted if loadedLen is given; out keeps its tail bytes.
+   * @return false if there is none or its length does not fit len.
+   */
+  bool loadLatest(void* out, size_t len, size_t* loadedLen = nullptr);
+
+  /** @brief Append a new record (erases the other sector first when full). */
+  bool append(const void* data, size_t len);
+
+  /** @brief Sequence number of the newest record (0 if none). */
+  uint32_t latestSeq() const { return _latestSeq; }
+
+  /** @brief Number of sector erases done since boot (diagnostics). */
+  uint32_t eraseCount() const { return _eraseCount; }
+
+  /** @brief CRC32 (IEEE, reflected), chainable via crc argument. */
+  static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0u);
+
+private:
+  struct RecordHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t len;
+    uint32_t crc;  // over seq, len and payload
+  };
+
+  static constexpr uint32_t kMaxPageBytes = 256;
+
+  uint32_t _sectorsFromEnd;
+  uint32_t _magic;
+
+  mbed::FlashIAP _flash;
+  bool           _open = false;
+
+  uint32_t _pageSize   = 0;
+  uint32_t _sectorSize = 0;
+  uint32_t _sectorBase[kSectorCount] = {0};
+
+  uint8_t  _active    = 0;
+  uint32_t _writeOff  = 0;
+  uint32_t _latestSeq = 0;
+  uint32_t _latestAddr = 0;
+  uint32_t _latestLen  = 0;
+  uint32_t _eraseCount = 0;
+
+  void     scan();
+  uint32_t scanSector(uint8_t sector);
+  uint32_t recordCrc(uint32_t addr, const RecordHeader& h);
+  uint32_t strideFor(uint32_t payloadLen) const;
+  bool     programRecord(uint32_t addr, const RecordHeader& h, const uint8_t* payload);
+};
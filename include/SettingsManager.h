@@ -3,15 +3,17 @@
 #include <ArduinoJson.h>
 #include <mbed.h>
 #include <platform/ScopedLock.h>
+#include <atomic>
 #include <stdint.h>
 
 #include "LcdMenu.h"
+#include "SettingsJournal.h"
 
 /**
  * @brief Hastig settings stored in flash.
  */
 struct AppSettings {
-  uint32_t version = 1;
+  uint32_t version = 4;
 
   // Sensor serial settings
   uint8_t  sensor_addr = 1;
@@ -52,6 +54,57 @@ struct AppSettings {
   uint32_t emergency_sleep_s   = 43200;
   uint32_t max_forced_sleep_s  = 43200;
   uint32_t max_unacked_packets = 10;
+
+  // Autonomous sampling schedule (appended in version 2; 0 = off / inherit)
+  uint32_t sched_interval_s       = 0;
+  uint32_t sched_duration_s       = 0;
+  uint32_t sched_sample_period_ms = 0;
+  uint32_t sched_agg_period_s     = 0;
+
+  // Log levels, see Logger::setLevels() (appended in version 3)
+  char log_levels[48] = "info";
+
+  // Stop mode while idle on battery, 0 = off for comparisons (appended in version 4)
+  uint8_t low_power_idle = 1;
+};
+
+/**
+ * @brief Field groups that components can subscribe to.
+ */
+enum class SettingsGroup : uint8_t {
+  Sensor = 0,  ///< sensor type, address, baud, warmup
+  Schedule,    ///< sampling/aggregation periods, timeouts, status interval
+  Network,     ///< SIM/APN, MQTT, device name (topics)
+  Power,       ///< battery and sleep limits
+  Logging      ///< log levels
+};
+
+/** @brief Bit for group in a SettingsSubscription mask. */
+constexpr uint8_t settingsGroupBit(SettingsGroup group)
+{
+  return (uint8_t)(1u << (uint8_t)group);
+}
+
+static constexpr uint8_t kAllSettingsGroups = 0x1Fu;
+
+/**
+ * @brief Change notification handle, owned by the subscriber.
+ *
+ * SettingsManager ORs the changed groups (filtered by interest) into pending
+ * and, if flags is set, sets flag so a blocked thread wakes up. A thread that
+ * blocks on something else (a mailbox) sets wake instead; it is called under
+ * the settings lock, so it must not block.
+ */
+struct SettingsSubscription {
+  uint8_t              interest = 0;
+  rtos::EventFlags*    flags    = nullptr;
+  uint32_t             flag     = 0;
+  void (*wake)(void* ctx)       = nullptr;
+  void*                wakeCtx  = nullptr;
+  std::atomic<uint8_t> pending{0};
+
+  /** @brief Return and clear the groups changed since the last call. */
+  uint8_t consume() { return pending.exchange(0); }
 };
 
 /**
@@ -65,20 +118,77 @@ public:
   void begin();
 
   /**
-   * @brief Get a copy of settings (thread-safe).
+   * @brief Get a copy of settings (thread-safe), with any session override applied.
    */
   AppSettings getCopy() const;
 
+  /**
+   * @brief Runtime-only sampling/aggregation periods for a scheduled session.
+   *
+   * getCopy() reports them in place of the stored values and subscribers are
+   * notified, but they never enter the stored settings: save(), the config
+   * snapshot/digest and the menu keep the server-set values. 0 keeps the
+   * stored value; (0, 0) ends the override.
+   */
+  void setSessionOverride(uint32_t samplePeriodMs, uint32_t aggPeriodS);
+
   /** @brief Update settings in RAM only (no flash write). */
   void setRuntime(const AppSettings& s);
 
   /**
-   * @brief Apply JSON patch and optionally persist.
+   * @brief Apply JSON patch atomically and optionally persist.
+   *
+   * The patch is staged and validated first; if any recognized key has a
+   * wrong type nothing is applied. A patch that leaves every field unchanged
+   * neither bumps revision() nor writes flash.
+   *
+   * @param changedSectionsOut optional, receives sectionBit() mask of changed sections.
+   */
+  bool applyJson(const char* json, bool persist, uint8_t* changedSectionsOut = nullptr);
+
+  /**
+   * @brief Outcome of applyCfgMessage().
    */
-  bool applyJson(const char* json, bool persist);
+  struct CfgResult {
+    bool    ok              = false;  ///< message accepted (parsed, staged or committed)
+    bool    committed       = false;  ///< settings were updated by this message
+    uint8_t changedSections = 0;      ///< sectionBit() mask, valid when committed
+  };
 
   /**
-   * @brief Persist current settings to flash.
+   * @brief Apply one /cfg message.
+   *
+   * Without "txn" (and no open transaction) this is applyJson(). With
+   * "txn":"begin" the keys are staged, further messages keep staging until
+   * "txn":"commit" (validate + one write + one revision bump) or
+   * "txn":"rollback".
+   */
+  CfgResult applyCfgMessage(const char* json, bool persist);
+
+  /** @brief Open a staged transaction (false if one is already open). */
+  bool beginTransaction();
+
+  /** @brief Stage a JSON patch; marks the transaction invalid on bad keys. */
+  bool patchTransaction(const char* json);
+
+  /** @brief True if everything staged so far is valid. */
+  bool validateTransaction();
+
+  /**
+   * @brief Validate and apply the staged keys (one revision bump, one flash write).
+   *
+   * The transaction is closed either way; on validation failure nothing changes.
+   */
+  bool commitTransaction(bool persist, uint8_t* changedSectionsOut = nullptr);
+
+  /** @brief Discard the staged keys. */
+  void rollbackTransaction();
+
+  /** @brief Roll back a transaction left open longer than CFG_TXN_TIMEOUT_MS. */
+  void expireStaleTransaction();
+
+  /**
+   * @brief Persist current settings to flash (no-op if identical to the last saved record).
    */
   bool save();
 
@@ -97,6 +207,9 @@ public:
     Power
   };
 
+  /** @brief Bit for section in a changed-sections mask. */
+  static constexpr uint8_t sectionBit(ConfigSection section) { return (uint8_t)(1u << (uint8_t)section); }
+
   /**
    * @brief Add settings fields (with secrets masked) to a JsonDocument.
    *
@@ -104,11 +217,28 @@ public:
    */
   void addMaskedConfigFields(JsonDocument& doc, ConfigSection section) const;
 
+  /** @brief Digest of the masked configuration (see settingsschema::digest). */
+  uint32_t configDigest() const;
+
+  /**
+   * @brief Compact MessagePack snapshot of the masked configuration.
+   * @return bytes written, or 0 if out is too small.
+   */
+  size_t encodeConfigSnapshot(uint8_t* out, size_t outLen) const;
+
   /**
    * @brief Monotonic revision that increments when runtime settings are updated.
    */
   uint32_t revision() const;
 
+  static constexpr size_t kMaxSubscribers = 6;
+
+  /**
+   * @brief Register sub for change notifications (sub must outlive the manager).
+   * @return false if all kMaxSubscribers slots are taken.
+   */
+  bool subscribe(SettingsSubscription& sub);
+
   /**
    * @brief Menu inquiry hook used to render check-marks for active option values.
    */
@@ -120,10 +250,35 @@ private:
   mutable rtos::Mutex _mx;
   AppSettings         _s;
   uint32_t            _revision = 0;
+  SettingsJournal     _journal;
+  bool                _hasPersisted = false;
+  uint32_t            _persistedCrc = 0;
+
+  // Scheduled-session override, see setSessionOverride(); 0 = stored value.
+  uint32_t _sessionSampleMs = 0;
+  uint32_t _sessionAggS     = 0;
+
+  SettingsSubscription* _subs[kMaxSubscribers] = {nullptr};
+  size_t                _subCount = 0;
+
+  // Staged transaction: only fields in _txTouched are copied on commit, so
+  // unrelated updates made while it is open are kept.
+  AppSettings _txStage;
+  uint32_t    _txTouched = 0;
+  uint32_t    _txStartMs = 0;
+  bool        _txOpen    = false;
+  bool        _txValid   = false;
 
   bool loadFromFlash();
   void setDefaults();
   void clampRuntimeSettingsUnlocked();
+  bool changedSince(const AppSettings& before) const;
+  void notifyUnlocked(const AppSettings& before);
+  void notifyUnlocked(const AppSettings& before, const AppSettings& after);
+  AppSettings effectiveUnlocked() const;
+  AppSettings storedCopy() const;
 
-  static uint32_t crc32(const uint8_t* data, size_t len);
+  bool stagePatchUnlocked(JsonObjectConst patch, AppSettings& stage, uint32_t& touched) const;
+  bool validateStageUnlocked(AppSettings& stage) const;
+  bool commitStageUnlocked(const AppSettings& stage, uint32_t touched, bool persist, uint8_t* changedSectionsOut);
 };
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SettingsManager.h"
+
+/**
+ * @brief Single description of every externally visible setting.
+ *
+ * One constexpr table (key, offset, type, bounds, secret flag, config
+ * section, notification group) drives /cfg parsing, clamping, masked config publishing, the menu
+ * check-marks, the serial console and the UI setup path. Adding a setting
+ * means adding one row in SettingsSchema.cpp (and the AppSettings member).
+ */
+namespace settingsschema {
+
+/** @brief Bumped whenever rows are added, removed or reordered (binary snapshot layout). */
+static constexpr uint8_t kSchemaVersion = 4;
+
+enum class FieldType : uint8_t {
+  U8 = 0,
+  U16,
+  U32,
+  F32,
+  Str
+};
+
+struct Field {
+  const char*                    key;       ///< JSON / menu property name
+  uint16_t                       offset;    ///< offsetof(AppSettings, member)
+  uint8_t                        size;      ///< sizeof(member), string capacity incl. NUL
+  FieldType                      type;
+  SettingsManager::ConfigSection section;   ///< chunk used for config publishing
+  SettingsGroup                  group;     ///< change-notification group
+  bool                           secret;    ///< masked as "***" when published/printed
+  uint32_t                       minValue;  ///< integer fields only
+  uint32_t                       maxValue;  ///< integer fields only
+  uint32_t                       fallback;  ///< applied when outside [minValue, maxValue]
+};
+
+/** @brief Number of rows in the schema. */
+size_t fieldCount();
+
+/** @brief Row i (0 <= i < fieldCount()), in config publishing order. */
+const Field& field(size_t i);
+
+/** @brief Look up a row by key, nullptr if unknown. */
+const Field* find(const char* key);
+
+/** @brief Row index of f (bit position in touched-field masks). */
+size_t indexOf(const Field& f);
+
+inline bool isNumeric(const Field& f) { return f.type != FieldType::Str; }
+
+/** @brief True if f belongs to section (ConfigSection::All matches every row). */
+bool inSection(const Field& f, SettingsManager::ConfigSection section);
+
+/** @brief Integer value of a U8/U16/U32 field. */
+uint32_t getUnsigned(const AppSettings& s, const Field& f);
+
+/** @brief Value of an F32 field. */
+float getFloat(const AppSettings& s, const Field& f);
+
+/** @brief Value of a Str field ("" for other types). */
+const char* getString(const AppSettings& s, const Field& f);
+
+/**
+ * @brief Write a JSON value into the field if its type matches.
+ * @return false if the value has the wrong type or range for the field.
+ */
+bool set(AppSettings& s, const Field& f, JsonVariantConst value);
+
+/** @brief Copy one field from src to dst. */
+void copyField(AppSettings& dst, const AppSettings& src, const Field& f);
+
+/** @brief SettingsManager::sectionBit() mask of sections whose fields differ. */
+uint8_t changedSections(const AppSettings& a, const AppSettings& b);
+
+/** @brief settingsGroupBit() mask of groups whose fields differ. */
+uint8_t changedGroups(const AppSettings& a, const AppSettings& b);
+
+/** @brief Replace an out-of-bounds integer value with the field's fallback. */
+void clamp(AppSettings& s, const Field& f);
+
+/** @brief Add f to doc under its key, masking secrets. */
+void addToJson(JsonDocument& doc, const AppSettings& s, const Field& f);
+
+/**
+ * @brief CRC32 over the masked values in table order.
+ *
+ * Integers are hashed as uint32 little-endian, floats as IEEE-754 float32,
+ * strings as their (masked) bytes plus NUL. Secrets only contribute "***"
+ * or "", so the digest does not leak them.
+ */
+uint32_t digest(const AppSettings& s);
+
+/**
+ * @brief MessagePack snapshot: [kSchemaVersion, digest, [values in table order]].
+ * @return bytes written, or 0 if out is too small.
+ */
+size_t encodeSnapshot(const AppSettings& s, uint8_t* out, size_t outLen);
+
+} // namespace settingsschema
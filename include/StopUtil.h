@@ -2,10 +2,43 @@
 
 #include <mbed.h>
 #include <stdint.h>
+#include <atomic>
 
 namespace stoputil {
 
+/**
+ * @brief Cooperative stop handshake between a thread and its owner.
+ *
+ * The owner calls request() and wakes the thread; the thread notices
+ * requested() at its next safe point, flushes what it holds, calls
+ * acknowledge() and returns from its entry function.
+ */
+class StopSignal {
+public:
+  void request() { _requested.store(true); }
+  bool requested() const { return _requested.load(); }
+  void acknowledge() { _ack.set(kAckFlag); }
+
+  /** @brief Wait for acknowledge(); false on timeout. */
+  bool waitAck(uint32_t timeoutMs);
+
+private:
+  static constexpr uint32_t kAckFlag = 1u << 0;
+
+  std::atomic<bool> _requested{false};
+  rtos::EventFlags  _ack;
+};
+
 // Terminate a thread and (best-effort) wait for it to become inactive.
 void terminateThread(const char* name, rtos::Thread& thread, uint32_t waitMs = 250);
 
+/**
+ * @brief Wait for a requested cooperative stop and join the thread.
+ *
+ * Falls back to terminateThread() if the thread does not acknowledge
+ * within ackTimeoutMs. Returns immediately for a thread that never started.
+ * @return true if the thread stopped cooperatively.
+ */
+bool awaitStop(const char* name, rtos::Thread& thread, StopSignal& signal, uint32_t ackTimeoutMs);
+
 } // namespace stoputil
@@ -54,16 +54,15 @@ struct SystemContext {
   SystemContext(Board& board, RestartReasonStore& rrStore, uint8_t wakePin)
       : settings(),
         sessionClock(),
-        eventBus(mailboxes.uiToOrchMail, mailboxes.commsToOrchMail, mailboxes.workerToOrchMail),
+        eventBus(mailboxes.uiToOrchMail, mailboxes.commsToOrchMail),
         commandBus(mailboxes.orchToCommsMail),
         commsEgress(commandBus, mailboxes.aggToCommsMail),
         uiThread(eventBus, settings, runtimeStatus),
-        samplingThread(mailboxes.sensorToAggMail, settings, sessionClock, eventBus, runtimeStatus),
-        aggThread(mailboxes.sensorToAggMail, commsEgress, settings, sessionClock,
-                  eventBus),
+        samplingThread(mailboxes.sensorToAggMail, settings, sessionClock, runtimeStatus),
+        aggThread(mailboxes.sensorToAggMail, commsEgress, settings, sessionClock, runtimeStatus),
         commsInbox(mailboxes.aggToCommsMail, mailboxes.orchToCommsMail),
         commsPump(commsInbox, eventBus, settings),
-        powerManager(board, rrStore, commsPump, uiThread, aggThread, samplingThread,
+        powerManager(board, rrStore, commsPump, uiThread, aggThread, samplingThread, settings,
                      wakePin),
         orchestrator(eventBus, commsEgress, settings, sessionClock, samplingThread, aggThread,
                      powerManager, runtimeStatus)
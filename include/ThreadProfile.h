@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief CPU and stack accounting for one thread.
+ *
+ * The thread reports when it goes to wait and when it runs again; the time
+ * in between waits is its busy time (including preemption and blocking
+ * driver calls that do not go through a profiled wait). roll() closes a
+ * measurement window and turns the busy time into a CPU share.
+ *
+ * Pure logic with no RTOS/board dependency: callers pass timestamps and
+ * stack readings, so the device feeds it from micros() and the RTX
+ * watermark and a host build from any clock.
+ */
+class ThreadProfile {
+public:
+  /** @brief Thread runs from nowUs (start, or back from a wait). */
+  void running(uint32_t nowUs);
+
+  /** @brief Thread blocks from nowUs. */
+  void waiting(uint32_t nowUs);
+
+  /**
+   * @brief Record a stack reading.
+   * @param freeBytes never-touched bytes; 0 means "no watermark", ignored.
+   */
+  void stack(uint32_t sizeBytes, uint32_t freeBytes);
+
+  /**
+   * @brief Close the window that lasted windowMs (wall time) and start the next.
+   * @param nowUs same clock as running()/waiting(), for a span still open.
+   */
+  void roll(uint32_t nowUs, uint32_t windowMs);
+
+  /** @brief Busy share of the last closed window, in permille. */
+  uint16_t cpuPermille() const { return _cpu; }
+
+  /** @brief Highest cpuPermille() seen. */
+  uint16_t peakCpuPermille() const { return _cpuPeak; }
+
+  /** @brief Busy time over all closed windows, ms. */
+  uint32_t busyMs() const { return (uint32_t)(_busyTotalUs / 1000u); }
+
+  uint32_t stackSize() const { return _stackSize; }
+
+  /** @brief Most stack ever used, bytes (0 if unknown). */
+  uint32_t stackPeak() const { return (_stackFree == 0u) ? 0u : (_stackSize - _stackFree); }
+
+private:
+  bool     _running     = false;
+  uint32_t _sinceUs     = 0;
+  uint32_t _windowUs    = 0; ///< busy time in the open window
+  uint64_t _busyTotalUs = 0;
+  uint16_t _cpu         = 0;
+  uint16_t _cpuPeak     = 0;
+  uint32_t _stackSize   = 0;
+  uint32_t _stackFree   = 0; ///< lowest reading, 0 = none yet
+};
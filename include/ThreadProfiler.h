@@ -0,0 +1,69 @@
+#pragma once
+
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Per-thread stack high-water and CPU share, for sizing STACK_*.
+ *
+ * Each profiled thread calls attach() once and wraps its blocking waits in
+ * Wait. The orchestrator calls sample() every THREAD_PROFILE_WINDOW_MS,
+ * which closes the CPU window and reads every stack's RTX watermark
+ * (osThreadGetStackSpace; stack figures read 0 if the RTOS build has no
+ * watermark). Results go to the serial console (threads) and to /metrics.
+ * The accounting itself is ThreadProfile.
+ */
+namespace threadprof {
+
+enum class Slot : uint8_t {
+  Main = 0, ///< Arduino loop(): comms pump, console, power manager
+  Orch,
+  Sens,
+  Agg,
+  Ui
+};
+
+static constexpr size_t kSlotCount = 5;
+
+struct Stats {
+  const char* name;
+  uint32_t    stackSize;
+  uint32_t    stackPeak;    ///< bytes, 0 if unknown
+  uint16_t    cpuPermille;  ///< last window
+  uint16_t    peakCpuPermille;
+  uint32_t    busyMs;
+};
+
+/** @brief Register the calling thread under slot; it counts as running. */
+void attach(Slot slot);
+
+/** @brief The thread of slot is about to block. */
+void waiting(Slot slot);
+
+/** @brief The thread of slot runs again. */
+void running(Slot slot);
+
+/** @brief waiting()/running() around a blocking call. */
+class Wait {
+public:
+  explicit Wait(Slot slot) : _slot(slot) { waiting(slot); }
+  ~Wait() { running(_slot); }
+
+  Wait(const Wait&)            = delete;
+  Wait& operator=(const Wait&) = delete;
+
+private:
+  Slot _slot;
+};
+
+/** @brief Close the CPU window and read the stacks. */
+void sample(uint32_t nowMs);
+
+/** @brief Figures for slot; false if its thread never attached. */
+bool stats(Slot slot, Stats& out);
+
+/** @brief Add "stk":[peak bytes] and "cpu":[permille], one entry per slot. */
+void addToJson(JsonDocument& doc);
+
+} // namespace threadprof
@@ -10,6 +10,7 @@
 #include "Messages.h"
 #include "RuntimeStatus.h"
 #include "SettingsManager.h"
+#include "StopUtil.h"
 
 /**
  * @brief UI thread: OLED (U8G2) + 4 keys.
@@ -22,6 +23,8 @@ public:
    * @brief Start RTOS thread.
    */
   void start();
+
+  /** @brief Let the thread finish its current key/render pass and exit. */
   void stop();
 
   /**
@@ -35,10 +38,11 @@ private:
   SettingsManager& _settings;
   RuntimeStatus& _runtimeStatus;
   LcdMenu   _menu;
-  uint32_t  _lastSettingsRevision = 0;
+  SettingsSubscription _settingsSub;  // any group: menu check-marks
   bool      _statusMode = true;
 
   rtos::Thread _thread;
+  stoputil::StopSignal _stop;
 
   mutable rtos::Mutex _mx;
   char                _line1[22] = "Hastig boot...";
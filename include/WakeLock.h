@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Deep-sleep locks for transactions that must not see Stop mode.
+ *
+ * With idle deep sleep enabled (powerutil::enableIdleDeepSleep) the M7
+ * enters Stop whenever every thread is blocked. Stop gates the UART clocks,
+ * so a modem session or an RS-485 exchange in progress would lose bytes;
+ * those hold a lock for their duration. Built on mbed's sleep manager, so
+ * locks taken by drivers (USB serial, ...) combine with these.
+ */
+namespace wakelock {
+
+enum class Holder : uint8_t {
+  Modem = 0,  ///< link up and wake window open (UART RX from the modem)
+  Rs485,      ///< sensor begin/sample exchange
+  Setting,    ///< lowPowerIdle switched off
+};
+
+static constexpr uint8_t kHolderCount = 3;
+
+void acquire(Holder holder);
+void release(Holder holder);
+
+/** @brief Bit (1 << Holder) set for each holder with a lock held. */
+uint8_t heldMask();
+
+/** @brief acquire()/release() for a block. */
+class Scope {
+public:
+  explicit Scope(Holder holder) : _holder(holder) { acquire(holder); }
+  ~Scope() { release(_holder); }
+
+  Scope(const Scope&)            = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  Holder _holder;
+};
+
+} // namespace wakelock
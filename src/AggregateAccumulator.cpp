@@ -0,0 +1,141 @@
+#include "AggregateAccumulator.h"
+
+#include <string.h>
+
+static void reset_stats(float& mn, float& mx, float& sum)
+{
+   mn  = 1e30f;
+   mx  = -1e30f;
+   sum = 0.0f;
+}
+
+void AggregateAccumulator::reset(uint32_t startMs)
+{
+   _t0 = startMs;
+   _t1 = startMs;
+   _n  = 0;
+   _ok = true;
+
+   _k0[0] = '\0';
+   _k1[0] = '\0';
+
+   reset_stats(_v0_min, _v0_max, _v0_sum);
+   reset_stats(_v1_min, _v1_max, _v1_sum);
+}
+
+void AggregateAccumulator::add(const SensorSampleMsg& s)
+{
+   if (_n == 0)
+   {
+      strncpy(_k0, s.k0, sizeof(_k0));
+      strncpy(_k1, s.k1, sizeof(_k1));
+      _k0[sizeof(_k0) - 1] = '\0';
+      _k1[sizeof(_k1) - 1] = '\0';
+      _t0                  = s.relMs;
+      _session             = s.session;
+   }
+
+   _t1 = s.relMs;
+
+   _v0_sum += s.v0;
+   if (s.v0 < _v0_min)
+      _v0_min = s.v0;
+   if (s.v0 > _v0_max)
+      _v0_max = s.v0;
+
+   if (_k1[0] != '\0')
+   {
+      _v1_sum += s.v1;
+      if (s.v1 < _v1_min)
+         _v1_min = s.v1;
+      if (s.v1 > _v1_max)
+         _v1_max = s.v1;
+   }
+
+   _ok = _ok && s.ok;
+   _n++;
+}
+
+bool AggregateAccumulator::emit(AggregateMsg& out, bool partial) const
+{
+   if (_n == 0)
+   {
+      return false;
+   }
+
+   memset(&out, 0, sizeof(out));
+   out.rel_start_ms = _t0;
+   out.rel_end_ms   = _t1;
+
+   strncpy(out.k0, _k0, sizeof(out.k0));
+   strncpy(out.k1, _k1, sizeof(out.k1));
+   out.k0[sizeof(out.k0) - 1] = '\0';
+   out.k1[sizeof(out.k1) - 1] = '\0';
+
+   out.n       = _n;
+   out.ok      = _ok;
+   out.partial = partial;
+
+   out.v0_avg = _v0_sum / (float)_n;
+   out.v0_min = _v0_min;
+   out.v0_max = _v0_max;
+
+   if (out.k1[0] != '\0')
+   {
+      out.v1_avg = _v1_sum / (float)_n;
+      out.v1_min = _v1_min;
+      out.v1_max = _v1_max;
+   }
+
+   return true;
+}
+
+void AggregateAssembler::noteSession(uint32_t session, const char* serverId)
+{
+   if (!_cur.known || _cur.session != session)
+   {
+      _prev        = _cur;
+      _cur.known   = true;
+      _cur.session = session;
+   }
+   strncpy(_cur.id, (serverId != nullptr) ? serverId : "", sizeof(_cur.id));
+   _cur.id[sizeof(_cur.id) - 1] = '\0';
+}
+
+bool AggregateAssembler::add(const SensorSampleMsg& s, AggregateMsg& closed)
+{
+   bool emitted = false;
+   if (!_acc.accepts(s))
+   {
+      // Session changed under the open window (stragglers, or a new session
+      // without a stop): what is there is complete.
+      emitted = close(true, closed);
+   }
+   _acc.add(s);
+   return emitted;
+}
+
+bool AggregateAssembler::close(bool partial, AggregateMsg& out)
+{
+   if (!_acc.emit(out, partial))
+   {
+      return false;
+   }
+   stamp(out);
+   _acc.reset(0);
+   return true;
+}
+
+void AggregateAssembler::stamp(AggregateMsg& out) const
+{
+   out.sessionId[0] = '\0';
+   const uint32_t session = _acc.session();
+   const Tag*     tag     = (_cur.known && _cur.session == session)    ? &_cur
+                            : (_prev.known && _prev.session == session) ? &_prev
+                                                                        : nullptr;
+   if (tag != nullptr)
+   {
+      strncpy(out.sessionId, tag->id, sizeof(out.sessionId));
+      out.sessionId[sizeof(out.sessionId) - 1] = '\0';
+   }
+}
@@ -0,0 +1,20 @@
+#include "AggregateDrain.h"
+
+uint8_t AggregateDrain::run(Port& port, uint8_t maxPerPass)
+{
+  uint8_t published = 0;
+  while (published < maxPerPass && port.linkUp()) {
+    AggregateMsg* a = (_held != nullptr) ? _held : port.take();
+    if (a == nullptr) {
+      break;
+    }
+    if (!port.publish(*a)) {
+      _held = a;
+      break;
+    }
+    _held = nullptr;
+    port.release(a);
+    published++;
+  }
+  return published;
+}
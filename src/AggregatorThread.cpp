@@ -1,6 +1,9 @@
 #include "AggregatorThread.h"
 
 #include "Logger.h"
+#include "Metrics.h"
+#include "ThreadProfiler.h"
+#include "PowerPolicy.h"
 #include "StopUtil.h"
 #include <Arduino.h>
 #include <chrono>
@@ -10,181 +13,238 @@ using namespace std::chrono;
 
 static const char* TAG = "AGG";
 
-static void reset_stats(float& mn, float& mx, float& sum)
+AggregatorThread::AggregatorThread(AggInMail<QUEUE_DEPTH_SENSOR_TO_AGG>& inMail,
+                                   CommsEgress& commsEgress, SettingsManager& settings,
+                                   SessionClock& clock, RuntimeStatus& runtimeStatus)
+    : _inMail(inMail), _commsEgress(commsEgress), _settings(settings), _clock(clock),
+      _runtimeStatus(runtimeStatus)
 {
-   mn  = 1e30f;
-   mx  = -1e30f;
-   sum = 0.0f;
 }
 
-void AggregateAccumulator::reset(uint32_t startMs)
+void AggregatorThread::start()
 {
-   _t0 = startMs;
-   _t1 = startMs;
-   _n  = 0;
-   _ok = true;
-
-   _k0[0] = '\0';
-   _k1[0] = '\0';
+   // The thread blocks on the mailbox, which event flags cannot wake.
+   _settingsSub.interest = settingsGroupBit(SettingsGroup::Schedule);
+   _settingsSub.wake     = AggregatorThread::wakeEntry;
+   _settingsSub.wakeCtx  = this;
+   (void)_settings.subscribe(_settingsSub);
 
-   reset_stats(_v0_min, _v0_max, _v0_sum);
-   reset_stats(_v1_min, _v1_max, _v1_sum);
+   _thread.start(mbed::callback(AggregatorThread::threadEntry, this));
 }
 
-void AggregateAccumulator::add(const SensorSampleMsg& s)
+void AggregatorThread::stop()
 {
-   if (_n == 0)
-   {
-      strncpy(_k0, s.k0, sizeof(_k0));
-      strncpy(_k1, s.k1, sizeof(_k1));
-      _k0[sizeof(_k0) - 1] = '\0';
-      _k1[sizeof(_k1) - 1] = '\0';
-      _t0                  = s.relMs;
-   }
-
-   _t1 = s.relMs;
-
-   _v0_sum += s.v0;
-   if (s.v0 < _v0_min)
-      _v0_min = s.v0;
-   if (s.v0 > _v0_max)
-      _v0_max = s.v0;
-
-   if (_k1[0] != '\0')
-   {
-      _v1_sum += s.v1;
-      if (s.v1 < _v1_min)
-         _v1_min = s.v1;
-      if (s.v1 > _v1_max)
-         _v1_max = s.v1;
-   }
-
-   _ok = _ok && s.ok;
-   _n++;
+   _stop.request();
+   _enabled.store(false);
+   wake();
+   (void)stoputil::awaitStop("AggregatorThread", _thread, _stop, THREAD_STOP_ACK_MS);
 }
 
-bool AggregateAccumulator::emit(AggregateMsg& out) const
+void AggregatorThread::setEnabled(bool en)
 {
-   if (_n == 0)
-   {
-      return false;
-   }
-
-   memset(&out, 0, sizeof(out));
-   out.rel_start_ms = _t0;
-   out.rel_end_ms   = _t1;
-
-   strncpy(out.k0, _k0, sizeof(out.k0));
-   strncpy(out.k1, _k1, sizeof(out.k1));
-   out.k0[sizeof(out.k0) - 1] = '\0';
-   out.k1[sizeof(out.k1) - 1] = '\0';
-
-   out.n  = _n;
-   out.ok = _ok;
-
-   out.v0_avg = _v0_sum / (float)_n;
-   out.v0_min = _v0_min;
-   out.v0_max = _v0_max;
-
-   if (out.k1[0] != '\0')
+   _enabled.store(en);
+   if (!en)
    {
-      out.v1_avg = _v1_sum / (float)_n;
-      out.v1_min = _v1_min;
-      out.v1_max = _v1_max;
+      _flags.set(FLAG_FLUSH);
    }
-
-   return true;
+   wake();
 }
 
-AggregatorThread::AggregatorThread(AggInMail<QUEUE_DEPTH_SENSOR_TO_AGG>& inMail,
-                                   CommsEgress& commsEgress, SettingsManager& settings,
-                                   SessionClock& clock, EventBus& eventBus)
-    : _inMail(inMail), _commsEgress(commsEgress), _settings(settings), _clock(clock),
-      _eventBus(eventBus)
-{
-}
-
-void AggregatorThread::start()
+/**
+ * @brief Queue a wake-up in the sample mailbox, where the thread blocks.
+ *
+ * No room means the mailbox holds samples, so the thread wakes anyway.
+ */
+void AggregatorThread::wake()
 {
-   _thread.start(mbed::callback(AggregatorThread::threadEntry, this));
+   SensorSampleMsg* m = _inMail.try_alloc();
+   if (m == nullptr)
+   {
+      return;
+   }
+   memset(m, 0, sizeof(*m));
+   m->wake = true;
+   _inMail.put(m);
 }
 
-void AggregatorThread::stop()
+void AggregatorThread::threadEntry(void* ctx)
 {
-   stoputil::terminateThread("AggregatorThread", _thread);
+   static_cast<AggregatorThread*>(ctx)->run();
 }
 
-void AggregatorThread::setEnabled(bool en)
+void AggregatorThread::wakeEntry(void* ctx)
 {
-   _enabled.store(en);
-   _flags.set(FLAG_WAKE);
+   static_cast<AggregatorThread*>(ctx)->wake();
 }
 
-void AggregatorThread::threadEntry(void* ctx)
+void AggregatorThread::refreshWindow()
 {
-   static_cast<AggregatorThread*>(ctx)->run();
+   _windowStretch = _runtimeStatus.powerStretch();
+   _windowMs      = PowerPolicy::scale(_settings.getCopy().agg_period_s * 1000u, _windowStretch);
 }
 
 void AggregatorThread::run()
 {
+   threadprof::attach(threadprof::Slot::Agg);
    LOGI(TAG, "Thread started");
+   refreshWindow();
 
-   while (true)
+   while (!_stop.requested())
    {
       if (!_enabled.load())
       {
-         _flags.wait_any(FLAG_WAKE);
-         _flags.clear(FLAG_WAKE);
+         // Wait on the mailbox: a sample that was in flight when sampling
+         // stopped arrives after the flush and goes out right away, under the
+         // session it was timed in. setEnabled() and stop() send a wake-up.
+         _flags.clear(FLAG_FLUSH);
+         if (takeNext(rtos::Kernel::wait_for_u32_forever))
+         {
+            drain();
+            closeWindow(true);
+         }
          continue;
       }
 
-      const AppSettings s        = _settings.getCopy();
-      const uint32_t    windowMs = s.agg_period_s * 1000u;
+      if (_settingsSub.consume() != 0u || _runtimeStatus.powerStretch() != _windowStretch)
+      {
+         refreshWindow();
+      }
 
-      AggregateAccumulator acc;
-      acc.reset(_clock.relMs());
+      // A flush for a window that is not running yet has nothing to close.
+      _flags.clear(FLAG_FLUSH);
+      noteSession();
 
       const uint32_t startWall = millis();
+      bool           partial   = false;
 
-      while (_enabled.load())
+      while (true)
       {
-         SensorSampleMsg* sm = _inMail.try_get_for(milliseconds(50));
-         if (sm != nullptr)
+         // Block until a sample, a wake-up (flush, stop, new period) or the
+         // window end. A new power stretch is seen at the next sample.
+         const uint32_t elapsed = millis() - startWall;
+         const uint32_t waitMs  = (elapsed < _windowMs) ? (_windowMs - elapsed) : 0u;
+         (void)takeNext(milliseconds(waitMs));
+
+         if (_settingsSub.consume() != 0u || _runtimeStatus.powerStretch() != _windowStretch)
          {
-            acc.add(*sm);
-            _inMail.free(sm);
-            LOGD(TAG, "Consumed sample");
+            // New period (or battery stretch) applies to the running window.
+            refreshWindow();
+            LOGI(TAG, "Aggregation window now %lu ms", (unsigned long)_windowMs);
          }
 
-         if ((uint32_t)(millis() - startWall) >= windowMs)
+         if ((_flags.get() & FLAG_FLUSH) != 0u || !_enabled.load())
+         {
+            // Stopped mid-window: what the sampler already produced belongs here,
+            // not to the next session's first window.
+            _flags.clear(FLAG_FLUSH);
+            drain();
+            partial = true;
+            break;
+         }
+
+         if ((uint32_t)(millis() - startWall) >= _windowMs)
          {
             break;
          }
       }
 
-      AggregateMsg out;
-      if (!acc.emit(out))
+      if (partial)
       {
-         continue;
+         LOGI(TAG, "Flushing partial window after %lu ms", (unsigned long)(millis() - startWall));
       }
-      out.sessionId[0] = '\0';
-      (void)_clock.getServerSessionId(out.sessionId, sizeof(out.sessionId));
+      closeWindow(partial);
+   }
+
+   // Samples the stopped sampler produced after the last flush form a last window.
+   drain();
+   closeWindow(true);
+
+   LOGI(TAG, "Thread stopped");
+   _stop.acknowledge();
+}
+
+/**
+ * @brief Remember the clock's current session and its id for stamping.
+ */
+void AggregatorThread::noteSession()
+{
+   char     id[sizeof(AggregateMsg::sessionId)];
+   uint32_t session = 0;
+   (void)_clock.getServerSessionId(id, sizeof(id), &session);
+   _windows.noteSession(session, id);
+}
+
+/**
+ * @brief Wait up to timeout for the next mailbox entry and take it.
+ * @return false on timeout
+ */
+bool AggregatorThread::takeNext(rtos::Kernel::Clock::duration_u32 timeout)
+{
+   SensorSampleMsg* sm = nullptr;
+   {
+      threadprof::Wait wait(threadprof::Slot::Agg);
+      sm = _inMail.try_get_for(timeout);
+   }
+   if (sm == nullptr)
+   {
+      return false;
+   }
+   if (!sm->wake)
+   {
+      metrics::dequeued(metrics::Queue::SensorToAgg);
+      take(*sm);
+      LOGD(TAG, "Consumed sample");
+   }
+   _inMail.free(sm);
+   return true;
+}
 
-      if (!_commsEgress.sendAggregate(out))
+void AggregatorThread::take(const SensorSampleMsg& s)
+{
+   AggregateMsg closed;
+   if (_windows.add(s, closed))
+   {
+      publish(closed);
+   }
+}
+
+void AggregatorThread::drain()
+{
+   SensorSampleMsg* sm = nullptr;
+   while ((sm = _inMail.try_get()) != nullptr)
+   {
+      if (!sm->wake)
       {
-         LOGW(TAG, "Drop aggregate: comms egress full");
-         continue;
+         metrics::dequeued(metrics::Queue::SensorToAgg);
+         take(*sm);
       }
+      _inMail.free(sm);
+   }
+}
 
-      LOGI(TAG, "Produced aggregate %s/%s n=%lu", out.k0, out.k1, (unsigned long)out.n);
+void AggregatorThread::closeWindow(bool partial)
+{
+   // The session may have changed since the window opened; its id is kept.
+   noteSession();
+   AggregateMsg out;
+   if (_windows.close(partial, out))
+   {
+      publish(out);
+   }
+}
 
-      WorkerEventMsg w;
-      memset(&w, 0, sizeof(w));
-      w.type  = WorkerEventType::AggregateReady;
-      w.ts_ms = millis();
-      w.relMs = out.rel_end_ms;
-      w.n     = out.n;
-      w.ok    = out.ok;
-      _eventBus.publishWorker(w);
+/**
+ * @brief Send a finished aggregate toward comms.
+ */
+void AggregatorThread::publish(const AggregateMsg& out)
+{
+   if (!_commsEgress.sendAggregate(out))
+   {
+      LOGW(TAG, "Drop aggregate: comms egress full");
+      return;
    }
+
+   metrics::count(metrics::Counter::AggregatesProduced);
+   LOGI(TAG, "Produced aggregate %s/%s n=%lu%s", out.k0, out.k1, (unsigned long)out.n,
+        out.partial ? " (partial)" : "");
 }
@@ -203,6 +203,7 @@ BoardHal::BatterySnapshot BoardHal::readBattery(Battery& battery)
   s.minimumVoltage = battery.minimumVoltage();
   s.current        = battery.current();
   s.averageCurrent = battery.averageCurrent();
+  s.remainingMah   = battery.remainingCapacity();
   return s;
 }
 
@@ -253,7 +254,11 @@ void BoardHal::getHardwareId(char* out, size_t outSize)
 
 bool BoardHal::detectFactoryResetButtonCombo(uint32_t windowMs, uint32_t holdMs)
 {
-  // Factory reset at boot: hold UP+DOWN (active-low buttons).
+  // Factory reset at boot: hold UP+DOWN (active-low buttons) while powering on.
+  if (digitalRead(PIN_BTN_UP) == HIGH && digitalRead(PIN_BTN_DOWN) == HIGH) {
+    return false;
+  }
+
   uint32_t comboStart           = 0;
   const uint32_t bootWindowStart = millis();
   while ((uint32_t)(millis() - bootWindowStart) < windowMs) {
@@ -0,0 +1,70 @@
+#include "BootTimeline.h"
+
+#include "Logger.h"
+#include "TimeUtil.h"
+
+static const char* TAG = "BOOT";
+
+namespace boottimeline {
+
+namespace {
+
+struct Stage {
+  const char* name;
+  uint32_t    ms;
+};
+
+static Stage  g_stages[kMaxStages];
+static size_t g_count = 0;
+
+} // namespace
+
+void mark(const char* stage)
+{
+  if (g_count >= kMaxStages) {
+    return;
+  }
+  g_stages[g_count].name = stage;
+  g_stages[g_count].ms   = timeutil::nowMs();
+  g_count++;
+}
+
+void markOnce(const char* stage)
+{
+  const size_t n = count();
+  for (size_t i = 0; i < n; i++) {
+    if (g_stages[i].name == stage) {
+      return;
+    }
+  }
+  mark(stage);
+}
+
+size_t count()
+{
+  return g_count;
+}
+
+void log()
+{
+  const size_t n    = count();
+  uint32_t     prev = 0;
+  for (size_t i = 0; i < n; i++) {
+    LOGI(TAG, "%-10s %6lu ms (+%lu)",
+         g_stages[i].name,
+         (unsigned long)g_stages[i].ms,
+         (unsigned long)(g_stages[i].ms - prev));
+    prev = g_stages[i].ms;
+  }
+}
+
+void addToJson(JsonDocument& doc, const char* key)
+{
+  JsonObject obj = doc[key].to<JsonObject>();
+  const size_t n = count();
+  for (size_t i = 0; i < n; i++) {
+    obj[g_stages[i].name] = g_stages[i].ms;
+  }
+}
+
+} // namespace boottimeline
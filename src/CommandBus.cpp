@@ -3,6 +3,7 @@
 #include <cstring>
 
 #include "Logger.h"
+#include "Metrics.h"
 #include "TimeUtil.h"
 
 static const char* TAG = "CMDBUS";
@@ -10,19 +11,28 @@ static const char* TAG = "CMDBUS";
 bool CommandBus::sendToComms(OrchCommandType type, const char* payloadOrNull) {
   OrchCommandMsg* msg = _orchToCommsMail.try_alloc();
   if (msg == nullptr) {
+    metrics::queueFull(metrics::Queue::OrchToComms);
     LOGW(TAG, "sendToComms: alloc failed");
     return false;
   }
 
   msg->type = type;
   msg->ts_ms = timeutil::nowMs();
-  if (payloadOrNull != nullptr) {
-    strncpy(msg->payload, payloadOrNull, sizeof(msg->payload) - 1);
-    msg->payload[sizeof(msg->payload) - 1] = '\0';
-  } else {
-    msg->payload[0] = '\0';
+  msg->payload = PayloadRef{};
+  if (payloadOrNull != nullptr && payloadOrNull[0] != '\0') {
+    if (!payloadpool::store(payloadOrNull, msg->payload)) {
+      LOGW(TAG, "sendToComms: payload pool exhausted");
+      _orchToCommsMail.free(msg);
+      return false;
+    }
   }
 
-  _orchToCommsMail.put(msg);
+  if (_orchToCommsMail.put(msg) != osOK) {
+    LOGW(TAG, "sendToComms: put failed");
+    payloadpool::release(msg->payload);
+    _orchToCommsMail.free(msg);
+    return false;
+  }
+  metrics::enqueued(metrics::Queue::OrchToComms);
   return true;
 }
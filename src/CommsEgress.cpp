@@ -5,7 +5,10 @@
 
 #include "CommsCommands.h"
 #include "CommandBus.h"
+#include "EnergyLedger.h"
 #include "Logger.h"
+#include "Metrics.h"
+#include "PowerUtil.h"
 #include "ProtocolCodec.h"
 #include "BoardHal.h"
 
@@ -27,12 +30,14 @@ bool CommsEgress::sendAggregate(const AggregateMsg& msg)
 {
   AggregateMsg* out = _aggToCommsMail.try_alloc();
   if (out == nullptr) {
+    metrics::queueFull(metrics::Queue::AggToComms);
     LOGW(TAG, "sendAggregate: alloc failed (mail full)");
     return false;
   }
 
   memcpy(out, &msg, sizeof(*out));
   _aggToCommsMail.put(out);
+  metrics::enqueued(metrics::Queue::AggToComms);
   return true;
 }
 
@@ -55,7 +60,7 @@ bool CommsEgress::publishModeChange(const char* mode, const char* previousMode)
   return sendOrchCommand(_commandBus, OrchCommandType::PublishAwake, out);
 }
 
-bool CommsEgress::publishStatus(const BoardHal::BatterySnapshot& bs, const char* mode)
+bool CommsEgress::publishStatus(const BoardHal::BatterySnapshot& bs, const char* mode, uint16_t powerStretch)
 {
   JsonDocument st;
   st["type"]           = "status";
@@ -65,10 +70,15 @@ bool CommsEgress::publishStatus(const BoardHal::BatterySnapshot& bs, const char*
   st["minimumVoltage"] = bs.minimumVoltage;
   st["batteryCurrent"] = bs.current;
   st["averageCurrent"] = bs.averageCurrent;
+  energyledger::addToJson(st, bs.remainingMah);
+  st["idleStop"] = powerutil::idleDeepSleepActive();
+  if (powerStretch != 1000u) {
+    st["powerStretch"] = powerStretch;
+  }
 
   char out[384];
   serializeJson(st, out, sizeof(out));
-  return publishAwakeJson(out);
+  return sendOrchCommand(_commandBus, OrchCommandType::PublishStatus, out);
 }
 
 bool CommsEgress::publishLowBatteryAlert(const BoardHal::BatterySnapshot& bs, const char* mode)
@@ -94,9 +104,15 @@ bool CommsEgress::publishAwakeJson(const char* json)
   return sendOrchCommand(_commandBus, OrchCommandType::PublishAwake, json);
 }
 
-bool CommsEgress::publishConfig()
+bool CommsEgress::publishConfig(bool binary, bool hasDigest, uint32_t digest)
 {
-  return sendOrchCommand(_commandBus, OrchCommandType::PublishConfig, nullptr);
+  if (!binary && !hasDigest) {
+    return sendOrchCommand(_commandBus, OrchCommandType::PublishConfig, nullptr);
+  }
+
+  char opts[64];
+  (void)protocol::encodeConfigRequest(binary, hasDigest, digest, opts, sizeof(opts));
+  return sendOrchCommand(_commandBus, OrchCommandType::PublishConfig, opts);
 }
 
 bool CommsEgress::applySettingsJson(const char* json)
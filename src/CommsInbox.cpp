@@ -1,5 +1,7 @@
 #include "CommsInbox.h"
 
+#include "Metrics.h"
+
 CommsInbox::CommsInbox(AggMailT& aggToCommsMail, OrchToCommsMailT& orchToCommsMail)
     : _aggToCommsMail(aggToCommsMail),
       _orchToCommsMail(orchToCommsMail)
@@ -8,20 +10,44 @@ CommsInbox::CommsInbox(AggMailT& aggToCommsMail, OrchToCommsMailT& orchToCommsMa
 
 OrchCommandMsg* CommsInbox::tryGetOrch()
 {
-  return _orchToCommsMail.try_get();
+  OrchCommandMsg* msg = _orchToCommsMail.try_get();
+  if (msg != nullptr) {
+    metrics::dequeued(metrics::Queue::OrchToComms);
+  }
+  return msg;
 }
 
 void CommsInbox::freeOrch(OrchCommandMsg* msg)
 {
+  payloadpool::release(msg->payload);
   _orchToCommsMail.free(msg);
 }
 
 AggregateMsg* CommsInbox::tryGetAggregate()
 {
-  return _aggToCommsMail.try_get();
+  AggregateMsg* msg = _aggToCommsMail.try_get();
+  if (msg != nullptr) {
+    metrics::dequeued(metrics::Queue::AggToComms);
+  }
+  return msg;
 }
 
 void CommsInbox::freeAggregate(AggregateMsg* msg)
 {
   _aggToCommsMail.free(msg);
 }
+
+bool CommsInbox::aggregatesFull() const
+{
+  return _aggToCommsMail.full();
+}
+
+bool CommsInbox::aggregatesEmpty() const
+{
+  return _aggToCommsMail.empty();
+}
+
+bool CommsInbox::orchEmpty() const
+{
+  return _orchToCommsMail.empty();
+}
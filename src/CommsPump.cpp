@@ -1,6 +1,13 @@
 #include "CommsPump.h"
 #include "BoardHal.h"
+#include "BootTimeline.h"
+#include "CrashLog.h"
+#include "EnergyLedger.h"
+#include "Metrics.h"
+#include "ThreadProfiler.h"
+#include "WakeLock.h"
 #include "ProtocolCodec.h"
+#include "SettingsSchema.h"
 #include "Logger.h"
 #include "TimeUtil.h"
 
@@ -10,6 +17,8 @@
 #include <string.h>
 #include <GSM.h>
 #include <PubSubClient.h>
+#include <CellularDevice.h>
+#include <ATHandler.h>
 #include <platform/ScopedLock.h>
 
 #include <chrono>
@@ -18,6 +27,8 @@ using namespace std::chrono;
 static const char* TAG = "COMMS";
 static constexpr size_t MAX_CONFIG_PAYLOAD_BYTES = 320;
 static constexpr uint8_t CONFIG_CHUNK_TOTAL = 5;
+// publishJson() serializes into a stack buffer this size (JSON plus terminator).
+static constexpr size_t PUBLISH_JSON_BUF_BYTES = 512;
 
 CommsPump* CommsPump::_self = nullptr;
 
@@ -44,18 +55,50 @@ CommsPump::CommsPump(CommsInbox& inbox,
  */
 void CommsPump::begin()
 {
-  _bootMs = timeutil::nowMs();
+  _bootMs        = timeutil::nowMs();
+  _lastMetricsMs = _bootMs;
   mqtt.setCallback(CommsPump::mqttCallbackTrampoline);
   mqtt.setSocketTimeout(2);
-  mqtt.setKeepAlive(30);
+  _dutySub.interest = settingsGroupBit(SettingsGroup::Schedule);
+  (void)_settings.subscribe(_dutySub);
+  updateDutyCycle();
+  mqtt.setKeepAlive(_duty.keepAliveS(MQTT_MIN_KEEPALIVE_S));
   postEvent(CommsEventType::Boot, "boot", "comms pump ready");
 }
 
+/**
+ * @brief Start the cellular attach from setup(), after the worker threads.
+ *
+ * GSM must be driven from the main context; doing it here lets UI, sensor
+ * warmup and orchestrator start-up run in their threads meanwhile.
+ */
+bool CommsPump::attachNetwork()
+{
+  if (_offline) {
+    return false;
+  }
+  return ensureNetwork();
+}
+
+void CommsPump::holdOffline(uint32_t durationMs)
+{
+  _offline        = true;
+  _offlineUntilMs = timeutil::nowMs() + durationMs;
+  LOGI(TAG, "Radio held off for %lu ms (scheduled session)", (unsigned long)durationMs);
+}
+
 void CommsPump::prepareHibernate()
 {
-  _wantConnected = false;
   _hibernatePending = true;
-  teardownLinks(false);
+  _metricsOnSleep   = true;
+}
+
+bool CommsPump::outboxDrained() const
+{
+  // Also with the link down: queued data is not "drained" just because it
+  // cannot leave. PowerManager's grace period bounds the wait.
+  return _inbox.orchEmpty() && !_heldMode.valid && !_heldConfig.valid && _inbox.aggregatesEmpty() &&
+         !_drain.holding() && _pendingStatus.ptr == nullptr && !_metricsOnSleep;
 }
 
 /**
@@ -67,10 +110,33 @@ void CommsPump::postEvent(CommsEventType type, const char* topic, const char* pa
   e.type  = type;
   e.ts_ms = timeutil::nowMs();
 
-  strncpy(e.topic, topic ? topic : "", sizeof(e.topic));
-  strncpy(e.payload, payload ? payload : "", sizeof(e.payload));
-  e.topic[sizeof(e.topic) - 1]     = '\0';
-  e.payload[sizeof(e.payload) - 1] = '\0';
+  if (!payloadpool::store(topic, e.topic) || !payloadpool::store(payload, e.payload)) {
+    LOGW(TAG, "postEvent: payload pool exhausted (type=%u)", (unsigned)type);
+    payloadpool::release(e.topic);
+    payloadpool::release(e.payload);
+    return;
+  }
+
+  // EventBus takes ownership of the pooled strings.
+  (void)_eventBus.publish(e);
+}
+
+/**
+ * @brief Post a decoded server command to orchestrator.
+ */
+void CommsPump::postCommand(const char* topic, const protocol::Command& cmd)
+{
+  CommsEventMsg e;
+  e.type  = CommsEventType::ServerCommand;
+  e.ts_ms = timeutil::nowMs();
+
+  if (!payloadpool::store(topic, e.topic) || !payloadpool::alloc(sizeof(cmd), e.payload)) {
+    LOGW(TAG, "postCommand: payload pool exhausted");
+    payloadpool::release(e.topic);
+    payloadpool::release(e.payload);
+    return;
+  }
+  memcpy(e.payload.ptr, &cmd, sizeof(cmd));
 
   (void)_eventBus.publish(e);
 }
@@ -78,27 +144,219 @@ void CommsPump::postEvent(CommsEventType type, const char* topic, const char* pa
 /**
  * @brief Handle orchestrator command.
  */
-void CommsPump::handleOrchCommand(const OrchCommandMsg& cmd)
+void CommsPump::handleOrchCommand(OrchCommandMsg& cmd)
 {
   switch (cmd.type) {
     case OrchCommandType::PublishAwake:
-      (void)publishStatus("aware", cmd.payload[0] ? cmd.payload : nullptr);
+      _duty.openNow(timeutil::nowMs());
+      (void)publishStatus("aware", (cmd.payload.ptr != nullptr) ? cmd.payload.ptr : nullptr, true);
       break;
     case OrchCommandType::PublishHibernating:
-      (void)publishStatus("hibernating", cmd.payload[0] ? cmd.payload : nullptr);
+      _duty.openNow(timeutil::nowMs());
+      (void)publishStatus("hibernating", (cmd.payload.ptr != nullptr) ? cmd.payload.ptr : nullptr);
+      break;
+    case OrchCommandType::PublishStatus:
+      // Keep only the latest periodic status; it leaves with the next wake window.
+      payloadpool::release(_pendingStatus);
+      _pendingStatus   = cmd.payload;
+      _pendingStatusMs = timeutil::nowMs();
+      cmd.payload      = PayloadRef{};
       break;
     case OrchCommandType::PublishConfig:
-      (void)publishConfigSnapshot();
+      _duty.openNow(timeutil::nowMs());
+      (void)publishConfigSnapshot(cmd.payload.ptr);
       break;
-    case OrchCommandType::ApplySettingsJson:
-      _settings.applyJson(cmd.payload, true);
-      _topicCmd[0] = '\0';
+    case OrchCommandType::ApplySettingsJson: {
+      uint8_t changed = 0;
+      (void)_settings.applyJson(payloadpool::str(cmd.payload), true, &changed);
+      requestRelink(changed);
       break;
+    }
     default:
       break;
   }
 }
 
+/**
+ * @brief Handle an orchestrator command during the offline hold without the radio.
+ *
+ * Periodic status coalesces as usual and settings apply locally; mode and
+ * config publishes are parked latest-wins until the hold ends.
+ */
+void CommsPump::deferOrchCommand(OrchCommandMsg& cmd)
+{
+  switch (cmd.type) {
+    case OrchCommandType::PublishAwake:
+    case OrchCommandType::PublishHibernating:
+      holdCommand(_heldMode, cmd);
+      break;
+    case OrchCommandType::PublishConfig:
+      holdCommand(_heldConfig, cmd);
+      break;
+    default:
+      handleOrchCommand(cmd);
+      break;
+  }
+}
+
+/**
+ * @brief Park a command in a held slot, replacing (and releasing) an older one.
+ */
+void CommsPump::holdCommand(HeldCommand& slot, OrchCommandMsg& cmd)
+{
+  if (slot.valid) {
+    payloadpool::release(slot.msg.payload);
+  }
+  slot.msg    = cmd;
+  slot.valid  = true;
+  cmd.payload = PayloadRef{};
+}
+
+/**
+ * @brief Send what was parked during the offline hold.
+ */
+void CommsPump::replayHeldCommands()
+{
+  HeldCommand* const slots[] = {&_heldMode, &_heldConfig};
+  for (HeldCommand* slot : slots) {
+    if (!slot->valid) {
+      continue;
+    }
+    handleOrchCommand(slot->msg);
+    payloadpool::release(slot->msg.payload);
+    slot->valid = false;
+  }
+}
+
+/**
+ * @brief Note which links a committed settings change invalidates.
+ *
+ * Only network (SIM/APN) changes restart the modem session and only MQTT
+ * changes reconnect the broker; everything else is picked up in place.
+ */
+void CommsPump::requestRelink(uint8_t changedSections)
+{
+  if ((changedSections & SettingsManager::sectionBit(SettingsManager::ConfigSection::Network)) != 0u) {
+    _relink = Relink::Network;
+  } else if ((changedSections & SettingsManager::sectionBit(SettingsManager::ConfigSection::Mqtt)) != 0u &&
+             _relink == Relink::None) {
+    _relink = Relink::Mqtt;
+  }
+  if ((changedSections & SettingsManager::sectionBit(SettingsManager::ConfigSection::Device)) != 0u) {
+    _topicsCheckPending = true;
+  }
+}
+
+void CommsPump::applyPendingRelink()
+{
+  if (_relink == Relink::Network) {
+    LOGI(TAG, "Network settings changed: restarting cellular session");
+    teardownLinks(true);
+  } else if (_relink == Relink::Mqtt) {
+    LOGI(TAG, "MQTT settings changed: reconnecting broker");
+    {
+      mbed::ScopedLock<rtos::Mutex> lock(gsmMx);
+      if (mqtt.connected()) {
+        mqtt.disconnect();
+      }
+    }
+    teardownLinks(false);
+  }
+  _relink = Relink::None;
+
+  // Device name drives the topics; resubscribe in place if it changed.
+  if (_topicsCheckPending) {
+    _topicsCheckPending = false;
+    if (refreshTopics(_settings.getCopy()) && mqtt.connected()) {
+      (void)ensureMqtt();
+    }
+  }
+}
+
+/**
+ * @brief Recompute the wake-window schedule when settings change.
+ *
+ * Period is the status interval, capped so that half the agg->comms mail
+ * depth worth of aggregates is the most that can queue up between windows.
+ */
+void CommsPump::updateDutyCycle()
+{
+  if (_dutySub.consume() == 0u && _dutyConfigured) {
+    return;
+  }
+  _dutyConfigured = true;
+
+  const AppSettings s = _settings.getCopy();
+  uint32_t periodMs = s.status_interval_s * 1000u;
+  const uint32_t aggCapMs = s.agg_period_s * 1000u * (QUEUE_DEPTH_AGG_TO_COMMS / 2u);
+  if (aggCapMs > 0u && aggCapMs < periodMs) {
+    periodMs = aggCapMs;
+  }
+
+  _duty.configure(RADIO_DUTY_CYCLE_ENABLED, periodMs, RADIO_WAKE_WINDOW_MS);
+
+  // With duty cycling, data leaves once per window rather than once per aggregate.
+  _dataIntervalMs = s.agg_period_s * 1000u;
+  if (_duty.enabled() && _duty.periodMs() > _dataIntervalMs) {
+    _dataIntervalMs = _duty.periodMs();
+  }
+  LOGI(TAG, "Radio duty cycle: %s period=%lu ms window=%lu ms keepalive=%u s",
+       _duty.enabled() ? "on" : "off",
+       (unsigned long)periodMs,
+       (unsigned long)RADIO_WAKE_WINDOW_MS,
+       (unsigned)_duty.keepAliveS(MQTT_MIN_KEEPALIVE_S));
+}
+
+/**
+ * @brief Ask the network for PSM/eDRX timers after attach (best-effort).
+ *
+ * The network may grant different timers or reject the request; the wake
+ * window schedule works either way.
+ */
+void CommsPump::configureRadioPowerSave()
+{
+  if (!RADIO_DUTY_CYCLE_ENABLED || _psmConfigured) {
+    return;
+  }
+
+  mbed::CellularDevice* dev = mbed::CellularDevice::get_default_instance();
+  if (dev == nullptr) {
+    LOGW(TAG, "PSM: no cellular device");
+    return;
+  }
+
+  mbed::ScopedLock<rtos::Mutex> lock(gsmMx);
+
+  const nsapi_error_t psmErr = dev->set_power_save_mode((int)RADIO_PSM_TAU_S, (int)RADIO_PSM_ACTIVE_S);
+
+  nsapi_error_t edrxErr = NSAPI_ERROR_UNSUPPORTED;
+  mbed::ATHandler* at = dev->get_at_handler();
+  if (at != nullptr) {
+    // AT+CEDRXS=<mode 1: enable>,<AcT 4: LTE-M>,"<cycle>"
+    at->lock();
+    at->at_cmd_discard("+CEDRXS", "=", "%d%d%s", 1, 4, RADIO_EDRX_CYCLE);
+    edrxErr = at->unlock_return_error();
+  }
+
+  LOGI(TAG, "PSM request tau=%lu s active=%lu s -> %d, eDRX %s -> %d",
+       (unsigned long)RADIO_PSM_TAU_S,
+       (unsigned long)RADIO_PSM_ACTIVE_S,
+       (int)psmErr,
+       RADIO_EDRX_CYCLE,
+       (int)edrxErr);
+  _psmConfigured = true;
+}
+
+/**
+ * @brief True if deferrable traffic may go out now.
+ */
+bool CommsPump::windowOpen(uint32_t nowMs) const
+{
+  // Never let the agg->comms mail overflow while waiting for a window.
+  // After an offline hold the window lasts until the link is up and the backlog is out.
+  return _duty.isWindowOpen(nowMs) || _inbox.aggregatesFull() || _hibernatePending || _uploadAfterHold;
+}
+
 /**
  * @brief Tear down TCP/MQTT and optionally end GSM session.
  */
@@ -118,6 +376,8 @@ void CommsPump::teardownLinks(bool endGsm)
     }
   }
   _mqttConnected = false;
+  // Whether the broker still holds the session is only known after the next
+  // CONNECT (PubSubClient does not report session-present), so resubscribe then.
   _subscriptionsReady = false;
 
   if (gsmClient.connected()) {
@@ -131,6 +391,7 @@ void CommsPump::teardownLinks(bool endGsm)
     GSM.end();
     LOGI(TAG, "teardownLinks: GSM.end() returned");
     _netConnected = false;
+    _psmConfigured = false;
   }
   LOGI(TAG, "teardownLinks end");
 }
@@ -156,6 +417,7 @@ bool CommsPump::ensureNetwork()
   // We keep the recovery minimal; no external power toggling here.
   bool ok = false;
   {
+    energyledger::Scope attach(energyledger::Bucket::Attach);
     mbed::ScopedLock<rtos::Mutex> lock(gsmMx);
     ok = GSM.begin(s.sim_pin, s.apn, s.apn_user, s.apn_pass, CATM1, 524288UL, true);
   }
@@ -166,6 +428,8 @@ bool CommsPump::ensureNetwork()
     _lastNetOkMs  = timeutil::nowMs();
     postEvent(CommsEventType::NetUp, "net", "up");
     LOGI(TAG, "GSM.begin OK");
+    boottimeline::markOnce("net");
+    configureRadioPowerSave();
     return true;
   }
 
@@ -184,19 +448,82 @@ bool CommsPump::ensureNetwork()
   return false;
 }
 
+/**
+ * @brief Rebuild cached topic strings only when the node id actually changed.
+ *
+ * Node id is the device name, falling back to the (cached) hardware ID.
+ * @return true if topics changed.
+ */
+bool CommsPump::refreshTopics(const AppSettings& s)
+{
+  const char* node = s.device_name;
+  if (node[0] == '\0') {
+    if (_hwId[0] == '\0') {
+      BoardHal::getHardwareId(_hwId, sizeof(_hwId));
+    }
+    node = _hwId;
+  }
+
+  if (_topicCmd[0] != '\0' && strcmp(_topicNode, node) == 0) {
+    return false;
+  }
+
+  // Drop the old subscriptions from the (possibly persistent) broker session.
+  if (_topicCmd[0] != '\0' && mqtt.connected()) {
+    (void)mqtt.unsubscribe(_topicCmd);
+    (void)mqtt.unsubscribe(_topicCfg);
+  }
+
+  strncpy(_topicNode, node, sizeof(_topicNode));
+  _topicNode[sizeof(_topicNode) - 1] = '\0';
+
+  (void)protocol::buildTopic(_topicCmd, sizeof(_topicCmd), MQTT_TOPIC_PREFIX, _topicNode, MQTT_TOPIC_POSTFIX_CMD);
+  (void)protocol::buildTopic(_topicCfg, sizeof(_topicCfg), MQTT_TOPIC_PREFIX, _topicNode, MQTT_TOPIC_POSTFIX_CFG);
+  (void)protocol::buildTopic(_topicData, sizeof(_topicData), MQTT_TOPIC_PREFIX, _topicNode, "data");
+  (void)protocol::buildTopic(_topicStatus, sizeof(_topicStatus), MQTT_TOPIC_PREFIX, _topicNode, "status");
+  (void)protocol::buildTopic(_topicConfig, sizeof(_topicConfig), MQTT_TOPIC_PREFIX, _topicNode, MQTT_TOPIC_POSTFIX_CONFIG);
+  (void)protocol::buildTopic(_topicLog, sizeof(_topicLog), MQTT_TOPIC_PREFIX, _topicNode, MQTT_TOPIC_POSTFIX_LOG);
+  (void)protocol::buildTopic(_topicMetrics, sizeof(_topicMetrics), MQTT_TOPIC_PREFIX, _topicNode,
+                             MQTT_TOPIC_POSTFIX_METRICS);
+  _subscriptionsReady = false;
+  LOGI(TAG, "Topics rebuilt for node %s", _topicNode);
+  return true;
+}
+
+/**
+ * @brief Subscribe cmd/cfg (QoS 1 so a persistent session queues them while we sleep).
+ */
+bool CommsPump::subscribeTopics(const char* when)
+{
+  const uint8_t qos   = MQTT_PERSISTENT_SESSION ? 1u : 0u;
+  const bool    subCmd = mqtt.subscribe(_topicCmd, qos);
+  const bool    subCfg = mqtt.subscribe(_topicCfg, qos);
+  if (!subCmd || !subCfg) {
+    LOGW(TAG, "MQTT subscribe failed %s (cmd=%d cfg=%d)", when, subCmd ? 1 : 0, subCfg ? 1 : 0);
+    teardownLinks(false);
+    postEvent(CommsEventType::MqttDown, "mqtt", "subscribe_fail");
+    return false;
+  }
+  _subscriptionsReady = true;
+  return true;
+}
+
 /**
  * @brief Ensure MQTT is connected, using explicit TCP connect first (your proven pattern).
  */
 bool CommsPump::ensureMqtt()
 {
   if (_hibernatePending) {
-    return false;
+    // Drain over the established link only.
+    return _mqttConnected && mqtt.connected();
   }
 
   if (!_wantConnected) {
     return false;
   }
 
+  const uint32_t attemptStartMs = timeutil::nowMs();
+
   if (!ensureNetwork()) {
     _mqttConnected = false;
     return false;
@@ -204,37 +531,16 @@ bool CommsPump::ensureMqtt()
 
   const AppSettings s = _settings.getCopy();
 
-
-  if (_topicCmd[0] == '\0') {
-    // Use friendly name for topic segment, fallback to a stable hardware ID.
-    const char* node = s.device_name;
-    char        hwId[32];
-    if (node[0] == '\0') {
-      BoardHal::getHardwareId(hwId, sizeof(hwId));
-      node = hwId;
-    }
-
-    (void)protocol::buildTopic(_topicCmd, sizeof(_topicCmd), MQTT_TOPIC_PREFIX, node, MQTT_TOPIC_POSTFIX_CMD);
-    (void)protocol::buildTopic(_topicCfg, sizeof(_topicCfg), MQTT_TOPIC_PREFIX, node, MQTT_TOPIC_POSTFIX_CFG);
-    (void)protocol::buildTopic(_topicData, sizeof(_topicData), MQTT_TOPIC_PREFIX, node, "data");
-    (void)protocol::buildTopic(_topicStatus, sizeof(_topicStatus), MQTT_TOPIC_PREFIX, node, "status");
-    _subscriptionsReady = false;
-  }
+  (void)refreshTopics(s);
 
   mqtt.setServer(s.mqtt_host, (uint16_t)s.mqtt_port);
   mqtt.setBufferSize(512);
 
   if (mqtt.connected()) {
     if (!_subscriptionsReady) {
-      const bool subCmd = mqtt.subscribe(_topicCmd);
-      const bool subCfg = mqtt.subscribe(_topicCfg);
-      if (!subCmd || !subCfg) {
-        LOGW(TAG, "MQTT subscribe failed while connected (cmd=%d cfg=%d)", subCmd ? 1 : 0, subCfg ? 1 : 0);
-        teardownLinks(false);
-        postEvent(CommsEventType::MqttDown, "mqtt", "subscribe_fail");
+      if (!subscribeTopics("while connected")) {
         return false;
       }
-      _subscriptionsReady = true;
     }
     _mqttConnected = true;
     _lastMqttOkMs  = timeutil::nowMs();
@@ -247,6 +553,7 @@ bool CommsPump::ensureMqtt()
     LOGI(TAG, "Opening TCP to MQTT server %s:%u ...", s.mqtt_host, (unsigned)s.mqtt_port);
     for (int i = 0; i < 3 && _wantConnected; i++) {
       {
+        energyledger::Scope attach(energyledger::Bucket::Attach);
         mbed::ScopedLock<rtos::Mutex> lock(gsmMx);
         tcpOk = gsmClient.connect(s.mqtt_host, s.mqtt_port);
       }
@@ -265,36 +572,45 @@ bool CommsPump::ensureMqtt()
     _lastNetOkMs = 0;
     return false;
   }
+  const uint32_t tcpUpMs = timeutil::nowMs();
 
   // 2) MQTT CONNECT
-  LOGI(TAG, "MQTT connecting ...");
+  // With a persistent session (cleanSession=false) the broker queues QoS 1
+  // commands while the link is down. SUBSCRIBE still follows every CONNECT:
+  // a broker restart, session expiry or client-id takeover loses the
+  // subscriptions, and PubSubClient does not expose CONNACK session-present.
+  const bool cleanSession = !MQTT_PERSISTENT_SESSION;
+  LOGI(TAG, "MQTT connecting (cleanSession=%d) ...", cleanSession ? 1 : 0);
 
   bool connected = false;
   {
     // Keep the CONNECT atomic with respect to other GSM operations.
+    energyledger::Scope attach(energyledger::Bucket::Attach);
     mbed::ScopedLock<rtos::Mutex> lock(gsmMx);
-    if (strlen(s.mqtt_user) > 0) {
-      connected = mqtt.connect(s.mqtt_client_id, s.mqtt_user, s.mqtt_pass);
-    } else {
-      connected = mqtt.connect(s.mqtt_client_id);
-    }
+    mqtt.setKeepAlive(_duty.keepAliveS(MQTT_MIN_KEEPALIVE_S));
+    const char* user = (strlen(s.mqtt_user) > 0) ? s.mqtt_user : nullptr;
+    const char* pass = (user != nullptr) ? s.mqtt_pass : nullptr;
+    connected = mqtt.connect(s.mqtt_client_id, user, pass, nullptr, 0, false, nullptr, cleanSession);
   }
 
   if (connected) {
-    const bool subCmd = mqtt.subscribe(_topicCmd);
-    const bool subCfg = mqtt.subscribe(_topicCfg);
-    if (!subCmd || !subCfg) {
-      LOGW(TAG, "MQTT subscribe failed after connect (cmd=%d cfg=%d)", subCmd ? 1 : 0, subCfg ? 1 : 0);
-      teardownLinks(false);
-      postEvent(CommsEventType::MqttDown, "mqtt", "subscribe_fail");
+    if (!subscribeTopics("after connect")) {
       return false;
     }
-    _subscriptionsReady = true;
     _mqttConnected = true;
     _mqttFailCount = 0;
     _lastMqttOkMs  = timeutil::nowMs();
+    _duty.anchor(_lastMqttOkMs);
+
+    _reconnectStartMs  = attemptStartMs;
+    _awaitFirstPublish = true;
+    metrics::count(metrics::Counter::MqttConnects);
+    LOGI(TAG, "MQTT connected in %lu ms (tcp %lu ms), subscribed to %s",
+         (unsigned long)(_lastMqttOkMs - attemptStartMs),
+         (unsigned long)(tcpUpMs - attemptStartMs),
+         _topicCmd);
     postEvent(CommsEventType::MqttUp, "mqtt", "up");
-    LOGI(TAG, "MQTT connected, subscribed to %s", _topicCmd);
+    boottimeline::markOnce("mqtt");
     return true;
   }
 
@@ -308,7 +624,7 @@ bool CommsPump::ensureMqtt()
 /**
  * @brief Publish status message.
  */
-bool CommsPump::publishStatus(const char* mode, const char* extraJsonKVsOrNull)
+bool CommsPump::publishStatus(const char* mode, const char* extraJsonKVsOrNull, bool withConfigDigest)
 {
   if (!ensureMqtt()) {
     return false;
@@ -326,22 +642,73 @@ bool CommsPump::publishStatus(const char* mode, const char* extraJsonKVsOrNull)
       }
     }
   }
+  if (withConfigDigest) {
+    // Lets the backend audit the config on boot without a getConfig round-trip.
+    doc["configDigest"] = _settings.configDigest();
+  }
+  const bool withBoot = withConfigDigest && !_bootTimelineSent;
+  if (withBoot) {
+    boottimeline::addToJson(doc, "bootMs");
+    if (_restartReason != nullptr) {
+      doc["restartReason"] = _restartReason;
+    }
+  }
 
-  return publishJson(_topicStatus, doc);
+  const bool ok = publishJson(_topicStatus, doc);
+  if (ok && withBoot) {
+    _bootTimelineSent = true;
+  }
+  return ok;
 }
 
 
-bool CommsPump::publishConfigSnapshot()
+/**
+ * @brief Answer getConfig.
+ *
+ * Options (JSON, from the command): "digest" the server already holds and
+ * "format" ("json" or "msgpack"). A matching digest is answered with a
+ * configDigest message only. MessagePack snapshots go to the /config topic
+ * in one publish; JSON keeps the single-message/chunked legacy behaviour.
+ */
+bool CommsPump::publishConfigSnapshot(const char* optionsJsonOrNull)
 {
   if (!ensureMqtt()) {
     return false;
   }
 
+  bool     binary    = false;
+  bool     hasDigest = false;
+  uint32_t digest    = 0;
+  if (optionsJsonOrNull != nullptr && optionsJsonOrNull[0] != '\0') {
+    JsonDocument opts;
+    if (deserializeJson(opts, optionsJsonOrNull) == DeserializationError::Ok) {
+      binary    = (strcmp(opts[protocol::kKeyFormat] | "", protocol::kFormatMsgPack) == 0);
+      hasDigest = opts[protocol::kKeyDigest].is<uint32_t>();
+      digest    = opts[protocol::kKeyDigest] | 0u;
+    }
+  }
+
+  const uint32_t current = _settings.configDigest();
+  if (hasDigest && digest == current) {
+    return publishConfigDigest(current, true);
+  }
+
+  if (binary) {
+    uint8_t buf[MAX_CONFIG_PAYLOAD_BYTES];
+    const size_t n = _settings.encodeConfigSnapshot(buf, sizeof(buf));
+    if (n > 0) {
+      LOGI(TAG, "Config snapshot (msgpack) %u bytes", (unsigned)n);
+      return publishBinary(_topicConfig, buf, n);
+    }
+    LOGW(TAG, "Binary config snapshot does not fit; falling back to JSON");
+  }
+
   // Try single-message first (backward compatible).
   {
     JsonDocument doc;
     doc["type"] = "config";
     doc["tsMs"] = (uint32_t)millis();
+    doc["digest"] = current;
     _settings.addMaskedConfigFields(doc, SettingsManager::ConfigSection::All);
 
     const size_t bytes = measureJson(doc);
@@ -358,10 +725,22 @@ bool CommsPump::publishConfigSnapshot()
   ok = ok && publishConfigChunk(3, CONFIG_CHUNK_TOTAL, "device", SettingsManager::ConfigSection::Device);
   ok = ok && publishConfigChunk(4, CONFIG_CHUNK_TOTAL, "schedule", SettingsManager::ConfigSection::Schedule);
   ok = ok && publishConfigChunk(5, CONFIG_CHUNK_TOTAL, "power", SettingsManager::ConfigSection::Power);
+  ok = ok && publishConfigDigest(current, false);
 
   return ok;
 }
 
+bool CommsPump::publishConfigDigest(uint32_t digest, bool unchanged)
+{
+  JsonDocument doc;
+  doc["type"]      = "configDigest";
+  doc["tsMs"]      = (uint32_t)millis();
+  doc["schema"]    = settingsschema::kSchemaVersion;
+  doc["digest"]    = digest;
+  doc["unchanged"] = unchanged;
+  return publishJson(_topicStatus, doc);
+}
+
 bool CommsPump::publishConfigChunk(uint8_t chunk, uint8_t total, const char* section,
                                    SettingsManager::ConfigSection configSection)
 {
@@ -389,16 +768,43 @@ bool CommsPump::publishConfigChunk(uint8_t chunk, uint8_t total, const char* sec
 
 
 /**
- * @brief Publish aggregated data packet.
+ * @brief True if the pending status should wait for the next /data publish.
+ *
+ * Waits only while data is flowing and the next publish is expected within
+ * STATUS_COALESCE_TOLERANCE_MS of the status being queued.
+ */
+bool CommsPump::statusCanRideOnData(uint32_t nowMs) const
+{
+  if (_lastDataPublishMs == 0u || _dataIntervalMs == 0u) {
+    return false;
+  }
+
+  const uint32_t nextDataMs = _lastDataPublishMs + _dataIntervalMs;
+  if ((int32_t)(nowMs - nextDataMs) > (int32_t)STATUS_COALESCE_TOLERANCE_MS) {
+    // Data stopped (session ended or stalled).
+    return false;
+  }
+  return (int32_t)(nextDataMs - _pendingStatusMs) <= (int32_t)STATUS_COALESCE_TOLERANCE_MS;
+}
+
+/**
+ * @brief Publish aggregated data packet, optionally carrying a pending status.
  */
-bool CommsPump::publishAggregate(const AggregateMsg& a)
+bool CommsPump::publishAggregate(const AggregateMsg& a, const char* statusJsonOrNull, bool* statusSentOrNull)
 {
+  if (statusSentOrNull != nullptr) {
+    *statusSentOrNull = false;
+  }
+
   JsonDocument doc;
   doc["type"] = "data";
   doc["t0"] = a.rel_start_ms;
   doc["t1"] = a.rel_end_ms;
   doc["n"]  = a.n;
   doc["ok"] = a.ok ? 1 : 0;
+  if (a.partial) {
+    doc["partial"] = 1;
+  }
   if (a.sessionId[0] != '\0') {
     doc["sessionID"] = a.sessionId;
   }
@@ -423,7 +829,67 @@ bool CommsPump::publishAggregate(const AggregateMsg& a)
     doc[k] = roundf(a.v1_max * mul) / mul;
   }
 
-  return publishJson(_topicData, doc);
+  // Piggyback periodic status as a nested object (drops "type").
+  bool withStatus = false;
+  if (statusJsonOrNull != nullptr && statusJsonOrNull[0] != '\0') {
+    JsonDocument st;
+    if (deserializeJson(st, statusJsonOrNull) == DeserializationError::Ok && st.is<JsonObject>()) {
+      st.remove("type");
+      doc["status"] = st;
+      withStatus    = true;
+      if (measureJson(doc) >= PUBLISH_JSON_BUF_BYTES) {
+        LOGW(TAG, "publishAggregate: status does not fit, sending data only");
+        doc.remove("status");
+        withStatus = false;
+      }
+    }
+  }
+
+  const bool ok = publishJson(_topicData, doc);
+  if (statusSentOrNull != nullptr) {
+    *statusSentOrNull = ok && withStatus;
+  }
+  return ok;
+}
+
+AggregateMsg* CommsPump::take()
+{
+  return _inbox.tryGetAggregate();
+}
+
+void CommsPump::release(AggregateMsg* a)
+{
+  _inbox.freeAggregate(a);
+}
+
+bool CommsPump::linkUp()
+{
+  return mqtt.connected();
+}
+
+/**
+ * @brief AggregateDrain::Port: publish one aggregate, with any pending status.
+ */
+bool CommsPump::publish(const AggregateMsg& a)
+{
+  bool statusSent = false;
+  if (!publishAggregate(a, _pendingStatus.ptr, &statusSent)) {
+    return false;
+  }
+  if (statusSent) {
+    payloadpool::release(_pendingStatus);
+  }
+  _lastDataPublishMs = timeutil::nowMs();
+  postEvent(CommsEventType::AggregatePublished, "data", "aggregate_published");
+
+  if (_wantConnected && !_hibernatePending) {
+    const bool loopOk = mqtt.loop();
+    if (!loopOk && !mqtt.connected()) {
+      postEvent(CommsEventType::MqttDown, "mqtt", "loop_fail");
+      teardownLinks(false);
+    }
+  }
+  return true;
 }
 
 /**
@@ -441,30 +907,73 @@ void CommsPump::mqttCallbackTrampoline(char* topic, uint8_t* payload, unsigned i
  */
 void CommsPump::onMqttMessage(char* topic, uint8_t* payload, unsigned int len)
 {
-  // Copy payload to a null-terminated buffer on stack.
-  char buf[256];
-  const size_t n = (len < sizeof(buf) - 1u) ? (size_t)len : (sizeof(buf) - 1u);
-  memcpy(buf, payload, n);
-  buf[n] = '\0';
-
   const char* t = (topic != nullptr) ? topic : "";
 
   // Step 1 routing:
-  //  - /cfg payloads are applied immediately by SettingsManager
-  //  - /cmd payloads are forwarded to Orchestrator
+  //  - /cfg payloads are applied (or staged, see "txn") by SettingsManager
+  //  - /cmd payloads are decoded here once and forwarded to Orchestrator as protocol::Command
   if (protocol::topicHasPostfix(t, MQTT_TOPIC_POSTFIX_CFG)) {
-    const bool ok = _settings.applyJson(buf, true);
-    _topicCmd[0] = '\0';
-    LOGI(TAG, "RX cfg topic=%s applied=%d payload=%s", t, ok ? 1 : 0, buf);
+    // Copy payload to a null-terminated buffer on stack.
+    char buf[256];
+    const size_t n = (len < sizeof(buf) - 1u) ? (size_t)len : (sizeof(buf) - 1u);
+    memcpy(buf, payload, n);
+    buf[n] = '\0';
+
+    const SettingsManager::CfgResult r = _settings.applyCfgMessage(buf, true);
+    LOGI(TAG, "RX cfg topic=%s ok=%d committed=%d payload=%s", t, r.ok ? 1 : 0, r.committed ? 1 : 0, buf);
+    if (r.committed) {
+      // Acted on in loopOnce(), outside the PubSubClient callback.
+      requestRelink(r.changedSections);
+    }
     return;
   }
 
-  postEvent(CommsEventType::ServerCommand, t, buf);
+  protocol::Command cmd;
+  if (!protocol::decodeCommand(payload, (size_t)len, cmd)) {
+    LOGW(TAG, "RX topic=%s bad JSON payload=%.*s", t, (int)len, (const char*)payload);
+    return;
+  }
+
+  postCommand(t, cmd);
 
   if (protocol::topicHasPostfix(t, MQTT_TOPIC_POSTFIX_CMD)) {
-    LOGI(TAG, "RX cmd topic=%s payload=%s", t, buf);
+    LOGI(TAG, "RX cmd topic=%s payload=%.*s", t, (int)len, (const char*)payload);
+  } else {
+    LOGI(TAG, "RX topic=%s payload=%.*s", t, (int)len, (const char*)payload);
+  }
+}
+
+/**
+ * @brief How long the main loop may sleep before the next loopOnce().
+ */
+uint32_t CommsPump::idleWaitMs() const
+{
+  const uint32_t now  = timeutil::nowMs();
+  uint32_t       wait = COMMS_IDLE_MAX_MS;
+  if (_offline) {
+    const int32_t left = (int32_t)(_offlineUntilMs - now);
+    wait = (left <= 0) ? 0u : (uint32_t)left;
+  } else if (!windowOpen(now)) {
+    wait = _duty.msUntilNextWindow(now);
+  } else {
+    return COMMS_POLL_MS;
+  }
+  return (wait > COMMS_IDLE_MAX_MS) ? COMMS_IDLE_MAX_MS : wait;
+}
+
+/**
+ * @brief Hold the modem wake lock while the radio may be talking to us.
+ */
+void CommsPump::setModemAwake(bool awake)
+{
+  if (awake == _modemAwake) {
+    return;
+  }
+  _modemAwake = awake;
+  if (awake) {
+    wakelock::acquire(wakelock::Holder::Modem);
   } else {
-    LOGI(TAG, "RX topic=%s payload=%s", t, buf);
+    wakelock::release(wakelock::Holder::Modem);
   }
 }
 
@@ -473,19 +982,49 @@ void CommsPump::onMqttMessage(char* topic, uint8_t* payload, unsigned int len)
  */
 void CommsPump::loopOnce()
 {
-  // Drain orchestrator commands
+  updateDutyCycle();
+
+  if (_offline && (int32_t)(timeutil::nowMs() - _offlineUntilMs) >= 0) {
+    _offline         = false;
+    _uploadAfterHold = true;
+    _duty.openNow(timeutil::nowMs());
+    LOGI(TAG, "Offline hold over, uploading");
+    replayHeldCommands();
+  }
+
+  // Drain orchestrator commands, also during the offline hold so the
+  // orch->comms mail and its pool slots never back up; the hold only
+  // keeps the radio quiet.
   while (true) {
     OrchCommandMsg* cmd = _inbox.tryGetOrch();
     if (cmd == nullptr) {
       break;
     }
-    handleOrchCommand(*cmd);
+    if (_offline) {
+      deferOrchCommand(*cmd);
+    } else {
+      handleOrchCommand(*cmd);
+    }
     _inbox.freeOrch(cmd);
   }
 
-  // Maintain connections + process inbound MQTT
+  if (_offline) {
+    setModemAwake(false);
+    return;
+  }
+
+  // Outside a wake window the radio is left alone (PSM): no reconnects,
+  // no socket polling, deferrable publishes stay queued.
+  if (!windowOpen(timeutil::nowMs())) {
+    setModemAwake(false);
+    return;
+  }
+  setModemAwake(_wantConnected);
+
+  // Maintain connections + process inbound MQTT. Not while draining for
+  // hibernate: the orchestrator has stopped, so commands stay with the broker.
 
-  if (_wantConnected) {
+  if (_wantConnected && !_hibernatePending) {
 
     if (!mqtt.connected()) {
       (void)ensureMqtt();
@@ -500,27 +1039,48 @@ void CommsPump::loopOnce()
     }
   }
 
-  // Drain aggregates and publish
-  uint8_t publishedThisLoop = 0;
-  while (publishedThisLoop < 4u) {
-    AggregateMsg* a = _inbox.tryGetAggregate();
-    if (a == nullptr) {
-      break;
-    }
-    (void)publishAggregate(*a);
-    postEvent(CommsEventType::AggregatePublishAttempted, "data", "aggregate_publish_attempted");
-    _inbox.freeAggregate(a);
-    publishedThisLoop++;
-
-    if (_wantConnected && mqtt.connected()) {
-      const bool loopOk = mqtt.loop();
-      if (!loopOk && !mqtt.connected()) {
-        postEvent(CommsEventType::MqttDown, "mqtt", "loop_fail");
-        teardownLinks(false);
-        break;
-      }
-    }
+  // Drain aggregates and publish; the first one carries any pending status.
+  // Only over a live link; a failed publish keeps its aggregate for the next pass.
+  (void)_drain.run(*this, 4u);
+
+  if (_uploadAfterHold && mqtt.connected() && _inbox.aggregatesEmpty() && !_drain.holding()) {
+    _uploadAfterHold = false;
+  }
+
+  applyPendingRelink();
+  _settings.expireStaleTransaction();
+
+  // No data to ride on (aware mode, or next publish too far out): send standalone.
+  if (_pendingStatus.ptr != nullptr && mqtt.connected() &&
+      (_hibernatePending || !statusCanRideOnData(timeutil::nowMs()))) {
+    (void)publishStatus("aware", _pendingStatus.ptr);
+    payloadpool::release(_pendingStatus);
+  }
+
+  // Metrics snapshot: every METRICS_PUBLISH_INTERVAL_S, and once before hibernate.
+  if (mqtt.connected() &&
+      (_metricsOnSleep || (timeutil::nowMs() - _lastMetricsMs) >= METRICS_PUBLISH_INTERVAL_S * 1000u)) {
+    (void)publishMetrics();
+    _lastMetricsMs  = timeutil::nowMs();
+    _metricsOnSleep = false;
   }
+
+  // Post-mortem log of an abnormal restart; one attempt per pump pass.
+  const uint8_t* crashData = nullptr;
+  size_t         crashLen  = 0;
+  if (!_hibernatePending && mqtt.connected() && crashlog::pending(crashData, crashLen)) {
+    crashlog::uploaded(publishBinary(_topicLog, crashData, crashLen));
+  }
+}
+
+bool CommsPump::publishMetrics()
+{
+  JsonDocument doc;
+  doc["type"] = "metrics";
+  doc["tsMs"] = (uint32_t)millis();
+  metrics::addToJson(doc);
+  threadprof::addToJson(doc);
+  return publishJson(_topicMetrics, doc);
 }
 
 uint32_t CommsPump::uptimeMs() const
@@ -540,6 +1100,7 @@ void CommsPump::shutdownForHibernate()
   // In hibernate we will cut power rails anyway; avoid GSM.end() which may block.
   _wantConnected = false;
   teardownLinks(false);
+  setModemAwake(false);
 }
 
 
@@ -548,7 +1109,7 @@ bool CommsPump::publishJson(const char* topic, const JsonDocument& doc)
 {
   // Always publish valid, null-terminated JSON to avoid downstream parsers that
   // (incorrectly) treat payloads as C strings.
-  char buf[512] = {0};
+  char buf[PUBLISH_JSON_BUF_BYTES] = {0};
 
   const size_t expectedBytes = measureJson(doc);
   if (expectedBytes >= sizeof(buf)) {
@@ -568,7 +1129,48 @@ bool CommsPump::publishJson(const char* topic, const JsonDocument& doc)
 
   // Use the C-string publish overload so the payload length is derived from strlen().
   // This keeps the MQTT payload clean when receivers assume null-termination.
-  const bool ok = mqtt.publish(topic, buf);
+  bool           ok      = false;
+  const uint32_t startMs = timeutil::nowMs();
+  {
+    energyledger::Scope publish(energyledger::Bucket::Publish);
+    ok = mqtt.publish(topic, buf);
+  }
+  metrics::observe(metrics::Histogram::PublishMs, timeutil::nowMs() - startMs);
+  onPublishResult(topic, ok);
+  return ok;
+}
+
+/**
+ * @brief Publish a raw binary payload (e.g. MessagePack config snapshot).
+ *
+ * Payloads that do not fit the client buffer (post-mortem log) are streamed.
+ */
+bool CommsPump::publishBinary(const char* topic, const uint8_t* data, size_t len)
+{
+  bool           ok      = false;
+  const uint32_t startMs = timeutil::nowMs();
+  {
+    energyledger::Scope publish(energyledger::Bucket::Publish);
+    // Fixed header (5) + topic length (2) + topic.
+    if (len + strlen(topic) + 7u <= mqtt.getBufferSize()) {
+      ok = mqtt.publish(topic, data, (unsigned int)len);
+    } else {
+      ok = mqtt.beginPublish(topic, (unsigned int)len, false) && mqtt.write(data, len) == len && mqtt.endPublish();
+    }
+  }
+  metrics::observe(metrics::Histogram::PublishMs, timeutil::nowMs() - startMs);
+  onPublishResult(topic, ok);
+  return ok;
+}
+
+void CommsPump::onPublishResult(const char* topic, bool ok)
+{
+  metrics::count(ok ? metrics::Counter::Publishes : metrics::Counter::PublishFailures);
+  if (ok && _awaitFirstPublish) {
+    _awaitFirstPublish        = false;
+    _lastReconnectToPublishMs = timeutil::nowMs() - _reconnectStartMs;
+    LOGI(TAG, "Reconnect-to-first-publish %lu ms", (unsigned long)_lastReconnectToPublishMs);
+  }
   if (!ok) {
     postEvent(CommsEventType::PublishFailed, topic, "publish failed");
     if (!mqtt.connected()) {
@@ -576,5 +1178,4 @@ bool CommsPump::publishJson(const char* topic, const JsonDocument& doc)
       teardownLinks(false);
     }
   }
-  return ok;
 }
@@ -1,6 +1,10 @@
 #include "ConsoleCommands.h"
 
+#include "SettingsSchema.h"
+#include "ThreadProfiler.h"
+
 #include <ctype.h>
+#include <stdio.h>
 #include <string.h>
 
 static void printMasked(Stream& out, const char* key, const char* value)
@@ -23,59 +27,35 @@ static void printKv(Stream& out, const char* key, const char* value)
   out.println(value != nullptr ? value : "");
 }
 
-static void printKvU32(Stream& out, const char* key, uint32_t value)
-{
-  out.print(key);
-  out.print('=');
-  out.println(value);
-}
-
-static void printKvF(Stream& out, const char* key, float value, int decimals)
-{
-  out.print(key);
-  out.print('=');
-  out.println(value, decimals);
-}
-
 void printSettingsToSerial(const SettingsManager& settingsManager, Stream& out)
 {
   const AppSettings s = settingsManager.getCopy();
 
   out.println("--- Hastig config ---");
 
-  // Sensor serial settings
-  printKvU32(out, "sensorAddress", (uint32_t)s.sensor_addr);
-  printKvU32(out, "sensorBaudrate", s.sensor_baud);
-  printKvU32(out, "sensorWarmupMs", s.sensor_warmup_ms);
-  printKvU32(out, "sensorType", s.sensor_type);
-
-  // Sampling / aggregation
-  printKvU32(out, "samplingInterval", s.sample_period_ms);
-  printKvU32(out, "aggPeriodS", s.agg_period_s);
-
-  // Power / behaviour
-  printKvU32(out, "awareTimeoutS", s.aware_timeout_s);
-  printKvU32(out, "defaultSleepS", s.default_sleep_s);
-  printKvU32(out, "statusIntervalS", s.status_interval_s);
-
-  printKvF(out, "lowBattMinV", s.low_batt_min_v, 3);
-  printKvU32(out, "maxChargingCurrent", (uint32_t)s.max_charging_current);
-  printKvF(out, "maxChargingVoltage", s.max_charging_voltage, 3);
-  printKvU32(out, "emergencyDelayS", s.emergency_delay_s);
-  printKvU32(out, "emergencySleepS", s.emergency_sleep_s);
-
-  // Network / MQTT
-  printKv(out, "apn", s.apn);
-  printKv(out, "apnUser", s.apn_user);
-  printMasked(out, "apnPass", s.apn_pass);
-
-  printKv(out, "mqttHost", s.mqtt_host);
-  printKvU32(out, "mqttPort", s.mqtt_port);
-  printKv(out, "mqttUser", s.mqtt_user);
-  printMasked(out, "mqttPass", s.mqtt_pass);
-  printKv(out, "mqttClientId", s.mqtt_client_id);
-
-  printKv(out, "deviceName", s.device_name);
+  for (size_t i = 0; i < settingsschema::fieldCount(); i++) {
+    const settingsschema::Field& f = settingsschema::field(i);
+
+    switch (f.type) {
+      case settingsschema::FieldType::Str:
+        if (f.secret) {
+          printMasked(out, f.key, settingsschema::getString(s, f));
+        } else {
+          printKv(out, f.key, settingsschema::getString(s, f));
+        }
+        break;
+      case settingsschema::FieldType::F32:
+        out.print(f.key);
+        out.print('=');
+        out.println(settingsschema::getFloat(s, f), 3);
+        break;
+      default:
+        out.print(f.key);
+        out.print('=');
+        out.println(settingsschema::getUnsigned(s, f));
+        break;
+    }
+  }
 
   out.println("---------------------");
 }
@@ -87,6 +67,45 @@ static void printHelp(Stream& out)
   out.println("  show             Print current config");
   out.println("  config           Alias for show");
   out.println("  settings         Alias for show");
+  out.println("  log [spec]       Show/set log levels, e.g. log info,COMMS=debug");
+  out.println("  threads          Per-thread stack high-water and CPU share");
+}
+
+static void handleLogCommand(SettingsManager& settingsManager, const char* spec, Stream& out)
+{
+  if (spec[0] == '\0') {
+    out.print("logLevels=");
+    out.println(settingsManager.getCopy().log_levels);
+    return;
+  }
+
+  JsonDocument patch;
+  patch["logLevels"] = spec;
+  char buf[96];
+  serializeJson(patch, buf, sizeof(buf));
+  if (settingsManager.applyJson(buf, true)) {
+    out.print("logLevels=");
+    out.println(settingsManager.getCopy().log_levels);
+  } else {
+    out.println("Bad log spec; levels: trace, debug, info, warn, error, none");
+  }
+}
+
+static void printThreads(Stream& out)
+{
+  out.println("thread  stack used/size  cpu now/peak  busy ms");
+  for (size_t i = 0; i < threadprof::kSlotCount; i++) {
+    threadprof::Stats st;
+    if (!threadprof::stats((threadprof::Slot)i, st)) {
+      continue;
+    }
+    char line[64];
+    snprintf(line, sizeof(line), "%-6s  %5lu/%-5lu      %4u/%-4u     %lu", st.name, (unsigned long)st.stackPeak,
+             (unsigned long)st.stackSize, (unsigned)st.cpuPermille, (unsigned)st.peakCpuPermille,
+             (unsigned long)st.busyMs);
+    out.println(line);
+  }
+  out.println("(cpu in permille over the last window; used 0 = no RTX watermark)");
 }
 
 static void trimInPlace(char* s)
@@ -137,6 +156,12 @@ void handleSerialConsole(SettingsManager& settingsManager)
       } else if (strcmp(line, "show") == 0 || strcmp(line, "config") == 0 ||
                  strcmp(line, "settings") == 0) {
         printSettingsToSerial(settingsManager, Serial);
+      } else if (strcmp(line, "log") == 0 || strncmp(line, "log ", 4) == 0) {
+        char* spec = &line[3];
+        trimInPlace(spec);
+        handleLogCommand(settingsManager, spec, Serial);
+      } else if (strcmp(line, "threads") == 0) {
+        printThreads(Serial);
       } else {
         Serial.print("Unknown command: ");
         Serial.println(line);
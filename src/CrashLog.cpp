@@ -0,0 +1,248 @@
+#include "CrashLog.h"
+
+#include <mbed.h>
+#include <platform/ScopedLock.h>
+
+#include <string.h>
+
+#include "AppConfig.h"
+#include "Deflate.h"
+#include "Logger.h"
+#include "RetainedLog.h"
+#include "SettingsJournal.h"
+
+static const char* TAG = "CRASH";
+
+namespace crashlog {
+namespace {
+
+static constexpr uint32_t kJournalMagic  = 0x474F4C43; // 'CLOG'
+static constexpr size_t   kPayloadHeader = 16;
+static constexpr uint8_t  kSourceRam     = 1;
+static constexpr uint8_t  kSourceFlash   = 2;
+
+// Not zeroed by the C runtime: a reset (watchdog, fault, NVIC) leaves the
+// previous run's text in place. Standby and power loss scramble it, which
+// RetainedLog::attach() detects. Whether the linker script keeps .noinit
+// out of initialised memory is not a given (ld places an unknown section
+// next to similar ones), so begin() checks where it ended up.
+__attribute__((section(".noinit"), aligned(32)))
+static uint8_t s_region[sizeof(RetainedLog::Header) + CRASHLOG_RAM_BYTES];
+
+// Bounds from the mbed GCC_ARM linker script: .data is copied from flash and
+// .bss zeroed by the startup code, the heap is handed out by malloc.
+extern "C" uint8_t __data_start__[], __data_end__[];
+extern "C" uint8_t __bss_start__[], __bss_end__[];
+extern "C" uint8_t __end__[], __HeapLimit[];
+
+static RetainedLog     s_ring(s_region, sizeof(s_region));
+static bool            s_retained = false;
+static SettingsJournal s_journal(SettingsJournal::kSectorCount, kJournalMagic);
+static rtos::Mutex     s_mx;
+
+// Scratch for excerpts; boot and hibernate paths only.
+static char    s_text[CRASHLOG_EXCERPT_BYTES];
+static uint8_t s_payload[kPayloadHeader + CRASHLOG_UPLOAD_MAX_BYTES];
+static size_t  s_payloadLen = 0;
+static uint8_t s_tries      = 0;
+
+/** @brief Write dirty cache lines back so a reset does not lose them (M7 D-cache is write-back). */
+void cleanCache(const void* p, size_t n)
+{
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+  const uintptr_t start = (uintptr_t)p & ~(uintptr_t)31u;
+  const uintptr_t end   = ((uintptr_t)p + n + 31u) & ~(uintptr_t)31u;
+  SCB_CleanDCache_by_Addr((uint32_t*)start, (int32_t)(end - start));
+#else
+  (void)p;
+  (void)n;
+#endif
+}
+
+void appendLocked(const char* s, size_t n)
+{
+  s_ring.append(s, n);
+  size_t      len = 0;
+  const void* at  = s_ring.lastWrite(len);
+  cleanCache(at, len);
+  cleanCache(s_region, sizeof(RetainedLog::Header));
+}
+
+bool overlaps(const uint8_t* lo, const uint8_t* hi)
+{
+  return s_region < hi && lo < s_region + sizeof(s_region);
+}
+
+/** @brief True if s_region lies outside everything the startup code or malloc writes. */
+bool regionRetained()
+{
+  return !overlaps(__data_start__, __data_end__) && !overlaps(__bss_start__, __bss_end__) &&
+         !overlaps(__end__, __HeapLimit);
+}
+
+/** @brief Logger tap: runs on the LOG thread for every printed line. */
+void onLine(const char* line, size_t len)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(s_mx);
+  appendLocked(line, len);
+  appendLocked("\n", 1u);
+}
+
+void putU32(uint8_t* p, uint32_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Deflate the newest text into out; halves the excerpt until it fits.
+ * @return compressed bytes (0 if nothing fits), rawLen receives the text length.
+ */
+size_t compressTail(uint8_t* out, size_t cap, uint32_t& rawLen)
+{
+  size_t want = sizeof(s_text);
+  while (want >= 256u) {
+    size_t n;
+    {
+      mbed::ScopedLock<rtos::Mutex> lock(s_mx);
+      n = s_ring.excerpt(s_text, want);
+    }
+    if (n == 0u) {
+      return 0;
+    }
+    const size_t packed = deflate::compress((const uint8_t*)s_text, n, out, cap);
+    if (packed > 0u) {
+      rawLen = (uint32_t)n;
+      return packed;
+    }
+    want /= 2u;
+  }
+  return 0;
+}
+
+void preparePayload(uint8_t source, RestartReasonCode reason, uint32_t rawLen, uint32_t seq, size_t packed)
+{
+  memcpy(s_payload, "HLOG", 4);
+  s_payload[4] = 1;
+  s_payload[5] = source;
+  s_payload[6] = (uint8_t)reason;
+  s_payload[7] = 0;
+  putU32(&s_payload[8], rawLen);
+  putU32(&s_payload[12], seq);
+  s_payloadLen = kPayloadHeader + packed;
+  s_tries      = 0;
+}
+
+} // namespace
+
+void begin(RestartReasonCode previous, bool parked)
+{
+  s_retained = regionRetained();
+  if (!s_retained) {
+    // Linked into initialised memory or the heap: nothing survives a reset and
+    // writing the ring would corrupt other data. The post-mortem log is off.
+    LOGE(TAG, "Retained log region at %p is not no-init RAM; RAM ring disabled", (void*)s_region);
+  }
+
+  const bool kept     = s_retained && s_ring.attach();
+  const bool abnormal = previous == RestartReasonCode::UnexpectedReboot || previous == RestartReasonCode::BrownOut;
+
+  if (abnormal && kept) {
+    uint32_t     rawLen = 0;
+    const size_t packed = compressTail(&s_payload[kPayloadHeader], CRASHLOG_UPLOAD_MAX_BYTES, rawLen);
+    if (packed > 0u) {
+      preparePayload(kSourceRam, previous, rawLen, s_ring.boots(), packed);
+    }
+  } else if (abnormal || parked) {
+    // RAM did not survive (or there is nothing new to report): the newest
+    // flash record is either the text stored at the last hibernate
+    // (rawLen u32 | DEFLATE) or an upload parked there (a whole payload).
+    size_t loaded = 0;
+    if (!s_journal.loadLatest(s_payload, sizeof(s_payload), &loaded)) {
+      loaded = 0;
+    }
+    if (loaded > kPayloadHeader && memcmp(s_payload, "HLOG", 4) == 0) {
+      // Retry it with the attempts it has left.
+      s_payloadLen = loaded;
+      s_tries      = s_payload[7];
+      s_payload[7] = 0;
+    } else if (abnormal && loaded > 4u && loaded + (kPayloadHeader - 4u) <= sizeof(s_payload)) {
+      memmove(&s_payload[kPayloadHeader - 4u], s_payload, loaded);
+      uint32_t rawLen = 0;
+      memcpy(&rawLen, &s_payload[kPayloadHeader - 4u], sizeof(rawLen));
+      preparePayload(kSourceFlash, previous, rawLen, s_journal.latestSeq(), loaded - 4u);
+    }
+  }
+
+  if (s_retained) {
+    Logger::setTap(onLine);
+  }
+
+  if (s_payloadLen > 0u) {
+    LOGW(TAG, "Post-mortem log from %s ready (%u bytes, %s, %u tries made)",
+         RestartReasonStore::name((RestartReasonCode)s_payload[6]), (unsigned)s_payloadLen,
+         (s_payload[5] == kSourceRam) ? "ram" : "flash", (unsigned)s_tries);
+  }
+}
+
+bool spill()
+{
+  if (s_payloadLen > 0u) {
+    // The crash log is worth more than this wake's text: park it for the
+    // next boot, with the attempts made so far in the reserved byte.
+    s_payload[7]  = s_tries;
+    const bool ok = s_journal.append(s_payload, s_payloadLen);
+    s_payload[7]  = 0;
+    if (!ok) {
+      LOGW(TAG, "Parking the post-mortem log failed");
+      return false;
+    }
+    LOGI(TAG, "Parked post-mortem log (%u bytes, %u tries made, seq=%lu)", (unsigned)s_payloadLen,
+         (unsigned)s_tries, (unsigned long)s_journal.latestSeq());
+    return true;
+  }
+
+  // Record layout: rawLen u32 | DEFLATE, built in the (free) upload buffer.
+  if (!s_retained) {
+    return false;
+  }
+  uint32_t     rawLen = 0;
+  const size_t packed = compressTail(&s_payload[kPayloadHeader], CRASHLOG_UPLOAD_MAX_BYTES, rawLen);
+  if (packed == 0u) {
+    return false;
+  }
+  memcpy(&s_payload[kPayloadHeader - 4u], &rawLen, sizeof(rawLen));
+  if (!s_journal.append(&s_payload[kPayloadHeader - 4u], packed + 4u)) {
+    LOGW(TAG, "Spill to flash failed");
+    return false;
+  }
+  LOGI(TAG, "Spilled %lu log bytes as %u (seq=%lu, erases=%lu)", (unsigned long)rawLen, (unsigned)packed,
+       (unsigned long)s_journal.latestSeq(), (unsigned long)s_journal.eraseCount());
+  return false;
+}
+
+bool pending(const uint8_t*& data, size_t& len)
+{
+  if (s_payloadLen == 0u) {
+    return false;
+  }
+  data = s_payload;
+  len  = s_payloadLen;
+  return true;
+}
+
+void uploaded(bool ok)
+{
+  if (s_payloadLen == 0u) {
+    return;
+  }
+  s_tries++;
+  if (ok || s_tries >= CRASHLOG_UPLOAD_TRIES) {
+    LOGI(TAG, "Post-mortem log %s", ok ? "uploaded" : "dropped after retries");
+    s_payloadLen = 0;
+  }
+}
+
+} // namespace crashlog
@@ -0,0 +1,199 @@
+#include "Deflate.h"
+
+namespace deflate {
+namespace {
+
+static constexpr uint32_t kHashBits  = 10;
+static constexpr uint32_t kWindowBits = 12;
+static constexpr uint32_t kWindow     = 1u << kWindowBits;
+static constexpr uint32_t kMaxChain   = 32; // candidates tried per position
+static constexpr uint32_t kMinMatch   = 3;
+static constexpr uint32_t kMaxMatch   = 258;
+static constexpr uint16_t kNoPos      = 0xFFFFu;
+
+static const uint16_t kLenBase[29]  = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                       31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t  kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                       2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t kDistBase[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                       33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                       1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t  kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Hash chains: s_head holds the most recent position per 3-byte hash, s_prev
+// the position before it with the same hash, indexed by position modulo the
+// window. Positions are < kMaxInput, so 16 bits suffice.
+static uint16_t s_head[1u << kHashBits];
+static uint16_t s_prev[kWindow];
+
+class BitWriter {
+public:
+  BitWriter(uint8_t* out, size_t cap) : _out(out), _cap(cap) {}
+
+  /** @brief Append n bits of v, least significant first (DEFLATE bit order). */
+  void put(uint32_t v, uint8_t n)
+  {
+    _acc |= v << _bits;
+    _bits = (uint8_t)(_bits + n);
+    while (_bits >= 8u) {
+      byte((uint8_t)_acc);
+      _acc >>= 8;
+      _bits = (uint8_t)(_bits - 8u);
+    }
+  }
+
+  /** @brief Append a Huffman code, which DEFLATE stores most significant bit first. */
+  void code(uint32_t c, uint8_t n)
+  {
+    uint32_t r = 0;
+    for (uint8_t i = 0; i < n; i++) {
+      r = (r << 1) | ((c >> i) & 1u);
+    }
+    put(r, n);
+  }
+
+  size_t finish()
+  {
+    if (_bits > 0u) {
+      byte((uint8_t)_acc);
+      _acc  = 0;
+      _bits = 0;
+    }
+    return _overflow ? 0u : _len;
+  }
+
+private:
+  uint8_t* _out;
+  size_t   _cap;
+  size_t   _len      = 0;
+  uint32_t _acc      = 0;
+  uint8_t  _bits     = 0;
+  bool     _overflow = false;
+
+  void byte(uint8_t b)
+  {
+    if (_len < _cap) {
+      _out[_len++] = b;
+    } else {
+      _overflow = true;
+    }
+  }
+};
+
+/** @brief Fixed literal/length code (RFC 1951, 3.2.6). */
+void putSymbol(BitWriter& w, uint16_t sym)
+{
+  if (sym < 144u) {
+    w.code(0x30u + sym, 8);
+  } else if (sym < 256u) {
+    w.code(0x190u + (sym - 144u), 9);
+  } else if (sym < 280u) {
+    w.code(sym - 256u, 7);
+  } else {
+    w.code(0xC0u + (sym - 280u), 8);
+  }
+}
+
+void putMatch(BitWriter& w, uint32_t len, uint32_t dist)
+{
+  uint8_t li = 28;
+  while (kLenBase[li] > len) {
+    li--;
+  }
+  putSymbol(w, (uint16_t)(257u + li));
+  if (kLenExtra[li] > 0u) {
+    w.put(len - kLenBase[li], kLenExtra[li]);
+  }
+
+  uint8_t di = 29;
+  while (kDistBase[di] > dist) {
+    di--;
+  }
+  w.code(di, 5);
+  if (kDistExtra[di] > 0u) {
+    w.put(dist - kDistBase[di], kDistExtra[di]);
+  }
+}
+
+inline uint32_t hash3(const uint8_t* p)
+{
+  const uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32u - kHashBits);
+}
+
+/** @brief Put pos at the front of its hash chain; returns the previous front. */
+inline uint16_t insert(const uint8_t* in, size_t pos)
+{
+  const uint32_t h             = hash3(&in[pos]);
+  const uint16_t prev          = s_head[h];
+  s_prev[pos & (kWindow - 1u)] = prev;
+  s_head[h]                    = (uint16_t)pos;
+  return prev;
+}
+
+} // namespace
+
+size_t compress(const uint8_t* in, size_t len, uint8_t* out, size_t cap)
+{
+  if (in == nullptr || out == nullptr || len > kMaxInput) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < (sizeof(s_head) / sizeof(s_head[0])); i++) {
+    s_head[i] = kNoPos;
+  }
+
+  BitWriter w(out, cap);
+  w.put(1u, 1); // BFINAL
+  w.put(1u, 2); // BTYPE = fixed Huffman
+
+  size_t pos = 0;
+  while (pos < len) {
+    uint32_t bestLen = 0;
+    uint32_t bestPos = 0;
+
+    if (pos + kMinMatch <= len) {
+      // Walk the chain, newest first, while candidates are inside the window.
+      // A slot of s_prev is only reused kWindow positions later, so every link
+      // followed here is still the one its position wrote.
+      const size_t limit = (len - pos < kMaxMatch) ? (len - pos) : kMaxMatch;
+      uint16_t     cand  = insert(in, pos);
+      for (uint32_t tries = 0; cand != kNoPos && (pos - cand) < kWindow && tries < kMaxChain; tries++) {
+        uint32_t n = 0;
+        while (n < limit && in[cand + n] == in[pos + n]) {
+          n++;
+        }
+        if (n > bestLen) {
+          bestLen = n;
+          bestPos = cand;
+          if (n == limit) {
+            break;
+          }
+        }
+        cand = s_prev[cand & (kWindow - 1u)];
+      }
+      if (bestLen < kMinMatch) {
+        bestLen = 0;
+      }
+    }
+
+    if (bestLen == 0u) {
+      putSymbol(w, in[pos]);
+      pos++;
+      continue;
+    }
+
+    putMatch(w, bestLen, (uint32_t)(pos - bestPos));
+    // Index the skipped positions too, so later repeats find them.
+    for (size_t i = pos + 1u; i < pos + bestLen && i + kMinMatch <= len; i++) {
+      (void)insert(in, i);
+    }
+    pos += bestLen;
+  }
+
+  putSymbol(w, 256u); // end of block
+  return w.finish();
+}
+
+} // namespace deflate
@@ -0,0 +1,146 @@
+#include "EnergyLedger.h"
+#include "RestartReason.h"
+#include "TimeUtil.h"
+
+#include <mbed.h>
+#include <platform/ScopedLock.h>
+
+namespace energyledger {
+
+static_assert(kBucketCount == WakeContext::kEnergyBuckets, "wake context must hold every bucket");
+
+namespace {
+
+static constexpr uint64_t kUampsMsPerUah = 3600000ull;  // 1 µAh = 3.6e6 µA*ms
+static constexpr uint32_t kMinTrackedForForecastS = 3600u;
+
+struct Activity {
+  uint8_t  depth;
+  uint32_t sinceMs;
+  uint32_t pendingMs;
+};
+
+static rtos::Mutex g_mx;
+static uint64_t    g_uAms[kBucketCount];  // µA*ms per bucket
+static uint32_t    g_trackedS     = 0;
+static uint32_t    g_trackedMsRem = 0;
+static uint32_t    g_lastSampleMs = 0;
+static bool        g_sampled      = false;
+static Activity    g_act[kBucketCount];
+
+bool isActivity(Bucket b)
+{
+  return b == Bucket::Attach || b == Bucket::Publish || b == Bucket::Warmup;
+}
+
+} // namespace
+
+void restore(const uint32_t uah[kBucketCount], uint32_t trackedS)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  for (size_t i = 0; i < kBucketCount; i++) {
+    g_uAms[i] = (uint64_t)uah[i] * kUampsMsPerUah;
+  }
+  g_trackedS = trackedS;
+}
+
+void save(uint32_t uah[kBucketCount], uint32_t& trackedS)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  for (size_t i = 0; i < kBucketCount; i++) {
+    uah[i] = (uint32_t)(g_uAms[i] / kUampsMsPerUah);
+  }
+  trackedS = g_trackedS;
+}
+
+void begin(Bucket activity)
+{
+  if (!isActivity(activity)) {
+    return;
+  }
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  Activity& a = g_act[(size_t)activity];
+  if (a.depth++ == 0u) {
+    a.sinceMs = timeutil::nowMs();
+  }
+}
+
+void end(Bucket activity)
+{
+  if (!isActivity(activity)) {
+    return;
+  }
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  Activity& a = g_act[(size_t)activity];
+  if (a.depth == 0u) {
+    return;
+  }
+  if (--a.depth == 0u) {
+    a.pendingMs += timeutil::nowMs() - a.sinceMs;
+  }
+}
+
+void sample(Bucket state, float currentMa, uint32_t now)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  if (!g_sampled) {
+    g_sampled      = true;
+    g_lastSampleMs = now;
+    return;
+  }
+
+  const uint32_t dtMs = now - g_lastSampleMs;
+  g_lastSampleMs      = now;
+
+  // Only discharge is consumption; charging intervals cost nothing.
+  const uint32_t drawUa = (currentMa < 0.0f) ? (uint32_t)(-currentMa * 1000.0f) : 0u;
+
+  g_uAms[(size_t)state] += (uint64_t)drawUa * dtMs;
+
+  for (size_t i = 0; i < kBucketCount; i++) {
+    Activity& a = g_act[i];
+    if (a.depth > 0u) {
+      a.pendingMs += now - a.sinceMs;
+      a.sinceMs = now;
+    }
+    if (a.pendingMs > 0u) {
+      g_uAms[i] += (uint64_t)drawUa * a.pendingMs;
+      a.pendingMs = 0;
+    }
+  }
+
+  g_trackedMsRem += dtMs;
+  g_trackedS += g_trackedMsRem / 1000u;
+  g_trackedMsRem %= 1000u;
+}
+
+void addCharge(Bucket bucket, uint32_t uah, uint32_t seconds)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  g_uAms[(size_t)bucket] += (uint64_t)uah * kUampsMsPerUah;
+  g_trackedS += seconds;
+}
+
+void addToJson(JsonDocument& doc, float remainingMah)
+{
+  uint32_t uah[kBucketCount];
+  uint32_t trackedS = 0;
+  save(uah, trackedS);
+
+  JsonArray arr = doc["energyUah"].to<JsonArray>();
+  // State buckets already contain the activity charge.
+  uint64_t totalUah = 0;
+  for (size_t i = 0; i < kBucketCount; i++) {
+    arr.add(uah[i]);
+    if (!isActivity((Bucket)i)) {
+      totalUah += uah[i];
+    }
+  }
+
+  if (trackedS >= kMinTrackedForForecastS && totalUah > 0u && remainingMah > 0.0f) {
+    const float avgUa = (float)totalUah * 3600.0f / (float)trackedS;
+    doc["daysToEmpty"] = (uint32_t)((remainingMah * 1000.0f / avgUa) / 24.0f);
+  }
+}
+
+} // namespace energyledger
@@ -1,17 +1,17 @@
 #include "EventBus.h"
 
 #include "Logger.h"
+#include "Metrics.h"
 
 #include <Arduino.h>
+#include <chrono>
 
 static const char* TAG = "EVTB";
 
 EventBus::EventBus(rtos::Mail<UiEventMsg, QUEUE_DEPTH_UI_TO_ORCH>& uiToOrchMail,
-                   rtos::Mail<CommsEventMsg, QUEUE_DEPTH_COMMS_TO_ORCH>& commsToOrchMail,
-                   rtos::Mail<WorkerEventMsg, QUEUE_DEPTH_WORKER_TO_ORCH>& workerToOrchMail)
+                   rtos::Mail<CommsEventMsg, QUEUE_DEPTH_COMMS_TO_ORCH>& commsToOrchMail)
   : _uiToOrchMail(uiToOrchMail),
-    _commsToOrchMail(commsToOrchMail),
-    _workerToOrchMail(workerToOrchMail)
+    _commsToOrchMail(commsToOrchMail)
 {
 }
 
@@ -19,7 +19,11 @@ bool EventBus::publish(const CommsEventMsg& evt)
 {
   CommsEventMsg* m = _commsToOrchMail.try_alloc();
   if (m == nullptr) {
+    metrics::queueFull(metrics::Queue::CommsToOrch);
     LOGW(TAG, "publish: commsToOrchMail alloc failed");
+    CommsEventMsg dropped = evt;
+    payloadpool::release(dropped.topic);
+    payloadpool::release(dropped.payload);
     return false;
   }
 
@@ -27,10 +31,14 @@ bool EventBus::publish(const CommsEventMsg& evt)
   const auto st = _commsToOrchMail.put(m);
   if (st != osOK) {
     LOGW(TAG, "publish: commsToOrchMail put failed");
+    payloadpool::release(m->topic);
+    payloadpool::release(m->payload);
     _commsToOrchMail.free(m);
     return false;
   }
 
+  metrics::enqueued(metrics::Queue::CommsToOrch);
+  _ready.set(FLAG_READY);
   return true;
 }
 
@@ -38,7 +46,10 @@ bool EventBus::publishUi(const UiEventMsg& evt)
 {
   UiEventMsg* m = _uiToOrchMail.try_alloc();
   if (m == nullptr) {
+    metrics::queueFull(metrics::Queue::UiToOrch);
     LOGW(TAG, "publishUi: uiToOrchMail alloc failed");
+    UiEventMsg dropped = evt;
+    payloadpool::release(dropped.value);
     return false;
   }
 
@@ -46,69 +57,65 @@ bool EventBus::publishUi(const UiEventMsg& evt)
   const auto st = _uiToOrchMail.put(m);
   if (st != osOK) {
     LOGW(TAG, "publishUi: uiToOrchMail put failed");
+    payloadpool::release(m->value);
     _uiToOrchMail.free(m);
     return false;
   }
 
+  metrics::enqueued(metrics::Queue::UiToOrch);
+  _ready.set(FLAG_READY);
   return true;
 }
 
-bool EventBus::publishWorker(const WorkerEventMsg& evt)
+bool EventBus::tryTake(DeviceEvent& outEvt)
 {
-  WorkerEventMsg* m = _workerToOrchMail.try_alloc();
-  if (m == nullptr) {
-    LOGW(TAG, "publishWorker: workerToOrchMail alloc failed");
-    return false;
+  // UI is low priority; comms events are handled first.
+  CommsEventMsg* comms = _commsToOrchMail.try_get();
+  if (comms != nullptr) {
+    metrics::dequeued(metrics::Queue::CommsToOrch);
+    outEvt.type = DeviceEvent::Type::Comms;
+    outEvt.data.comms = *comms;
+    _commsToOrchMail.free(comms);
+    return true;
   }
 
-  *m = evt;
-  const auto st = _workerToOrchMail.put(m);
-  if (st != osOK) {
-    LOGW(TAG, "publishWorker: workerToOrchMail put failed");
-    _workerToOrchMail.free(m);
-    return false;
+  UiEventMsg* ui = _uiToOrchMail.try_get();
+  if (ui != nullptr) {
+    metrics::dequeued(metrics::Queue::UiToOrch);
+    outEvt.type = DeviceEvent::Type::Ui;
+    outEvt.data.ui = *ui;
+    _uiToOrchMail.free(ui);
+    return true;
   }
 
-  return true;
+  return false;
 }
 
 bool EventBus::tryGetNext(DeviceEvent& outEvt, uint32_t timeoutMs)
 {
   // Provide a unified view over underlying mailboxes.
-  // UI is low priority; comms and worker events are handled first.
-
   const uint32_t startMs = millis();
 
-  while ((millis() - startMs) < timeoutMs) {
-    // Prefer comms events.
-    CommsEventMsg* comms = _commsToOrchMail.try_get();
-    if (comms != nullptr) {
-      outEvt.type = DeviceEvent::Type::Comms;
-      outEvt.data.comms = *comms;
-      _commsToOrchMail.free(comms);
+  while (true) {
+    if (tryTake(outEvt)) {
       return true;
     }
 
-    // Then poll worker events.
-    WorkerEventMsg* worker = _workerToOrchMail.try_get();
-    if (worker != nullptr) {
-      outEvt.type = DeviceEvent::Type::Worker;
-      outEvt.data.worker = *worker;
-      _workerToOrchMail.free(worker);
-      return true;
+    const uint32_t elapsed = millis() - startMs;
+    if (elapsed >= timeoutMs) {
+      return false;
     }
-
-    // Then poll UI.
-    UiEventMsg* ui = _uiToOrchMail.try_get();
-    if (ui != nullptr) {
-      outEvt.type = DeviceEvent::Type::Ui;
-      outEvt.data.ui = *ui;
-      _uiToOrchMail.free(ui);
-      return true;
-    }
-
-    delay(1);
+    // A put after tryTake() leaves the flag set, so this returns at once.
+    (void)_ready.wait_any_for(FLAG_READY, std::chrono::milliseconds(timeoutMs - elapsed));
   }
+}
 
-  return false;
+void EventBus::release(DeviceEvent& evt)
+{
+  if (evt.type == DeviceEvent::Type::Comms) {
+    payloadpool::release(evt.data.comms.topic);
+    payloadpool::release(evt.data.comms.payload);
+  } else if (evt.type == DeviceEvent::Type::Ui) {
+    payloadpool::release(evt.data.ui.value);
+  }
 }
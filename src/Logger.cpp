@@ -3,72 +3,588 @@
 #include <mbed.h>
 #include <platform/ScopedLock.h>
 
-#include <stdarg.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
 
-Stream*       Logger::_out = nullptr;
-Logger::Level Logger::_lvl = Logger::Level::Info;
-rtos::Mutex   Logger::_mx;
+Stream* Logger::_out = nullptr;
+
+Logger::LevelTable Logger::_tables[2] = {
+  {Logger::Level::Info, Logger::Level::Info, Logger::Level::Info, 0, {}},
+  {Logger::Level::Info, Logger::Level::Info, Logger::Level::Info, 0, {}},
+};
+std::atomic<uint8_t> Logger::_active{0};
+
+static rtos::Mutex s_levelsMx; // serializes writers of the level tables
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1u)) == 0u, "LOG_RING_SLOTS must be a power of two");
+
+// Slot state per lap L (pos / LOG_RING_SLOTS): 2L = free, 2L+1 = published.
+// Zero-initialised storage is therefore a valid empty ring, so logging works
+// before static constructors and before begin().
+static Logger::Record        s_ring[LOG_RING_SLOTS];
+static std::atomic<uint32_t> s_head{0};
+static uint32_t              s_tail = 0; // drain side, under s_drainMx
+static std::atomic<uint32_t> s_dropped{0};
+static std::atomic<bool>     s_drainIdle{false};
+
+static rtos::Mutex      s_drainMx;
+static rtos::EventFlags s_flags;
+static rtos::Thread     s_thread(PRIO_LOG, STACK_LOG, nullptr, "LOG");
+static bool             s_started = false;
+static Logger::Tap      s_tap     = nullptr; // under s_drainMx
+
+static constexpr uint32_t FLAG_READY = 1u << 0;
+
+static inline uint32_t lapOf(uint32_t pos) { return 2u * (pos / LOG_RING_SLOTS); }
+
+/**
+ * @brief Reads the packed arguments of a record in order.
+ */
+class ArgCursor {
+public:
+  explicit ArgCursor(const Logger::Record& r) : _r(r) {}
+
+  bool next(Logger::ArgType& t, const uint8_t*& p)
+  {
+    if (_i >= _r.nargs) {
+      return false;
+    }
+    t = _r.types[_i++];
+    p = &_r.data[_off];
+    switch (t) {
+    case Logger::ArgType::I32:
+      _off += 4u;
+      break;
+    case Logger::ArgType::Ptr:
+      _off += sizeof(uintptr_t);
+      break;
+    case Logger::ArgType::Str:
+      _off += strlen((const char*)p) + 1u;
+      break;
+    default:
+      _off += 8u;
+      break;
+    }
+    return true;
+  }
+
+  bool nextInt(int64_t& v)
+  {
+    Logger::ArgType t;
+    const uint8_t*  p = nullptr;
+    if (!next(t, p)) {
+      return false;
+    }
+    switch (t) {
+    case Logger::ArgType::I32: {
+      int32_t w;
+      memcpy(&w, p, sizeof(w));
+      v = w;
+      return true;
+    }
+    case Logger::ArgType::I64:
+      memcpy(&v, p, sizeof(v));
+      return true;
+    case Logger::ArgType::F64: {
+      double d;
+      memcpy(&d, p, sizeof(d));
+      v = (int64_t)d;
+      return true;
+    }
+    case Logger::ArgType::Ptr: {
+      uintptr_t u;
+      memcpy(&u, p, sizeof(u));
+      v = (int64_t)u;
+      return true;
+    }
+    default:
+      return false;
+    }
+  }
+
+private:
+  const Logger::Record& _r;
+  uint8_t               _i   = 0;
+  size_t                _off = 0;
+};
+
+/**
+ * @brief printf-style rendering of a record from its packed arguments.
+ *
+ * Each conversion is handed to snprintf on its own with the argument widened
+ * to the type the conversion expects; a missing argument prints "?".
+ */
+static size_t formatRecord(const Logger::Record& r, char* out, size_t cap)
+{
+  size_t      pos = 0;
+  const char* f   = r.fmt;
+  ArgCursor   args(r);
+
+  auto emit = [&](int n) {
+    if (n > 0) {
+      pos += ((size_t)n < cap - pos) ? (size_t)n : (cap - pos - 1u);
+    }
+  };
+
+  while (*f != '\0' && pos + 1u < cap) {
+    if (*f != '%') {
+      out[pos++] = *f++;
+      continue;
+    }
+    f++;
+    if (*f == '%') {
+      out[pos++] = *f++;
+      continue;
+    }
+
+    char   spec[24];
+    size_t sl  = 0;
+    spec[sl++] = '%';
+    while (*f != '\0' && strchr("-+ #0", *f) != nullptr && sl < 8u) {
+      spec[sl++] = *f++;
+    }
+    for (int part = 0; part < 2; part++) {
+      if (part == 1) {
+        if (*f != '.') {
+          break;
+        }
+        spec[sl++] = *f++;
+      }
+      if (*f == '*') {
+        f++;
+        int64_t w = 0;
+        (void)args.nextInt(w);
+        sl += (size_t)snprintf(&spec[sl], 6u, "%d", (int)(w < 0 ? 0 : (w > 999 ? 999 : w)));
+      }
+      while (isdigit((unsigned char)*f)) {
+        if (sl < 16u) {
+          spec[sl++] = *f;
+        }
+        f++;
+      }
+    }
+
+    // 0 none, 1 h, 2 hh, 3 l, 4 ll/j/z/t/L
+    int lenMod = 0;
+    if (*f == 'h') {
+      lenMod = (f[1] == 'h') ? 2 : 1;
+      f += lenMod;
+    } else if (*f == 'l') {
+      lenMod = (f[1] == 'l') ? 4 : 3;
+      f += (lenMod == 4) ? 2 : 1;
+    } else if (*f == 'j' || *f == 'z' || *f == 't' || *f == 'L') {
+      lenMod = 4;
+      f++;
+    }
+
+    const char conv = *f;
+    if (conv == '\0') {
+      break;
+    }
+    f++;
+
+    Logger::ArgType t;
+    const uint8_t*  p = nullptr;
+    switch (conv) {
+    case 'd':
+    case 'i': {
+      int64_t v = 0;
+      if (!args.nextInt(v)) {
+        emit(snprintf(&out[pos], cap - pos, "?"));
+        break;
+      }
+      if (lenMod == 1) {
+        v = (int16_t)v;
+      } else if (lenMod == 2) {
+        v = (int8_t)v;
+      }
+      spec[sl++] = 'l';
+      spec[sl++] = 'l';
+      spec[sl++] = conv;
+      spec[sl]   = '\0';
+      emit(snprintf(&out[pos], cap - pos, spec, (long long)v));
+      break;
+    }
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+    case 'c': {
+      int64_t v = 0;
+      if (!args.nextInt(v)) {
+        emit(snprintf(&out[pos], cap - pos, "?"));
+        break;
+      }
+      uint64_t u = (uint64_t)v;
+      if (lenMod == 1) {
+        u = (uint16_t)u;
+      } else if (lenMod == 2) {
+        u = (uint8_t)u;
+      } else if (lenMod == 0 || (lenMod == 3 && sizeof(long) == 4u)) {
+        u = (uint32_t)u;
+      }
+      if (conv == 'c') {
+        spec[sl++] = 'c';
+        spec[sl]   = '\0';
+        emit(snprintf(&out[pos], cap - pos, spec, (int)u));
+        break;
+      }
+      spec[sl++] = 'l';
+      spec[sl++] = 'l';
+      spec[sl++] = conv;
+      spec[sl]   = '\0';
+      emit(snprintf(&out[pos], cap - pos, spec, (unsigned long long)u));
+      break;
+    }
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': {
+      double d = 0.0;
+      if (!args.next(t, p)) {
+        emit(snprintf(&out[pos], cap - pos, "?"));
+        break;
+      }
+      if (t == Logger::ArgType::F64) {
+        memcpy(&d, p, sizeof(d));
+      } else if (t == Logger::ArgType::I32) {
+        int32_t w;
+        memcpy(&w, p, sizeof(w));
+        d = w;
+      } else if (t == Logger::ArgType::I64) {
+        int64_t w;
+        memcpy(&w, p, sizeof(w));
+        d = (double)w;
+      }
+      spec[sl++] = conv;
+      spec[sl]   = '\0';
+      emit(snprintf(&out[pos], cap - pos, spec, d));
+      break;
+    }
+    case 's': {
+      const char* s = "?";
+      if (args.next(t, p) && t == Logger::ArgType::Str) {
+        s = (const char*)p;
+      }
+      spec[sl++] = 's';
+      spec[sl]   = '\0';
+      emit(snprintf(&out[pos], cap - pos, spec, s));
+      break;
+    }
+    case 'p': {
+      uintptr_t u = 0;
+      if (args.next(t, p) && t == Logger::ArgType::Ptr) {
+        memcpy(&u, p, sizeof(u));
+      }
+      emit(snprintf(&out[pos], cap - pos, "%p", (void*)u));
+      break;
+    }
+    default:
+      // Unknown conversion: print it as written.
+      emit(snprintf(&out[pos], cap - pos, "%%%c", conv));
+      break;
+    }
+  }
+
+  out[pos] = '\0';
+  return pos;
+}
+
+static char levelChar(Logger::Level lvl)
+{
+  switch (lvl) {
+  case Logger::Level::Trace:
+    return 'T';
+  case Logger::Level::Debug:
+    return 'D';
+  case Logger::Level::Info:
+    return 'I';
+  case Logger::Level::Warn:
+    return 'W';
+  case Logger::Level::Error:
+    return 'E';
+  default:
+    return '?';
+  }
+}
 
 /**
- * @brief Initialize logger output stream.
+ * @brief Initialize logger output stream and start the drain thread.
  */
 void Logger::begin(Stream& s, uint32_t baud)
 {
   (void)baud;
-  mbed::ScopedLock<rtos::Mutex> lock(_mx);
-  _out = &s;
+  {
+    mbed::ScopedLock<rtos::Mutex> lock(s_drainMx);
+    _out = &s;
+  }
+  if (!s_started) {
+    s_started = true;
+    s_thread.start(mbed::callback(Logger::threadEntry));
+  }
+}
+
+static bool parseLevelName(const char* s, size_t n, Logger::Level& out)
+{
+  static const char* const kNames[] = {"trace", "debug", "info", "warn", "error", "none"};
+  for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); i++) {
+    if (strlen(kNames[i]) == n && strncasecmp(kNames[i], s, n) == 0) {
+      out = (Logger::Level)i;
+      return true;
+    }
+  }
+  return false;
 }
 
 /**
- * @brief Set runtime log verbosity.
+ * @brief Parse "level,TAG=level,..." into out (lo/hi filled in).
  */
-void Logger::set_runtime_level(Level lvl) { _lvl = lvl; }
+bool Logger::parseLevels(const char* spec, LevelTable& out)
+{
+  out           = LevelTable{Level::Info, Level::Info, Level::Info, 0, {}};
+  const char* p = (spec != nullptr) ? spec : "";
+
+  while (*p != '\0') {
+    while (*p == ',' || *p == ' ') {
+      p++;
+    }
+    const char* tok = p;
+    while (*p != '\0' && *p != ',' && *p != ' ') {
+      p++;
+    }
+    const size_t n = (size_t)(p - tok);
+    if (n == 0u) {
+      continue;
+    }
+
+    const char* eq = (const char*)memchr(tok, '=', n);
+    Level       lvl;
+    if (eq == nullptr) {
+      if (!parseLevelName(tok, n, lvl)) {
+        return false;
+      }
+      out.global = lvl;
+      continue;
+    }
+
+    const size_t tagLen = (size_t)(eq - tok);
+    if (tagLen == 0u || tagLen >= sizeof(out.tags[0].tag) || out.count >= kMaxTagLevels ||
+        !parseLevelName(eq + 1, n - tagLen - 1u, lvl)) {
+      return false;
+    }
+    TagLevel& t = out.tags[out.count++];
+    for (size_t i = 0; i < tagLen; i++) {
+      t.tag[i] = (char)toupper((unsigned char)tok[i]);
+    }
+    t.tag[tagLen] = '\0';
+    t.lvl         = lvl;
+  }
+
+  updateBounds(out);
+  return true;
+}
+
+void Logger::updateBounds(LevelTable& t)
+{
+  t.lo = t.global;
+  t.hi = t.global;
+  for (uint8_t i = 0; i < t.count; i++) {
+    if (t.tags[i].lvl < t.lo) {
+      t.lo = t.tags[i].lvl;
+    }
+    if (t.tags[i].lvl > t.hi) {
+      t.hi = t.tags[i].lvl;
+    }
+  }
+}
 
 /**
- * @brief Print formatted log line.
+ * @brief Publish t as the active table (writers hold s_levelsMx).
  */
-void Logger::log(Level lvl, const char* tag, const char* fmt, ...)
+void Logger::install(const LevelTable& t)
+{
+  const uint8_t next = (uint8_t)(_active.load(std::memory_order_relaxed) ^ 1u);
+  _tables[next]      = t;
+  _active.store(next, std::memory_order_release);
+}
+
+Logger::Level Logger::tagLevel(const LevelTable& t, const char* tag)
 {
+  if (tag != nullptr) {
+    for (uint8_t i = 0; i < t.count; i++) {
+      if (t.tags[i].tag[0] == tag[0] && strcmp(t.tags[i].tag, tag) == 0) {
+        return t.tags[i].lvl;
+      }
+    }
+  }
+  return t.global;
+}
+
+/**
+ * @brief Set the default runtime level; per-tag overrides are kept.
+ */
+void Logger::set_runtime_level(Level lvl)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(s_levelsMx);
+  LevelTable                    t = _tables[_active.load(std::memory_order_relaxed)];
+  t.global                        = lvl;
+  updateBounds(t);
+  install(t);
+}
+
+bool Logger::setLevels(const char* spec)
+{
+  LevelTable t;
+  if (!parseLevels(spec, t)) {
+    return false;
+  }
+  mbed::ScopedLock<rtos::Mutex> lock(s_levelsMx);
+  install(t);
+  return true;
+}
+
+bool Logger::validLevels(const char* spec)
+{
+  LevelTable t;
+  return parseLevels(spec, t);
+}
+
+uint32_t Logger::dropped() { return s_dropped.load(std::memory_order_relaxed); }
+
+void Logger::setTap(Tap tap)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(s_drainMx);
+  s_tap = tap;
+}
+
+/**
+ * @brief Reserve the next ring slot, or count a drop if the ring is full.
+ *
+ * Lock-free: producers race on s_head with a CAS and never wait on the
+ * drain side, so this is safe from any thread priority.
+ */
+Logger::Record* Logger::claim(Level lvl, const char* tag, const char* fmt)
+{
+  uint32_t pos = s_head.load(std::memory_order_relaxed);
+  while (true) {
+    Record&        r    = s_ring[pos & (LOG_RING_SLOTS - 1u)];
+    const uint32_t lap  = lapOf(pos);
+    const int32_t  diff = (int32_t)(r.seq.load(std::memory_order_acquire) - lap);
+    if (diff == 0) {
+      if (s_head.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed)) {
+        r.tsMs  = millis();
+        r.tag   = tag;
+        r.fmt   = fmt;
+        r.lvl   = lvl;
+        r.nargs = 0;
+        r.len   = 0;
+        return &r;
+      }
+    } else if (diff < 0) {
+      // Oldest record not printed yet: the ring is full.
+      s_dropped.fetch_add(1u, std::memory_order_relaxed);
+      return nullptr;
+    } else {
+      pos = s_head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * @brief Hand a filled slot to the drain side; wakes the LOG thread if idle.
+ */
+void Logger::publish(Record* r)
+{
+  r->seq.store(r->seq.load(std::memory_order_relaxed) + 1u, std::memory_order_seq_cst);
+  if (s_drainIdle.exchange(false)) {
+    s_flags.set(FLAG_READY);
+  }
+}
+
+static bool ringHasPublished()
+{
+  const Logger::Record& r = s_ring[s_tail & (LOG_RING_SLOTS - 1u)];
+  return r.seq.load(std::memory_order_seq_cst) == lapOf(s_tail) + 1u;
+}
+
+/**
+ * @brief Format and print every published record in order.
+ */
+void Logger::drain()
+{
+  mbed::ScopedLock<rtos::Mutex> lock(s_drainMx);
   if (_out == nullptr) {
     return;
   }
-  if (lvl < _lvl) {
-    return;
+
+  static uint32_t reported = 0;
+  char            line[320];
+
+  while (ringHasPublished()) {
+    Record& r = s_ring[s_tail & (LOG_RING_SLOTS - 1u)];
+
+    size_t n = (size_t)snprintf(line, sizeof(line), "[%c] %lu %s: ", levelChar(r.lvl),
+                                (unsigned long)r.tsMs, r.tag);
+    if (n >= sizeof(line)) {
+      n = sizeof(line) - 1u;
+    }
+    n += formatRecord(r, &line[n], sizeof(line) - n);
+
+    // The text is in line[], so the slot can be reused before the slow write.
+    r.seq.store(lapOf(s_tail) + 2u, std::memory_order_release);
+    s_tail++;
+
+    if (s_tap != nullptr) {
+      s_tap(line, n);
+    }
+    _out->write((const uint8_t*)line, n);
+    _out->println();
   }
 
-  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  const uint32_t lost = s_dropped.load(std::memory_order_relaxed);
+  if (lost != reported) {
+    _out->print("[W] LOG: ring full, dropped ");
+    _out->print((unsigned long)(lost - reported));
+    _out->println(" line(s)");
+    reported = lost;
+  }
+}
 
-  const char* lvlStr = "?";
-  switch (lvl) {
-  case Level::Trace:
-    lvlStr = "T";
-    break;
-  case Level::Debug:
-    lvlStr = "D";
-    break;
-  case Level::Info:
-    lvlStr = "I";
-    break;
-  case Level::Warn:
-    lvlStr = "W";
-    break;
-  case Level::Error:
-    lvlStr = "E";
-    break;
-  default:
-    break;
+/**
+ * @brief Drain synchronously on the calling thread, then flush the stream.
+ */
+void Logger::flush()
+{
+  drain();
+  mbed::ScopedLock<rtos::Mutex> lock(s_drainMx);
+  if (_out != nullptr) {
+    _out->flush();
   }
+}
 
-  char    buf[256];
-  va_list ap;
-  va_start(ap, fmt);
-  vsnprintf(buf, sizeof(buf), fmt, ap);
-  va_end(ap);
+void Logger::threadEntry()
+{
+  while (true) {
+    drain();
 
-  _out->print("[");
-  _out->print(lvlStr);
-  _out->print("] ");
-  _out->print(tag);
-  _out->print(": ");
-  _out->println(buf);
+    // Announce idle, then look again: a record published between the drain
+    // and the store would otherwise sit until the next one arrives.
+    s_drainIdle.store(true);
+    bool pending;
+    {
+      mbed::ScopedLock<rtos::Mutex> lock(s_drainMx);
+      pending = ringHasPublished();
+    }
+    if (pending) {
+      s_drainIdle.store(false);
+      continue;
+    }
+    s_flags.wait_any(FLAG_READY);
+  }
 }
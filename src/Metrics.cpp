@@ -0,0 +1,102 @@
+#include "Metrics.h"
+#include "Logger.h"
+
+#include <atomic>
+
+namespace metrics {
+namespace {
+
+// Upper bounds (inclusive) of all but the last bucket.
+static const uint32_t kBounds[kHistogramCount][kHistogramBuckets - 1u] = {
+    {50u, 100u, 250u, 500u, 1000u, 2500u, 5000u}, // PublishMs
+};
+
+struct Depth {
+  std::atomic<uint32_t> now{0};
+  std::atomic<uint32_t> high{0};
+  std::atomic<uint32_t> full{0};
+};
+
+struct Hist {
+  std::atomic<uint32_t> buckets[kHistogramBuckets];
+  std::atomic<uint32_t> max{0};
+};
+
+static std::atomic<uint32_t> g_counters[kCounterCount];
+static Depth                 g_queues[kQueueCount];
+static Hist                  g_hists[kHistogramCount];
+
+void raiseTo(std::atomic<uint32_t>& slot, uint32_t v)
+{
+  uint32_t cur = slot.load(std::memory_order_relaxed);
+  while (v > cur && !slot.compare_exchange_weak(cur, v, std::memory_order_relaxed)) {
+  }
+}
+
+} // namespace
+
+void count(Counter c, uint32_t n)
+{
+  g_counters[(size_t)c].fetch_add(n, std::memory_order_relaxed);
+}
+
+uint32_t value(Counter c)
+{
+  return g_counters[(size_t)c].load(std::memory_order_relaxed);
+}
+
+void enqueued(Queue q)
+{
+  Depth& d = g_queues[(size_t)q];
+  raiseTo(d.high, d.now.fetch_add(1u, std::memory_order_relaxed) + 1u);
+}
+
+void dequeued(Queue q)
+{
+  // A get racing ahead of its put's enqueued() must not wrap the depth.
+  std::atomic<uint32_t>& now = g_queues[(size_t)q].now;
+  uint32_t               cur = now.load(std::memory_order_relaxed);
+  while (cur > 0u && !now.compare_exchange_weak(cur, cur - 1u, std::memory_order_relaxed)) {
+  }
+}
+
+void queueFull(Queue q)
+{
+  g_queues[(size_t)q].full.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void observe(Histogram h, uint32_t v)
+{
+  Hist&  hist = g_hists[(size_t)h];
+  size_t b    = 0;
+  while (b < kHistogramBuckets - 1u && v > kBounds[(size_t)h][b]) {
+    b++;
+  }
+  hist.buckets[b].fetch_add(1u, std::memory_order_relaxed);
+  raiseTo(hist.max, v);
+}
+
+void addToJson(JsonDocument& doc)
+{
+  JsonArray c = doc["c"].to<JsonArray>();
+  for (size_t i = 0; i < kCounterCount; i++) {
+    c.add(g_counters[i].load(std::memory_order_relaxed));
+  }
+
+  JsonArray hw   = doc["qHw"].to<JsonArray>();
+  JsonArray full = doc["qFull"].to<JsonArray>();
+  for (size_t i = 0; i < kQueueCount; i++) {
+    hw.add(g_queues[i].high.load(std::memory_order_relaxed));
+    full.add(g_queues[i].full.load(std::memory_order_relaxed));
+  }
+
+  const Hist& pub = g_hists[(size_t)Histogram::PublishMs];
+  JsonArray   pb  = doc["pubMs"].to<JsonArray>();
+  for (size_t i = 0; i < kHistogramBuckets; i++) {
+    pb.add(pub.buckets[i].load(std::memory_order_relaxed));
+  }
+  doc["pubMsMax"] = pub.max.load(std::memory_order_relaxed);
+  doc["logDrop"]  = Logger::dropped();
+}
+
+} // namespace metrics
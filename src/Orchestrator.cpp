@@ -4,15 +4,20 @@
 #include "EventBus.h"
 #include "CommsEgress.h"
 #include "SettingsManager.h"
+#include "SettingsSchema.h"
 #include "SessionClock.h"
 #include "SamplingThread.h"
 #include "AggregatorThread.h"
 #include "PowerManager.h"
+#include "PowerUtil.h"
 #include "RuntimeStatus.h"
 #include "BoardHal.h"
+#include "EnergyLedger.h"
 #include "HastigGlobals.h"
 
 #include "Logger.h"
+#include "Metrics.h"
+#include "ThreadProfiler.h"
 #include "StopUtil.h"
 #include "TimeUtil.h"
 
@@ -63,30 +68,16 @@ bool parseDoubleValue(const char* text, double& outValue)
 
 bool setupPropIsNumeric(const char* prop)
 {
-  if (prop == nullptr) {
-    return false;
-  }
-
-  return strcmp(prop, "sensorAddress") == 0 ||
-         strcmp(prop, "sensorBaudrate") == 0 ||
-         strcmp(prop, "sensorWarmupMs") == 0 ||
-         strcmp(prop, "sensorType") == 0 ||
-         strcmp(prop, "samplingInterval") == 0 ||
-         strcmp(prop, "aggPeriodS") == 0 ||
-         strcmp(prop, "mqttPort") == 0 ||
-         strcmp(prop, "awareTimeoutS") == 0 ||
-         strcmp(prop, "defaultSleepS") == 0 ||
-         strcmp(prop, "statusIntervalS") == 0 ||
-         strcmp(prop, "lowBattMinV") == 0 ||
-         strcmp(prop, "maxChargingCurrent") == 0 ||
-         strcmp(prop, "maxChargingVoltage") == 0 ||
-         strcmp(prop, "emergencyDelayS") == 0 ||
-         strcmp(prop, "emergencySleepS") == 0 ||
-         strcmp(prop, "maxForcedSleepS") == 0 ||
-         strcmp(prop, "maxUnackedPackets") == 0;
+  const settingsschema::Field* f = settingsschema::find(prop);
+  return f != nullptr && settingsschema::isNumeric(*f);
 }
 } // namespace
 
+bool Orchestrator::scheduleEnabled(const AppSettings& s)
+{
+  return s.sched_interval_s > 0u && s.sched_duration_s > 0u && s.sched_duration_s < s.sched_interval_s;
+}
+
 /**
  * @brief Construct orchestrator.
  */
@@ -115,6 +106,9 @@ Orchestrator::Orchestrator(EventBus& eventBus,
  */
 void Orchestrator::start()
 {
+  _logSub.interest = settingsGroupBit(SettingsGroup::Logging) | settingsGroupBit(SettingsGroup::Power);
+  (void)_settings.subscribe(_logSub);
+
   _thread.start(mbed::callback(Orchestrator::threadEntry, this));
 }
 
@@ -215,6 +209,8 @@ void Orchestrator::enterState(State s)
       reasonStr = "emergencyPowerSave";
     } else if (_hibernateReason == HibernateReason::NoNetwork) {
       reasonStr = "noNetwork";
+    } else if (_hibernateReason == HibernateReason::Schedule) {
+      reasonStr = "schedule";
     }
 
     if (isModeChange) {
@@ -227,24 +223,17 @@ void Orchestrator::enterState(State s)
 }
 
 /**
- * @brief Handle server command message.
+ * @brief Handle a decoded server (or UI) command.
  *
- * Expected command types:
+ * Commands are decoded once by CommsPump. Expected command types:
  *  - {"type":"startSampling", ...}
  *  - {"type":"stopSampling"}
  *  - {"type":"keepSampling"}
  *  - {"type":"hibernate", "sleepSeconds":...}
- *  - {"type":"getConfig"}
+ *  - {"type":"getConfig", "format":"msgpack", "digest":...}
  */
-void Orchestrator::handleServerCommand(const char* topic, const char* json)
+void Orchestrator::handleServerCommand(const protocol::Command& cmd)
 {
-  (void)topic;
-  protocol::Command cmd;
-  if (!protocol::decodeCommand(json, cmd)) {
-    LOGW(TAG, "Bad JSON");
-    return;
-  }
-
   _lastActivityMs = timeutil::nowMs();
 
   if (cmd.type == protocol::Command::Type::nudge) {
@@ -257,6 +246,14 @@ void Orchestrator::handleServerCommand(const char* topic, const char* json)
     return;
   }
 
+  if (cmd.type == protocol::Command::Type::startSampling ||
+      cmd.type == protocol::Command::Type::stopSampling) {
+    // The server takes over; a scheduled session ends here.
+    _settings.setSessionOverride(0u, 0u);
+    _autonomous    = false;
+    _uploadStartMs = 0;
+  }
+
   if (cmd.type == protocol::Command::Type::startSampling) {
     // Optional overrides
     JsonDocument patch;
@@ -295,8 +292,8 @@ void Orchestrator::handleServerCommand(const char* topic, const char* json)
   }
 
   if (cmd.type == protocol::Command::Type::getConfig) {
-    // Ask comms layer to publish a (possibly chunked) config snapshot.
-    _commsEgress.publishConfig();
+    // Ask comms layer to publish a config snapshot (or just its digest).
+    _commsEgress.publishConfig(cmd.configBinary, cmd.hasConfigDigest, cmd.configDigest);
     return;
   }
 
@@ -344,13 +341,13 @@ void Orchestrator::handleUiEvent(const UiEventMsg& uiEvt)
     char commandType[48] = {0};
 
     JsonDocument retvalDoc;
-    const auto parseErr = deserializeJson(retvalDoc, uiEvt.value);
+    const auto parseErr = deserializeJson(retvalDoc, payloadpool::str(uiEvt.value));
     if (!parseErr) {
       const char* valueStr = retvalDoc["value"] | "";
       strncpy(commandType, valueStr, sizeof(commandType));
       commandType[sizeof(commandType) - 1] = '\0';
     } else {
-      strncpy(commandType, uiEvt.value, sizeof(commandType));
+      strncpy(commandType, payloadpool::str(uiEvt.value), sizeof(commandType));
       commandType[sizeof(commandType) - 1] = '\0';
     }
 
@@ -359,23 +356,15 @@ void Orchestrator::handleUiEvent(const UiEventMsg& uiEvt)
       return;
     }
 
-    JsonDocument cmdDoc;
-    cmdDoc[protocol::kKeyType] = commandType;
-
-    char cmdJson[128];
-    const size_t n = serializeJson(cmdDoc, cmdJson, sizeof(cmdJson));
-    if (n == 0) {
-      LOGW(TAG, "UI cmd ignored (serialize failed)");
-      return;
-    }
-
-    handleServerCommand("ui/cmd", cmdJson);
+    protocol::Command cmd;
+    cmd.type = protocol::decodeType(commandType, strlen(commandType));
+    handleServerCommand(cmd);
     return;
   }
 
   if (strcmp(uiEvt.topic, "setup") == 0) {
     JsonDocument retvalDoc;
-    const auto parseErr = deserializeJson(retvalDoc, uiEvt.value);
+    const auto parseErr = deserializeJson(retvalDoc, payloadpool::str(uiEvt.value));
     if (parseErr) {
       LOGW(TAG, "UI setup ignored (bad JSON)");
       return;
@@ -451,15 +440,41 @@ void Orchestrator::checkTimeouts()
 {
   const AppSettings s    = _settings.getCopy();
   const uint32_t    now  = timeutil::nowMs();
+
+  // Samples flowing count as activity (read from the counter, no per-sample event).
+  const uint32_t produced = metrics::value(metrics::Counter::SamplesProduced);
+  if (produced != _seenSamples) {
+    _seenSamples    = produced;
+    _lastActivityMs = now;
+  }
   _runtimeStatus.setAwareWindow(_lastActivityMs, s.aware_timeout_s);
 
+  const uint8_t changed = _logSub.consume();
+  if ((changed & settingsGroupBit(SettingsGroup::Logging)) != 0u) {
+    (void)Logger::setLevels(s.log_levels);
+    LOGI(TAG, "Log levels: %s", s.log_levels);
+  }
+  if ((changed & settingsGroupBit(SettingsGroup::Power)) != 0u) {
+    powerutil::setIdleDeepSleep(s.low_power_idle != 0u);
+  }
+
+  // Energy ledger. Hibernating here means "awake, waiting for PowerManager", so it counts as aware.
+  if (_lastEnergyMs == 0u || (now - _lastEnergyMs) >= ENERGY_SAMPLE_MS) {
+    _lastEnergyMs = now;
+    energyledger::sample((_state == State::Sampling) ? energyledger::Bucket::Sampling : energyledger::Bucket::Aware,
+                         hastig_battery().averageCurrent(), now);
+  }
+  updatePowerPolicy(now, s.low_batt_min_v);
+  updateThreadProfile(now);
+  const uint16_t stretch = _powerPolicy.stretchPermille();
+
   // Periodic battery/status reporting (aware + sampling).
   if (_state == State::Aware || _state == State::Sampling) {
-    if (_lastStatusMs == 0 || (now - _lastStatusMs) > (s.status_interval_s * 1000u)) {
+    if (_lastStatusMs == 0 || (now - _lastStatusMs) > PowerPolicy::scale(s.status_interval_s * 1000u, stretch)) {
       const BoardHal::BatterySnapshot bs = BoardHal::readBattery(hastig_battery());
 
       const char* modeStr = (_state == State::Sampling) ? "sampling" : "aware";
-      _commsEgress.publishStatus(bs, modeStr);
+      _commsEgress.publishStatus(bs, modeStr, stretch);
 
       _lastStatusMs = now;
 
@@ -487,13 +502,25 @@ void Orchestrator::checkTimeouts()
     return;
   }
 
+  if (_autonomous) {
+    // No acks or inactivity rules while running unattended.
+    checkScheduledSession(now);
+    return;
+  }
+
   // Inactivity hibernate (aware or sampling) after last activity.
   if ((_state == State::Aware || _state == State::Sampling) &&
       (now - _lastActivityMs) > (s.aware_timeout_s * 1000u)) {
-    LOGI(TAG, "Inactivity -> hibernate for %lu s", (unsigned long)s.default_sleep_s);
+    if (scheduleEnabled(s)) {
+      LOGI(TAG, "Inactivity -> hibernate until next scheduled session");
+      hibernateUntilNextSlot(PowerPolicy::scale(s.sched_interval_s, stretch));
+      return;
+    }
+    const uint32_t sleepS = PowerPolicy::scale(s.default_sleep_s, stretch);
+    LOGI(TAG, "Inactivity -> hibernate for %lu s", (unsigned long)sleepS);
     _hibernateReason = HibernateReason::Inactivity;
-    _forcedHibernateS = s.default_sleep_s;
-    _powerManager.requestSleep(RestartReasonCode::LowPowerWakeup, s.default_sleep_s);
+    _forcedHibernateS = sleepS;
+    _powerManager.requestSleep(RestartReasonCode::LowPowerWakeup, sleepS);
     enterState(State::Hibernating);
     return;
   }
@@ -514,11 +541,169 @@ void Orchestrator::checkTimeouts()
   }
 }
 
+/**
+ * @brief How long run() may block waiting for events.
+ *
+ * Timers with sub-second precision get their own deadline; everything else
+ * in checkTimeouts() works in seconds and is covered by ORCH_IDLE_MAX_MS.
+ */
+uint32_t Orchestrator::idleWaitMs(uint32_t nowMs) const
+{
+  uint32_t wait = ORCH_IDLE_MAX_MS;
+  const auto until = [&](uint32_t dueMs) {
+    const int32_t left = (int32_t)(dueMs - nowMs);
+    const uint32_t ms  = (left > 0) ? (uint32_t)left : 0u;
+    if (ms < wait) {
+      wait = ms;
+    }
+  };
+
+  if (_emergencyArmed) {
+    until(_emergencyAtMs);
+  }
+  if (_autonomous && _state == State::Sampling) {
+    until(_autoEndMs);
+  }
+  return wait;
+}
+
+/**
+ * @brief Feed the battery policy every POWER_POLICY_PERIOD_MS and publish its factor.
+ *
+ * The emergency hibernate stays as the last resort below low_batt_min_v;
+ * the policy is meant to stretch the node's duty well before that.
+ */
+void Orchestrator::updatePowerPolicy(uint32_t nowMs, float lowBattV)
+{
+  if (_lastPolicyMs != 0u && (nowMs - _lastPolicyMs) < POWER_POLICY_PERIOD_MS) {
+    return;
+  }
+  _lastPolicyMs = nowMs;
+
+  Battery& battery = hastig_battery();
+  PowerPolicy::Reading r;
+  r.tMs            = nowMs;
+  r.socPct         = battery.percentage();
+  r.currentMa      = battery.averageCurrent();
+  r.minimumVoltage = battery.minimumVoltage();
+
+  const uint16_t before = _powerPolicy.stretchPermille();
+  const uint16_t after  = _powerPolicy.update(r, lowBattV);
+  if (after != before) {
+    LOGI(TAG, "Power stretch %u -> %u permille (soc %.0f%%, trend %.2f %%/h)",
+         (unsigned)before, (unsigned)after, (double)r.socPct, (double)_powerPolicy.socPerHour());
+    _runtimeStatus.setPowerStretch(after);
+  }
+}
+
+/**
+ * @brief Close the thread profiler window every THREAD_PROFILE_WINDOW_MS.
+ */
+void Orchestrator::updateThreadProfile(uint32_t nowMs)
+{
+  if ((nowMs - _lastProfileMs) < THREAD_PROFILE_WINDOW_MS) {
+    return;
+  }
+  _lastProfileMs = nowMs;
+  threadprof::sample(nowMs);
+
+  for (size_t i = 0; i < threadprof::kSlotCount; i++) {
+    threadprof::Stats st;
+    if (threadprof::stats((threadprof::Slot)i, st)) {
+      LOGD(TAG, "Thread %s: stack %lu/%lu B, cpu %u permille", st.name, (unsigned long)st.stackPeak,
+           (unsigned long)st.stackSize, (unsigned)st.cpuPermille);
+    }
+  }
+}
+
+/**
+ * @brief Start an unattended session from the persisted schedule.
+ *
+ * Aggregates stay queued for comms until the radio comes back, so the
+ * window is stretched to keep the session within the agg->comms mailbox.
+ */
+void Orchestrator::startScheduledSession()
+{
+  const AppSettings s = _settings.getCopy();
+  if (!scheduleEnabled(s)) {
+    LOGW(TAG, "Scheduled wake but schedule is off");
+    return;
+  }
+
+  uint32_t sampleMs = 0;
+  if (s.sched_sample_period_ms > 0u) {
+    sampleMs = (s.sched_sample_period_ms < MIN_SAMPLE_PERIOD_MS) ? MIN_SAMPLE_PERIOD_MS : s.sched_sample_period_ms;
+  }
+  uint32_t aggS = (s.sched_agg_period_s > 0u) ? s.sched_agg_period_s : s.agg_period_s;
+  const uint32_t minAggS = (s.sched_duration_s + QUEUE_DEPTH_AGG_TO_COMMS - 1u) / QUEUE_DEPTH_AGG_TO_COMMS;
+  if (aggS < minAggS) {
+    aggS = minAggS;
+  }
+  // An override, not a settings patch: a later save() must not persist it.
+  _settings.setSessionOverride(sampleMs, (aggS != s.agg_period_s) ? aggS : 0u);
+
+  const uint32_t now = timeutil::nowMs();
+  _autonomous    = true;
+  _uploadStartMs = 0;
+  _autoEndMs     = now + s.sensor_warmup_ms + s.sched_duration_s * 1000u;
+  LOGI(TAG, "Scheduled session: %lu s, agg %lu s, radio off until done",
+       (unsigned long)s.sched_duration_s,
+       (unsigned long)aggS);
+
+  _clock.startNewSession(nullptr);
+  enterState(State::Sampling);
+}
+
+/**
+ * @brief Scheduled session progress: stop sampling, wait for the upload, hibernate.
+ */
+void Orchestrator::checkScheduledSession(uint32_t nowMs)
+{
+  if (_state == State::Sampling && (int32_t)(nowMs - _autoEndMs) >= 0) {
+    LOGI(TAG, "Scheduled session done, uploading");
+    enterState(State::Aware);
+    _uploadStartMs = nowMs;
+    return;
+  }
+
+  if (_state != State::Aware || _uploadStartMs == 0u) {
+    return;
+  }
+
+  const AppSettings s        = _settings.getCopy();
+  const uint32_t    interval = PowerPolicy::scale(s.sched_interval_s, _powerPolicy.stretchPermille());
+  const uint32_t    awake    = (nowMs - _bootMs) / 1000u;
+  const uint32_t    sleepS   = (interval > awake) ? (interval - awake) : 0u;
+
+  if (_mqttUpMs != 0u && !_commsEgress.aggregatesPending()) {
+    LOGI(TAG, "Upload complete");
+    hibernateUntilNextSlot(sleepS);
+    return;
+  }
+
+  if ((nowMs - _uploadStartMs) > HASTIG_MQTT_CONNECT_TIMEOUT_MS) {
+    LOGW(TAG, "Upload timed out, data of this session is lost");
+    hibernateUntilNextSlot(sleepS);
+  }
+}
+
+void Orchestrator::hibernateUntilNextSlot(uint32_t sleepS)
+{
+  _settings.setSessionOverride(0u, 0u);
+  _autonomous       = false;
+  _uploadStartMs    = 0;
+  _hibernateReason  = HibernateReason::Schedule;
+  _forcedHibernateS = sleepS;
+  _powerManager.requestSleep(RestartReasonCode::LowPowerWakeup, sleepS, kWakeFlagSampleOnWake);
+  enterState(State::Hibernating);
+}
+
 /**
  * @brief Orchestrator main loop.
  */
 void Orchestrator::run()
 {
+  threadprof::attach(threadprof::Slot::Orch);
   LOGI(TAG, "Thread started");
 
   const uint32_t bootMs = timeutil::nowMs();
@@ -528,13 +713,16 @@ void Orchestrator::run()
 
   
   enterState(State::Aware);
+  if (_samplingOnBoot) {
+    startScheduledSession();
+  }
 
-  while (true) {
+  while (!_stop.requested()) {
     const uint32_t nowMs = timeutil::nowMs();
 
     // If MQTT never comes up within timeout, conserve power.
     // Request hibernate only once; stay alive but quiet until PowerManager completes the transition.
-    if (!_noNetworkHibernateRequested && _state != State::Hibernating && _mqttUpMs == 0 &&
+    if (!_noNetworkHibernateRequested && !_autonomous && _state != State::Hibernating && _mqttUpMs == 0 &&
         (nowMs - bootMs) > HASTIG_MQTT_CONNECT_TIMEOUT_MS) {
       _noNetworkHibernateRequested = true;
       LOGW(TAG, "No network/MQTT within timeout. Hibernating for %lu s", (unsigned long)HASTIG_NO_NETWORK_HIBERNATE_S);
@@ -544,25 +732,17 @@ void Orchestrator::run()
       enterState(State::Hibernating);
     }
 
-    // Unified event stream (UI + Comms)
+    // Unified event stream (UI + Comms); blocks until an event or the next timer.
     DeviceEvent evt;
-    if (_eventBus.tryGetNext(evt, 20)) {
+    bool        got = false;
+    {
+      threadprof::Wait wait(threadprof::Slot::Orch);
+      got = _eventBus.tryGetNext(evt, idleWaitMs(nowMs));
+    }
+    if (got) {
       if (evt.type == DeviceEvent::Type::Ui) {
         _lastActivityMs = nowMs;
         handleUiEvent(evt.data.ui);
-      } else if (evt.type == DeviceEvent::Type::Worker) {
-        const WorkerEventMsg& w = evt.data.worker;
-        _lastActivityMs = nowMs;
-        switch (w.type) {
-          case WorkerEventType::SampleTaken:
-            // Sampling tick observed (lightweight observability only)
-            break;
-          case WorkerEventType::AggregateReady:
-            // Aggregate produced (n=%lu, ok=%d)
-            break;
-          default:
-            break;
-        }
       } else {
         // Comms events
         const CommsEventMsg& commEvt = evt.data.comms;
@@ -594,7 +774,7 @@ void Orchestrator::run()
             _mqttUpMs = 0;
             break;
 
-          case CommsEventType::AggregatePublishAttempted:
+          case CommsEventType::AggregatePublished:
             _lastActivityMs = nowMs;
             if (_state == State::Sampling) {
               _unackedAggregateCount++;
@@ -603,7 +783,11 @@ void Orchestrator::run()
 
           case CommsEventType::ServerCommand:
             _lastActivityMs = nowMs;
-            handleServerCommand(commEvt.topic, commEvt.payload);
+            if (payloadpool::capacity(commEvt.payload) >= sizeof(protocol::Command)) {
+              protocol::Command cmd;
+              memcpy(&cmd, commEvt.payload.ptr, sizeof(cmd));
+              handleServerCommand(cmd);
+            }
             break;
 
           case CommsEventType::PublishFailed:
@@ -614,14 +798,19 @@ void Orchestrator::run()
             break;
         }
       }
+
+      EventBus::release(evt);
     }
 
     checkTimeouts();
-    rtos::ThisThread::sleep_for(milliseconds(20));
   }
+
+  LOGI(TAG, "Thread stopped");
+  _stop.acknowledge();
 }
 
 void Orchestrator::stop()
 {
-  stoputil::terminateThread("Orchestrator", _thread);
+  _stop.request();
+  (void)stoputil::awaitStop("Orchestrator", _thread, _stop, THREAD_STOP_ACK_MS);
 }
@@ -0,0 +1,122 @@
+#include "PayloadPool.h"
+
+#include "AppConfig.h"
+
+#include <atomic>
+#include <string.h>
+
+static_assert(PAYLOAD_SMALL_COUNT <= 32u && PAYLOAD_MEDIUM_COUNT <= 32u && PAYLOAD_LARGE_COUNT <= 32u,
+              "payload pool classes are tracked in a 32-bit mask");
+
+namespace payloadpool {
+
+namespace {
+
+alignas(4) static char g_small[PAYLOAD_SMALL_COUNT][PAYLOAD_SMALL_BYTES];
+alignas(4) static char g_medium[PAYLOAD_MEDIUM_COUNT][PAYLOAD_MEDIUM_BYTES];
+alignas(4) static char g_large[PAYLOAD_LARGE_COUNT][PAYLOAD_LARGE_BYTES];
+
+struct SizeClass {
+  char*                 base;
+  uint32_t              slotBytes;
+  uint32_t              count;
+  std::atomic<uint32_t> used;
+};
+
+static SizeClass g_classes[] = {
+    {&g_small[0][0], PAYLOAD_SMALL_BYTES, PAYLOAD_SMALL_COUNT, {0u}},
+    {&g_medium[0][0], PAYLOAD_MEDIUM_BYTES, PAYLOAD_MEDIUM_COUNT, {0u}},
+    {&g_large[0][0], PAYLOAD_LARGE_BYTES, PAYLOAD_LARGE_COUNT, {0u}},
+};
+
+static constexpr uint8_t kClassCount = (uint8_t)(sizeof(g_classes) / sizeof(g_classes[0]));
+
+static bool tryTake(uint8_t cls, PayloadRef& out)
+{
+  SizeClass& c = g_classes[cls];
+  const uint32_t full = (c.count >= 32u) ? 0xFFFFFFFFu : ((1u << c.count) - 1u);
+
+  uint32_t used = c.used.load();
+  while ((used & full) != full) {
+    const uint32_t slot = (uint32_t)__builtin_ctz(~used);
+    if (c.used.compare_exchange_weak(used, used | (1u << slot))) {
+      out.ptr = c.base + (slot * c.slotBytes);
+      out.cls = cls;
+      out.ptr[0] = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+bool alloc(size_t bytes, PayloadRef& out)
+{
+  out = PayloadRef{};
+  for (uint8_t cls = 0; cls < kClassCount; cls++) {
+    if (bytes > g_classes[cls].slotBytes) {
+      continue;
+    }
+    if (tryTake(cls, out)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool store(const char* text, PayloadRef& out)
+{
+  const char* t = (text != nullptr) ? text : "";
+  const size_t maxLen = PAYLOAD_LARGE_BYTES - 1u;
+  size_t len = strlen(t);
+  if (len > maxLen) {
+    len = maxLen;
+  }
+
+  if (!alloc(len + 1u, out)) {
+    return false;
+  }
+
+  memcpy(out.ptr, t, len);
+  out.ptr[len] = '\0';
+  return true;
+}
+
+size_t capacity(const PayloadRef& ref)
+{
+  if (ref.ptr == nullptr || ref.cls >= kClassCount) {
+    return 0u;
+  }
+  return g_classes[ref.cls].slotBytes;
+}
+
+const char* str(const PayloadRef& ref)
+{
+  return (ref.ptr != nullptr) ? ref.ptr : "";
+}
+
+void release(PayloadRef& ref)
+{
+  if (ref.ptr == nullptr || ref.cls >= kClassCount) {
+    ref = PayloadRef{};
+    return;
+  }
+
+  SizeClass& c = g_classes[ref.cls];
+  const uint32_t slot = (uint32_t)(ref.ptr - c.base) / c.slotBytes;
+  if (slot < c.count) {
+    c.used.fetch_and(~(1u << slot));
+  }
+  ref = PayloadRef{};
+}
+
+uint32_t inUse(uint8_t cls)
+{
+  if (cls >= kClassCount) {
+    return 0u;
+  }
+  return (uint32_t)__builtin_popcount(g_classes[cls].used.load());
+}
+
+} // namespace payloadpool
@@ -6,6 +6,9 @@
 using namespace std::chrono;
 
 #include "AppConfig.h"
+#include "CrashLog.h"
+#include "EnergyLedger.h"
+#include "HastigGlobals.h"
 #include "Logger.h"
 #include "PowerUtil.h"
 
@@ -14,6 +17,7 @@ using namespace std::chrono;
 #include "Orchestrator.h"
 #include "AggregatorThread.h"
 #include "SamplingThread.h"
+#include "SettingsManager.h"
 
 static const char* TAG = "PWRM";
 
@@ -23,6 +27,7 @@ PowerManager::PowerManager(Board& board,
                            UiThread& ui,
                            AggregatorThread& agg,
                            SamplingThread& sampling,
+                           SettingsManager& settings,
                            uint8_t wakePin)
     : _board(board),
       _restartReason(restartReason),
@@ -30,6 +35,7 @@ PowerManager::PowerManager(Board& board,
       _ui(ui),
       _agg(agg),
       _sampling(sampling),
+      _settings(settings),
       _wakePin(wakePin)
 {
 }
@@ -50,13 +56,14 @@ uint32_t PowerManager::clampSleepS(uint32_t s) const
   return s;
 }
 
-void PowerManager::requestSleep(RestartReasonCode reasonCode, uint32_t expectedDurationS)
+void PowerManager::requestSleep(RestartReasonCode reasonCode, uint32_t expectedDurationS, uint32_t wakeFlags)
 {
   if (_inProgress.load() || _pending.load()) {
     return;
   }
   _req.reasonCode        = reasonCode;
   _req.expectedDurationS = clampSleepS(expectedDurationS);
+  _req.wakeFlags         = wakeFlags;
   _pending.store(true);
 }
 
@@ -72,42 +79,55 @@ bool PowerManager::service()
        (unsigned long)_req.reasonCode,
        (unsigned long)_req.expectedDurationS);
 
-  // Prevent new TCP/MQTT connect attempts during the grace window.
+  // No new TCP/MQTT connect attempts; an established link stays up for the drain.
   _comms.prepareHibernate();
 
-  // 1) Grace window: keep pumping comms so "hibernating" status/config replies can flush out.
-  const uint32_t graceStart = millis();
-  while ((uint32_t)(millis() - graceStart) < HIBERNATE_STATUS_GRACE_MS) {
-    _comms.loopOnce();
-    rtos::ThisThread::sleep_for(milliseconds(20));
-  }
-
-  // 2) Stop producers first.
-  LOGI(TAG, "Sleep step: disable producers");
-  _sampling.setEnabled(false);
-  _agg.setEnabled(false);
-
-  // 3) Terminate threads (best-effort, order matters).
+  // 1) Cooperative stop, in order: the orchestrator finishes queuing its
+  //    hibernating status, the sampler stops feeding, and the aggregator
+  //    emits its partial window. Each falls back to terminate() if it hangs.
   LOGI(TAG, "Sleep step: stop threads");
-  _ui.stop();
   if (_orch != nullptr) {
     _orch->stop();
   }
-  _agg.stop();
+  _ui.stop();
   _sampling.stop();
+  _agg.stop();
+
+  // 2) Drain: pump comms until the outbox is empty (bounded).
+  const uint32_t drainStart = millis();
+  while (!_comms.outboxDrained() && (uint32_t)(millis() - drainStart) < HIBERNATE_STATUS_GRACE_MS) {
+    _comms.loopOnce();
+    rtos::ThisThread::sleep_for(milliseconds(20));
+  }
+  LOGI(TAG, "Sleep step: outbox %s after %lu ms",
+       _comms.outboxDrained() ? "drained" : "not drained (grace expired)",
+       (unsigned long)((uint32_t)millis() - drainStart));
 
-  // 4) Shutdown comms without modem full end (avoid blocking).
+  // 3) Shutdown comms without modem full end (avoid blocking).
   LOGI(TAG, "Sleep step: shutdown comms");
   _comms.shutdownForHibernate();
   LOGI(TAG, "Sleep step: comms shutdown returned");
 
-  // 5) Persist restart reason.
-  LOGI(TAG, "Sleep step: write restart reason");
-  _restartReason.write(_req.reasonCode);
+  // 4) Keep this wake's log in flash, for a crash that also loses RAM (or
+  //    park a post-mortem log that is still waiting for a link).
+  Logger::flush();
+  const bool crashLogParked = crashlog::spill();
+
+  // 5) Persist restart reason plus what the next boot may reuse.
+  LOGI(TAG, "Sleep step: write wake context");
+  WakeContext ctx;
+  ctx.reason          = _req.reasonCode;
+  ctx.sleepS          = _req.expectedDurationS;
+  ctx.wakeCount       = _restartReason.isWarmWake() ? _restartReason.bootContext().wakeCount + 1u : 1u;
+  ctx.settingsDigest  = _settings.configDigest();
+  ctx.flags           = _req.wakeFlags | (crashLogParked ? kWakeFlagCrashLogParked : 0u);
+  energyledger::save(ctx.energyUah, ctx.energyTrackedS);
+  ctx.capacityMah     = hastig_battery().remainingCapacity();
+  _restartReason.writeContext(ctx);
 
   // 6) Enter hibernate.
   LOGI(TAG, "Sleep step: entering hibernate");
-  Serial.flush();
+  Logger::flush();
   powerutil::hibernate(_board, _wakePin, _req.expectedDurationS);
 
   LOGW(TAG, "Returned from hibernate (unexpected)");
@@ -0,0 +1,107 @@
+#include "PowerPolicy.h"
+
+#include <math.h>
+
+constexpr uint16_t PowerPolicy::kSteps[];
+
+void PowerPolicy::reset()
+{
+  _step       = 0;
+  _relaxCount = 0;
+  _hasAnchor  = false;
+  _hasTrend   = false;
+  _socPerHour = 0.0f;
+}
+
+uint32_t PowerPolicy::scale(uint32_t base, uint16_t permille)
+{
+  const uint64_t v = ((uint64_t)base * permille + kNominal / 2u) / kNominal;
+  return (v > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (uint32_t)v;
+}
+
+void PowerPolicy::updateTrend(const Reading& r)
+{
+  if (!_hasAnchor) {
+    _hasAnchor = true;
+    _anchorMs  = r.tMs;
+    _anchorSoc = r.socPct;
+    return;
+  }
+
+  const uint32_t dtMs = r.tMs - _anchorMs;
+  if (dtMs < kTrendMinDtMs) {
+    return;
+  }
+
+  // The gauge reports SoC in coarse steps, so take slopes over long intervals.
+  const float rate = (r.socPct - _anchorSoc) * 3600000.0f / (float)dtMs;
+  _socPerHour = _hasTrend ? (_socPerHour + kTrendAlpha * (rate - _socPerHour)) : rate;
+  _hasTrend   = true;
+  _anchorMs   = r.tMs;
+  _anchorSoc  = r.socPct;
+}
+
+float PowerPolicy::targetFactor(const Reading& r, float lowBattV) const
+{
+  const float maxFactor = kSteps[kStepCount - 1] / (float)kNominal;
+
+  if (r.minimumVoltage > 0.0f && r.minimumVoltage < lowBattV + kVoltageMarginV) {
+    return maxFactor;
+  }
+
+  // SoC: 1x at kFullSocPct, geometric up to maxFactor at kFloorSocPct.
+  float depth = (kFullSocPct - r.socPct) / (kFullSocPct - kFloorSocPct);
+  depth = (depth < 0.0f) ? 0.0f : ((depth > 1.0f) ? 1.0f : depth);
+  float factor = powf(maxFactor, depth);
+
+  if (r.currentMa > kChargingMa) {
+    // Harvesting: spend some of it; the trend takes over once it is known.
+    factor = 1.0f + (factor - 1.0f) * 0.5f;
+  }
+
+  // Trend: if the floor is closer than the horizon, slow down proportionally.
+  if (_hasTrend && _socPerHour < 0.0f) {
+    const float hoursLeft = (r.socPct - kFloorSocPct) / -_socPerHour;
+    if (hoursLeft <= 0.0f) {
+      return maxFactor;
+    }
+    if (hoursLeft < kHorizonH) {
+      factor *= kHorizonH / hoursLeft;
+    }
+  } else if (_hasTrend && _socPerHour > 0.0f) {
+    factor = 1.0f + (factor - 1.0f) * 0.5f;
+  }
+
+  return (factor > maxFactor) ? maxFactor : factor;
+}
+
+uint8_t PowerPolicy::stepFor(float factor) const
+{
+  // Smallest step that covers the target.
+  const float permille = factor * (float)kNominal;
+  for (uint8_t i = 0; i < kStepCount; i++) {
+    if ((float)kSteps[i] + 0.5f >= permille) {
+      return i;
+    }
+  }
+  return kStepCount - 1;
+}
+
+uint16_t PowerPolicy::update(const Reading& r, float lowBattV)
+{
+  updateTrend(r);
+
+  const uint8_t target = stepFor(targetFactor(r, lowBattV));
+  if (target > _step) {
+    _step       = target;
+    _relaxCount = 0;
+  } else if (target < _step) {
+    if (++_relaxCount >= kRelaxUpdates) {
+      _step--;
+      _relaxCount = 0;
+    }
+  } else {
+    _relaxCount = 0;
+  }
+  return stretchPermille();
+}
@@ -1,11 +1,22 @@
 #include "PowerUtil.h"
 
 #include "Logger.h"
+#include "WakeLock.h"
+
+#include <Arduino_LowPowerPortentaH7.h>
+#include <atomic>
 
 static const char* TAG = "PWR";
 
 namespace powerutil {
 
+namespace {
+
+static std::atomic<bool> s_enabled{false};  // enableIdleDeepSleep() ran
+static std::atomic<bool> s_blocked{false};  // setting off, Holder::Setting held
+
+} // namespace
+
 void preparePinsForLowPower(uint8_t wakePin)
 {
   // Typical: wake when pin is pulled LOW.
@@ -47,4 +58,29 @@ void hibernate(Board& board, uint8_t wakePin, uint32_t expectedDurationS)
   board.standByUntilWakeupEvent();
 }
 
+void enableIdleDeepSleep()
+{
+  LowPower.allowDeepSleep();
+  s_enabled.store(true);
+  LOGI(TAG, "Idle deep sleep allowed (%u locks held)", (unsigned)LowPower.numberOfDeepSleepLocks());
+}
+
+void setIdleDeepSleep(bool allowed)
+{
+  if (s_blocked.exchange(!allowed) == !allowed) {
+    return;
+  }
+  if (allowed) {
+    wakelock::release(wakelock::Holder::Setting);
+  } else {
+    wakelock::acquire(wakelock::Holder::Setting);
+  }
+  LOGI(TAG, "Low-power idle %s by setting", allowed ? "on" : "off");
+}
+
+bool idleDeepSleepActive()
+{
+  return s_enabled.load() && !s_blocked.load();
+}
+
 } // namespace powerutil
@@ -6,52 +6,57 @@
 
 namespace protocol {
 
-static Command::Type decodeType(const char* type)
+namespace {
+
+constexpr size_t literalLen(const char* s)
+{
+  return (*s == '\0') ? 0u : 1u + literalLen(s + 1);
+}
+
+struct TypeName {
+  const char*   name;
+  size_t        len;
+  Command::Type type;
+};
+
+// Lengths come from the kCmd* strings themselves, so renaming or adding a
+// command only touches this table. decodeType() checks the length first,
+// so a mismatch costs one compare.
+static constexpr TypeName kTypeNames[] = {
+    {kCmdKeepSampling, literalLen(kCmdKeepSampling), Command::Type::keepSampling},
+    {kCmdStartSampling, literalLen(kCmdStartSampling), Command::Type::startSampling},
+    {kCmdStopSampling, literalLen(kCmdStopSampling), Command::Type::stopSampling},
+    {kCmdGetConfig, literalLen(kCmdGetConfig), Command::Type::getConfig},
+    {kCmdHibernate, literalLen(kCmdHibernate), Command::Type::hibernate},
+    {kCmdNudge, literalLen(kCmdNudge), Command::Type::nudge},
+    {kCmdResetBatteryStatistics, literalLen(kCmdResetBatteryStatistics),
+     Command::Type::resetBatteryStatistics},
+    {kCmdFactoryReset, literalLen(kCmdFactoryReset), Command::Type::factoryReset},
+};
+
+static_assert(sizeof(kTypeNames) / sizeof(kTypeNames[0]) == (size_t)Command::Type::factoryReset,
+              "every Command::Type after unknown (factoryReset is last) needs a kTypeNames entry");
+
+} // namespace
+
+Command::Type decodeType(const char* type, size_t len)
 {
   if (type == nullptr) {
     return Command::Type::unknown;
   }
 
-  if (strcmp(type, kCmdKeepSampling) == 0) {
-    return Command::Type::keepSampling;
-  }
-  if (strcmp(type, kCmdStartSampling) == 0) {
-    return Command::Type::startSampling;
-  }
-  if (strcmp(type, kCmdStopSampling) == 0) {
-    return Command::Type::stopSampling;
-  }
-  if (strcmp(type, kCmdGetConfig) == 0) {
-    return Command::Type::getConfig;
-  }
-  if (strcmp(type, kCmdHibernate) == 0) {
-    return Command::Type::hibernate;
-  }
-  if (strcmp(type, kCmdNudge) == 0) {
-    return Command::Type::nudge;
-  }
-  if (strcmp(type, kCmdResetBatteryStatistics) == 0) {
-    return Command::Type::resetBatteryStatistics;
-  }
-  if (strcmp(type, kCmdFactoryReset) == 0) {
-    return Command::Type::factoryReset;
+  for (const TypeName& t : kTypeNames) {
+    if (t.len == len && memcmp(type, t.name, len) == 0) {
+      return t.type;
+    }
   }
-
   return Command::Type::unknown;
 }
 
-bool decodeCommand(const char* json, Command& out)
+static void decodeFields(const JsonDocument& doc, Command& out)
 {
-  out = Command{};
-
-  JsonDocument doc;
-  const auto err = deserializeJson(doc, json);
-  if (err) {
-    return false;
-  }
-
-  const char* typeStr = doc[kKeyType] | "";
-  out.type = decodeType(typeStr);
+  const JsonString typeStr = doc[kKeyType].as<JsonString>();
+  out.type = decodeType(typeStr.c_str(), typeStr.size());
 
   if (doc[kKeySleepSeconds].is<uint32_t>()) {
     out.hasSleepSeconds = true;
@@ -77,6 +82,45 @@ bool decodeCommand(const char* json, Command& out)
     }
   }
 
+  if (doc[kKeyFormat].is<const char*>()) {
+    out.configBinary = (strcmp(doc[kKeyFormat].as<const char*>(), kFormatMsgPack) == 0);
+  }
+
+  if (doc[kKeyDigest].is<uint32_t>()) {
+    out.hasConfigDigest = true;
+    out.configDigest = doc[kKeyDigest].as<uint32_t>();
+  }
+}
+
+bool decodeCommand(const char* json, Command& out)
+{
+  out = Command{};
+
+  JsonDocument doc;
+  const auto err = deserializeJson(doc, json);
+  if (err) {
+    return false;
+  }
+
+  decodeFields(doc, out);
+  return true;
+}
+
+bool decodeCommand(const uint8_t* json, size_t len, Command& out)
+{
+  out = Command{};
+
+  if (json == nullptr) {
+    return false;
+  }
+
+  JsonDocument doc;
+  const auto err = deserializeJson(doc, json, len);
+  if (err) {
+    return false;
+  }
+
+  decodeFields(doc, out);
   return true;
 }
 
@@ -130,4 +174,20 @@ bool encodeHibernatingExtra(const char* reason, uint32_t expectedDurationS, char
   return n > 0;
 }
 
+bool encodeConfigRequest(bool binary, bool hasDigest, uint32_t digest, char* out, size_t outLen)
+{
+  if (out == nullptr || outLen == 0) {
+    return false;
+  }
+
+  JsonDocument doc;
+  doc[kKeyFormat] = binary ? kFormatMsgPack : kFormatJson;
+  if (hasDigest) {
+    doc[kKeyDigest] = digest;
+  }
+
+  const size_t n = serializeJson(doc, out, outLen);
+  return n > 0;
+}
+
 } // namespace protocol
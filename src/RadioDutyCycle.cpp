@@ -0,0 +1,63 @@
+#include "RadioDutyCycle.h"
+
+void RadioDutyCycle::configure(bool enabled, uint32_t periodMs, uint32_t windowMs)
+{
+  _enabled  = enabled;
+  _periodMs = periodMs;
+  _windowMs = (windowMs > periodMs) ? periodMs : windowMs;
+}
+
+void RadioDutyCycle::anchor(uint32_t nowMs)
+{
+  _anchored = true;
+  _anchorMs = nowMs;
+}
+
+void RadioDutyCycle::openNow(uint32_t nowMs)
+{
+  _urgent        = true;
+  _urgentUntilMs = nowMs + _windowMs;
+}
+
+bool RadioDutyCycle::isWindowOpen(uint32_t nowMs) const
+{
+  if (!enabled() || !_anchored) {
+    return true;
+  }
+
+  if (_urgent && (int32_t)(_urgentUntilMs - nowMs) > 0) {
+    return true;
+  }
+
+  const uint32_t phase = (uint32_t)(nowMs - _anchorMs) % _periodMs;
+  return phase < _windowMs;
+}
+
+uint32_t RadioDutyCycle::msUntilNextWindow(uint32_t nowMs) const
+{
+  if (isWindowOpen(nowMs)) {
+    return 0u;
+  }
+
+  const uint32_t phase = (uint32_t)(nowMs - _anchorMs) % _periodMs;
+  return _periodMs - phase;
+}
+
+uint16_t RadioDutyCycle::keepAliveS(uint16_t minKeepAliveS) const
+{
+  if (!enabled()) {
+    return minKeepAliveS;
+  }
+
+  // One full sleep period plus half again, so a single late window does not
+  // make the broker drop the session.
+  const uint32_t periodS = (_periodMs + 999u) / 1000u;
+  uint32_t       ka      = periodS + (periodS / 2u);
+  if (ka < minKeepAliveS) {
+    ka = minKeepAliveS;
+  }
+  if (ka > 0xFFFFu) {
+    ka = 0xFFFFu;
+  }
+  return (uint16_t)ka;
+}
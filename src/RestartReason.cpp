@@ -1,22 +1,189 @@
 #include "RestartReason.h"
 
+#if defined(TARGET_STM32H7)
 #include <mbed.h>
+#endif
 
 /**
- * @brief Stub backend.
+ * @brief Backup register layout (one 32-bit word each).
  *
- * Replace with RTC backup register implementation when ready.
+ * The CRC covers every word before it, so a half-written context (reset
+ * during writeContext) or power-on garbage reads as "no context".
  */
-static volatile uint32_t g_reason = (uint32_t)RestartReasonCode::UnexpectedReboot;
+namespace {
 
-void RestartReasonStore::begin() {}
+enum Reg : uint32_t {
+  kRegMagic = 0,
+  kRegReason,
+  kRegSleepS,
+  kRegWakeCount,
+  kRegSettingsDigest,
+  kRegFlags,
+  kRegEnergy0,
+  kRegEnergyTrackedS = kRegEnergy0 + WakeContext::kEnergyBuckets,
+  kRegCapacityMah,
+  kRegCrc,
+  kRegCount
+};
+
+static constexpr uint32_t kMagic = 0x57414B33u;  // 'WAK3'
+
+#if defined(TARGET_STM32H7)
+
+void backendBegin()
+{
+  // Backup domain is write-protected after reset; the RTC APB clock gates register access.
+  HAL_PWR_EnableBkUpAccess();
+  __HAL_RCC_RTCAPB_CLK_ENABLE();
+}
+
+uint32_t regRead(uint32_t idx)
+{
+  return (&RTC->BKP0R)[idx];
+}
+
+void regWrite(uint32_t idx, uint32_t value)
+{
+  (&RTC->BKP0R)[idx] = value;
+}
+
+#else
+
+// Simulated backup registers for host builds; zero-initialised like a power-on.
+static volatile uint32_t g_regs[kRegCount];
+
+void backendBegin() {}
+
+uint32_t regRead(uint32_t idx)
+{
+  return g_regs[idx];
+}
+
+void regWrite(uint32_t idx, uint32_t value)
+{
+  g_regs[idx] = value;
+}
+
+#endif
+
+uint32_t wordsCrc(const uint32_t* words, size_t n)
+{
+  // Small FNV-1a over the words; enough to reject garbage.
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; i++) {
+    for (int b = 0; b < 32; b += 8) {
+      h ^= (words[i] >> b) & 0xFFu;
+      h *= 16777619u;
+    }
+  }
+  return h;
+}
+
+void writeWords(const WakeContext& ctx)
+{
+  uint32_t w[kRegCount];
+  w[kRegMagic]           = kMagic;
+  w[kRegReason]          = (uint32_t)ctx.reason;
+  w[kRegSleepS]          = ctx.sleepS;
+  w[kRegWakeCount]       = ctx.wakeCount;
+  w[kRegSettingsDigest]  = ctx.settingsDigest;
+  w[kRegFlags]           = ctx.flags;
+  for (size_t i = 0; i < WakeContext::kEnergyBuckets; i++) {
+    w[kRegEnergy0 + i] = ctx.energyUah[i];
+  }
+  w[kRegEnergyTrackedS]  = ctx.energyTrackedS;
+  w[kRegCapacityMah]     = ctx.capacityMah;
+  w[kRegCrc]             = wordsCrc(w, kRegCrc);
+
+  for (uint32_t i = 0; i < kRegCount; i++) {
+    regWrite(i, w[i]);
+  }
+}
+
+bool readWords(WakeContext& ctx)
+{
+  uint32_t w[kRegCount];
+  for (uint32_t i = 0; i < kRegCount; i++) {
+    w[i] = regRead(i);
+  }
+  if (w[kRegMagic] != kMagic || w[kRegCrc] != wordsCrc(w, kRegCrc)) {
+    return false;
+  }
+
+  ctx.reason          = (RestartReasonCode)w[kRegReason];
+  ctx.sleepS          = w[kRegSleepS];
+  ctx.wakeCount       = w[kRegWakeCount];
+  ctx.settingsDigest  = w[kRegSettingsDigest];
+  ctx.flags           = w[kRegFlags];
+  for (size_t i = 0; i < WakeContext::kEnergyBuckets; i++) {
+    ctx.energyUah[i] = w[kRegEnergy0 + i];
+  }
+  ctx.energyTrackedS  = w[kRegEnergyTrackedS];
+  ctx.capacityMah     = w[kRegCapacityMah];
+  return true;
+}
+
+} // namespace
+
+void RestartReasonStore::begin()
+{
+  backendBegin();
+  if (!readWords(_boot)) {
+    _boot = WakeContext();
+  }
+}
 
 RestartReasonCode RestartReasonStore::read() const
 {
-  return (RestartReasonCode)g_reason;
+  WakeContext ctx;
+  return readWords(ctx) ? ctx.reason : RestartReasonCode::PowerOn;
 }
 
 void RestartReasonStore::write(RestartReasonCode code) const
 {
-  g_reason = (uint32_t)code;
+  WakeContext ctx;
+  if (!readWords(ctx)) {
+    ctx = WakeContext();
+  }
+  ctx.reason = code;
+  writeWords(ctx);
+}
+
+void RestartReasonStore::writeContext(const WakeContext& ctx) const
+{
+  writeWords(ctx);
+}
+
+bool RestartReasonStore::isWarmWake() const
+{
+  switch (_boot.reason) {
+    case RestartReasonCode::LowPowerWakeup:
+    case RestartReasonCode::NoNetwork:
+    case RestartReasonCode::Forced:
+    case RestartReasonCode::EmergencyPowerSave:
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char* RestartReasonStore::name(RestartReasonCode code)
+{
+  switch (code) {
+    case RestartReasonCode::UnexpectedReboot:
+      return "unexpectedReboot";
+    case RestartReasonCode::LowPowerWakeup:
+      return "lowPowerWakeup";
+    case RestartReasonCode::NoNetwork:
+      return "noNetwork";
+    case RestartReasonCode::Forced:
+      return "forced";
+    case RestartReasonCode::EmergencyPowerSave:
+      return "emergencyPowerSave";
+    case RestartReasonCode::BrownOut:
+      return "brownOut";
+    case RestartReasonCode::PowerOn:
+    default:
+      return "powerOn";
+  }
 }
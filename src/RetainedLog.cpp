@@ -0,0 +1,83 @@
+#include "RetainedLog.h"
+
+#include <string.h>
+
+RetainedLog::RetainedLog(void* mem, size_t bytes)
+    : _hdr((Header*)mem), _text((char*)mem + sizeof(Header)), _cap(bytes - sizeof(Header))
+{
+}
+
+bool RetainedLog::attach()
+{
+  const bool valid = _hdr->magic == kMagic && _hdr->size == (uint32_t)_cap &&
+                     _hdr->check == (~kMagic ^ (uint32_t)_cap);
+  if (valid && _hdr->head != 0u) {
+    _hdr->boots++;
+    return true;
+  }
+  if (!valid) {
+    _hdr->magic = kMagic;
+    _hdr->size  = (uint32_t)_cap;
+    _hdr->check = ~kMagic ^ (uint32_t)_cap;
+    _hdr->head  = 0;
+    _hdr->boots = 0;
+  }
+  return false;
+}
+
+void RetainedLog::append(const char* s, size_t n)
+{
+  if (n > _cap) {
+    s += n - _cap;
+    n = _cap;
+  }
+
+  const size_t at    = _hdr->head % _cap;
+  const size_t first = (n < _cap - at) ? n : (_cap - at);
+  memcpy(&_text[at], s, first);
+  if (first < n) {
+    memcpy(_text, s + first, n - first);
+    _lastAt  = _text;
+    _lastLen = _cap;
+  } else {
+    _lastAt  = &_text[at];
+    _lastLen = n;
+  }
+  // Text first, then head: a reset in between loses this line, not the ring.
+  _hdr->head += (uint32_t)n;
+}
+
+size_t RetainedLog::used() const
+{
+  return (_hdr->head < _cap) ? _hdr->head : _cap;
+}
+
+size_t RetainedLog::excerpt(char* out, size_t max) const
+{
+  const size_t avail = used();
+  size_t       n     = (max < avail) ? max : avail;
+  size_t       start = (size_t)((_hdr->head - n) % _cap);
+
+  // Older text was cut off mid-line: start after the next newline.
+  if (n < (size_t)_hdr->head) {
+    while (n > 0u) {
+      const char c = _text[start];
+      start        = (start + 1u) % _cap;
+      n--;
+      if (c == '\n') {
+        break;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    out[i] = _text[(start + i) % _cap];
+  }
+  return n;
+}
+
+const void* RetainedLog::lastWrite(size_t& len) const
+{
+  len = _lastLen;
+  return _lastAt;
+}
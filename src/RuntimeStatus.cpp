@@ -1,9 +1,15 @@
 #include "RuntimeStatus.h"
 
+#include "PowerPolicy.h"
+
 #include <string.h>
 
 RuntimeStatus::RuntimeStatus()
-    : _mode((uint8_t)Mode::Aware), _lastActivityMs(0u), _awareTimeoutS(0u), _hasSample(false)
+    : _mode((uint8_t)Mode::Aware),
+      _lastActivityMs(0u),
+      _awareTimeoutS(0u),
+      _powerStretch(PowerPolicy::kNominal),
+      _hasSample(false)
 {
   memset(&_lastSample, 0, sizeof(_lastSample));
 }
@@ -52,3 +58,13 @@ bool RuntimeStatus::getLastSample(SensorSampleMsg& outSample) const
   outSample = _lastSample;
   return true;
 }
+
+void RuntimeStatus::setPowerStretch(uint16_t permille)
+{
+  _powerStretch.store(permille);
+}
+
+uint16_t RuntimeStatus::powerStretch() const
+{
+  return _powerStretch.load();
+}
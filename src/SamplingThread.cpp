@@ -3,22 +3,25 @@
 #include "Logger.h"
 #include "BoardHal.h"
 #include "StopUtil.h"
+#include "EnergyLedger.h"
+#include "Metrics.h"
+#include "ThreadProfiler.h"
+#include "PowerPolicy.h"
+#include "WakeLock.h"
 #include <Arduino.h>
 #include <chrono>
 #include <string.h>
-#include <cmsis_os2.h>
 
 using namespace std::chrono;
 
 static const char* TAG = "SENS";
 
 SamplingThread::SamplingThread(SensorMail<QUEUE_DEPTH_SENSOR_TO_AGG>& outMail,
-                               SettingsManager& settings, SessionClock& clock, EventBus& eventBus,
+                               SettingsManager& settings, SessionClock& clock,
                                RuntimeStatus& runtimeStatus)
     : _outMail(outMail),
       _settings(settings),
       _clock(clock),
-      _eventBus(eventBus),
       _runtimeStatus(runtimeStatus),
       _thread(PRIO_SENS, STACK_SENS, nullptr, "SENS")
 {
@@ -29,13 +32,25 @@ SamplingThread::SamplingThread(SensorMail<QUEUE_DEPTH_SENSOR_TO_AGG>& outMail,
  */
 void SamplingThread::start()
 {
+   _settingsSub.interest = settingsGroupBit(SettingsGroup::Sensor) | settingsGroupBit(SettingsGroup::Schedule);
+   _settingsSub.flags    = &_flags;
+   _settingsSub.flag     = FLAG_SETTINGS;
+   (void)_settings.subscribe(_settingsSub);
+
    _thread.start(mbed::callback(threadEntry, this));
    _thread.set_priority(PRIO_SENS);
 }
 
 void SamplingThread::stop()
 {
-   stoputil::terminateThread("SamplingThread", _thread);
+   _stop.request();
+   _enabled.store(false);
+   _flags.set(FLAG_WAKE | FLAG_SETTINGS);
+   if (!stoputil::awaitStop("SamplingThread", _thread, _stop, THREAD_STOP_ACK_MS))
+   {
+      // Terminated mid-sample; the sensor may still be powered.
+      BoardHal::setSensorPower(false);
+   }
 }
 
 /**
@@ -52,66 +67,142 @@ void SamplingThread::threadEntry(void* ctx)
    static_cast<SamplingThread*>(ctx)->run();
 }
 
-void SamplingThread::run()
+/**
+ * @brief True if the open sensor was created with the same type/address/baud.
+ */
+bool SamplingThread::sensorMatches(const AppSettings& s) const
 {
-   const osThreadId_t tid        = osThreadGetId();
-   const uint32_t     stackSize  = osThreadGetStackSize(tid);
-   const uint32_t     stackSpace = osThreadGetStackSpace(tid);
-   LOGI(TAG, "Thread started (stack size=%lu free=%lu)", (unsigned long)stackSize, (unsigned long)stackSpace);
+   return _sensor != nullptr && _sensorType == s.sensor_type && _sensorAddr == s.sensor_addr &&
+          _sensorBaud == s.sensor_baud;
+}
 
-   while (true)
+/**
+ * @brief Create and begin the sensor; power + warmup only if it is not powered yet.
+ */
+bool SamplingThread::openSensor(const AppSettings& s)
+{
+   if (!_sensorPowered)
    {
-      _flags.wait_any(FLAG_WAKE);
-      _flags.clear(FLAG_WAKE);
-
-      if (!_enabled.load())
-      {
-         continue;
-      }
-
-      const AppSettings s = _settings.getCopy();
       BoardHal::setSensorPower(true);
+      _sensorPowered = true;
+      energyledger::Scope warmup(energyledger::Bucket::Warmup);
+      threadprof::Wait    wait(threadprof::Slot::Sens);
       rtos::ThisThread::sleep_for(milliseconds(s.sensor_warmup_ms));
+   }
 
-      if (_sensor != nullptr)
-      {
-         _sensor->end();
-         delete _sensor;
-         _sensor = nullptr;
-      }
+   LOGI(TAG, "Creating sensor type=%lu", (unsigned long)s.sensor_type);
+
+   _sensor = Sensor::create(s.sensor_type);
+   if (_sensor == nullptr)
+   {
+      LOGE(TAG, "Sensor create failed");
+      closeSensor(true);
+      return false;
+   }
+
+   bool begun = false;
+   {
+      wakelock::Scope bus(wakelock::Holder::Rs485);
+      begun = _sensor->begin(s);
+   }
+   if (!begun)
+   {
+      LOGE(TAG, "Sensor begin failed (%s)", _sensor->name());
+      closeSensor(true);
+      return false;
+   }
+
+   _sensorType = s.sensor_type;
+   _sensorAddr = s.sensor_addr;
+   _sensorBaud = s.sensor_baud;
+   return true;
+}
+
+void SamplingThread::closeSensor(bool powerOff)
+{
+   if (_sensor != nullptr)
+   {
+      _sensor->end();
+      delete _sensor;
+      _sensor = nullptr;
+   }
+
+   if (powerOff && _sensorPowered)
+   {
+      BoardHal::setSensorPower(false);
+      _sensorPowered = false;
+   }
+}
 
-      LOGI(TAG, "Creating sensor type=%lu", (unsigned long)s.sensor_type);
+static uint32_t clampPeriod(uint32_t periodMs)
+{
+   return (periodMs < MIN_SAMPLE_PERIOD_MS) ? MIN_SAMPLE_PERIOD_MS : periodMs;
+}
+
+void SamplingThread::run()
+{
+   threadprof::attach(threadprof::Slot::Sens);
+   LOGI(TAG, "Thread started");
 
-      _sensor = Sensor::create(s.sensor_type);
-      if (_sensor == nullptr)
+   while (!_stop.requested())
+   {
+      if (_sensorPowered && !_enabled.load())
       {
-         LOGE(TAG, "Sensor create failed");
-         BoardHal::setSensorPower(false);
-         continue;
+         // Idle hold: a quick restart reuses the warmed-up sensor.
+         uint32_t got = 0;
+         {
+            threadprof::Wait wait(threadprof::Slot::Sens);
+            got = _flags.wait_any_for(FLAG_WAKE, milliseconds(SENSOR_IDLE_HOLD_MS));
+         }
+         if ((got & osFlagsError) != 0u || (got & FLAG_WAKE) == 0u)
+         {
+            LOGI(TAG, "Sensor idle, powering down");
+            closeSensor(true);
+            continue;
+         }
       }
+      else
+      {
+         threadprof::Wait wait(threadprof::Slot::Sens);
+         _flags.wait_any(FLAG_WAKE);
+      }
+      _flags.clear(FLAG_WAKE);
 
-      if (!_sensor->begin(s))
+      if (!_enabled.load())
       {
-         LOGE(TAG, "Sensor begin failed (%s)", _sensor->name());
-         _sensor->end();
-         delete _sensor;
-         _sensor = nullptr;
-         BoardHal::setSensorPower(false);
          continue;
       }
 
-      uint32_t periodMs = s.sample_period_ms;
-      if (periodMs < MIN_SAMPLE_PERIOD_MS)
+      // The session starts from current settings, so earlier changes are moot.
+      _flags.clear(FLAG_SETTINGS);
+      (void)_settingsSub.consume();
+
+      const AppSettings s = _settings.getCopy();
+      if (!sensorMatches(s))
+      {
+         closeSensor(false);
+         if (!openSensor(s))
+         {
+            continue;
+         }
+      }
+      else
       {
-         periodMs = MIN_SAMPLE_PERIOD_MS;
+         LOGI(TAG, "Reusing warm sensor (%s)", _sensor->name());
       }
 
+      uint32_t basePeriodMs = s.sample_period_ms;
+
       while (_enabled.load())
       {
          SensorSampleMsg tmp;
          memset(&tmp, 0, sizeof(tmp));
-         tmp.relMs     = _clock.relMs();
-         const bool ok = _sensor->sample(tmp);
+         tmp.relMs = _clock.relMs(tmp.session);
+         bool ok   = false;
+         {
+            wakelock::Scope bus(wakelock::Holder::Rs485);
+            ok = _sensor->sample(tmp);
+         }
          tmp.ok        = ok;
          if (tmp.ok)
          {
@@ -121,41 +212,66 @@ void SamplingThread::run()
             {
                memcpy(m, &tmp, sizeof(*m));
                _outMail.put(m);
-               LOGD(TAG, "Produced sample t=%lu %s=%.2f %s=%.2f ok=%d", (unsigned long)m->relMs, m->k0,
-                    (double)m->v0, m->k1, (double)m->v1, m->ok ? 1 : 0);
-
-               WorkerEventMsg w;
-               memset(&w, 0, sizeof(w));
-               w.type  = WorkerEventType::SampleTaken;
-               w.ts_ms = millis();
-               w.relMs = tmp.relMs;
-               w.n     = 1;
-               w.ok    = ok;
-               _eventBus.publishWorker(w);
+               metrics::enqueued(metrics::Queue::SensorToAgg);
+               metrics::count(metrics::Counter::SamplesProduced);
+               LOGD(TAG, "Produced sample t=%lu %s=%.2f %s=%.2f ok=%d", (unsigned long)tmp.relMs, tmp.k0,
+                    (double)tmp.v0, tmp.k1, (double)tmp.v1, tmp.ok ? 1 : 0);
             }
             else
             {
+               metrics::queueFull(metrics::Queue::SensorToAgg);
                LOGW(TAG, "Drop sample: mail full");
             }
          }
          else
          {
+            metrics::count(metrics::Counter::SampleErrors);
             LOGW(TAG, "Get sample failed");
          }
 
-         // Always yield here so main loop and comms get scheduling opportunities.
-         rtos::ThisThread::sleep_for(milliseconds(1));
+         // Sleep out the period (stretched on low battery), but wake early when
+         // sensor/schedule settings change or sampling is stopped: a sample
+         // taken after the stop would only trail the session's last window.
+         const uint32_t periodMs = clampPeriod(PowerPolicy::scale(basePeriodMs, _runtimeStatus.powerStretch()));
+         {
+            threadprof::Wait wait(threadprof::Slot::Sens);
+            _flags.wait_any_for(FLAG_SETTINGS | FLAG_WAKE, milliseconds(periodMs));
+         }
+         if (!_enabled.load())
+         {
+            break;
+         }
+         const uint8_t changed = _settingsSub.consume();
+         if (changed == 0u)
+         {
+            continue;
+         }
 
-         rtos::ThisThread::sleep_for(milliseconds(periodMs));
+         const AppSettings now = _settings.getCopy();
+         if ((changed & settingsGroupBit(SettingsGroup::Schedule)) != 0u)
+         {
+            basePeriodMs = now.sample_period_ms;
+            LOGI(TAG, "Sample period now %lu ms", (unsigned long)basePeriodMs);
+         }
+         if ((changed & settingsGroupBit(SettingsGroup::Sensor)) != 0u && !sensorMatches(now))
+         {
+            // Stays powered: only the bus/driver is reinitialised, no warmup.
+            LOGI(TAG, "Sensor identity changed, reopening");
+            closeSensor(false);
+            if (!openSensor(now))
+            {
+               break;
+            }
+         }
       }
 
-      if (_sensor != nullptr)
+      if (!_enabled.load() && !_stop.requested())
       {
-         _sensor->end();
-         delete _sensor;
-         _sensor = nullptr;
+         LOGD(TAG, "Sampling stopped, holding sensor for %lu ms", (unsigned long)SENSOR_IDLE_HOLD_MS);
       }
-
-      BoardHal::setSensorPower(false);
    }
+
+   closeSensor(true);
+   LOGI(TAG, "Thread stopped");
+   _stop.acknowledge();
 }
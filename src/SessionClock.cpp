@@ -37,6 +37,7 @@ void SessionClock::startNewSession(const char* serverSessionIdOrNull)
   mbed::ScopedLock<rtos::Mutex> lock(_mx);
 
   _refMs = timeutil::nowMs();
+  _session++;
 
   if (serverSessionIdOrNull != nullptr && serverSessionIdOrNull[0] != '\0') {
     strncpy(_sessionId, serverSessionIdOrNull, sizeof(_sessionId));
@@ -61,9 +62,12 @@ void SessionClock::getSessionId(char* out, size_t outLen) const
   out[outLen - 1] = '\0';
 }
 
-bool SessionClock::getServerSessionId(char* out, size_t outLen) const
+bool SessionClock::getServerSessionId(char* out, size_t outLen, uint32_t* sessionOut) const
 {
   mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (sessionOut != nullptr) {
+    *sessionOut = _session;
+  }
   if (outLen == 0) {
     return false;
   }
@@ -88,6 +92,14 @@ uint32_t SessionClock::relMs() const
   return (uint32_t)(now - _refMs);
 }
 
+uint32_t SessionClock::relMs(uint32_t& sessionOut) const
+{
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  sessionOut         = _session;
+  const uint32_t now = timeutil::nowMs();
+  return (uint32_t)(now - _refMs);
+}
+
 /**
  * @brief Generate a local GUID-like id (hex), not cryptographic.
  */
@@ -0,0 +1,244 @@
+#include "SettingsJournal.h"
+
+#include "Logger.h"
+#include "Metrics.h"
+
+#include <string.h>
+
+static const char* TAG = "SETJ";
+
+uint32_t SettingsJournal::crc32(const uint8_t* data, size_t len, uint32_t crc)
+{
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      const uint32_t mask = -(crc & 1u);
+      crc = (crc >> 1) ^ (0xEDB88320u & mask);
+    }
+  }
+  return ~crc;
+}
+
+uint32_t SettingsJournal::strideFor(uint32_t payloadLen) const
+{
+  const uint32_t raw = (uint32_t)sizeof(RecordHeader) + payloadLen;
+  return ((raw + _pageSize - 1u) / _pageSize) * _pageSize;
+}
+
+/**
+ * @brief Open flash and locate the journal region (kSectorCount sectors, _sectorsFromEnd above the end).
+ */
+bool SettingsJournal::begin()
+{
+  if (_open) {
+    return true;
+  }
+
+  if (_flash.init() != 0) {
+    LOGE(TAG, "Flash init failed");
+    return false;
+  }
+
+  const uint32_t flashEnd = _flash.get_flash_start() + _flash.get_flash_size();
+  _pageSize   = _flash.get_page_size();
+  _sectorSize = _flash.get_sector_size(flashEnd - 1u);
+
+  if (_pageSize == 0u || _pageSize > kMaxPageBytes) {
+    LOGE(TAG, "Unsupported flash page size %lu", (unsigned long)_pageSize);
+    _flash.deinit();
+    return false;
+  }
+
+  // Sector 0 is the lower one. Sectors at the end of flash are uniform in size.
+  for (uint32_t i = 0; i < kSectorCount; i++) {
+    _sectorBase[i] = flashEnd - (kSectorCount - i + _sectorsFromEnd) * _sectorSize;
+  }
+
+  _open = true;
+  scan();
+  return true;
+}
+
+uint32_t SettingsJournal::recordCrc(uint32_t addr, const RecordHeader& h)
+{
+  uint32_t crc = crc32((const uint8_t*)&h.seq, sizeof(h.seq));
+  crc = crc32((const uint8_t*)&h.len, sizeof(h.len), crc);
+
+  uint8_t  buf[64];
+  uint32_t remaining = h.len;
+  uint32_t p         = addr + (uint32_t)sizeof(RecordHeader);
+  while (remaining > 0u) {
+    const uint32_t n = (remaining > sizeof(buf)) ? (uint32_t)sizeof(buf) : remaining;
+    if (_flash.read(buf, p, n) != 0) {
+      return ~h.crc;  // force mismatch
+    }
+    crc = crc32(buf, n, crc);
+    p += n;
+    remaining -= n;
+  }
+  return crc;
+}
+
+/**
+ * @brief Walk one sector; track the newest valid record and return the used length.
+ */
+uint32_t SettingsJournal::scanSector(uint8_t sector)
+{
+  const uint32_t base = _sectorBase[sector];
+  uint32_t       off  = 0;
+
+  while (off + sizeof(RecordHeader) <= _sectorSize) {
+    RecordHeader h;
+    if (_flash.read(&h, base + off, sizeof(h)) != 0) {
+      break;
+    }
+
+    if (h.magic == 0xFFFFFFFFu && h.seq == 0xFFFFFFFFu && h.len == 0xFFFFFFFFu && h.crc == 0xFFFFFFFFu) {
+      // Records are programmed front to back, so the first erased header ends the log.
+      break;
+    }
+
+    const bool sane = (h.magic == _magic) && (h.len <= (_sectorSize - sizeof(RecordHeader)));
+    if (!sane) {
+      // Interrupted write or foreign data (e.g. the old single-blob layout): skip a page.
+      off += _pageSize;
+      continue;
+    }
+
+    if ((_latestSeq == 0u || h.seq > _latestSeq) && recordCrc(base + off, h) == h.crc) {
+      _latestSeq  = h.seq;
+      _latestAddr = base + off;
+      _latestLen  = h.len;
+      _active     = sector;
+    }
+    off += strideFor(h.len);
+  }
+
+  return (off > _sectorSize) ? _sectorSize : off;
+}
+
+void SettingsJournal::scan()
+{
+  _latestSeq  = 0;
+  _latestAddr = 0;
+  _latestLen  = 0;
+
+  uint32_t used[kSectorCount];
+  for (uint8_t i = 0; i < kSectorCount; i++) {
+    used[i] = scanSector(i);
+  }
+
+  if (_latestSeq == 0u) {
+    // Empty journal: start in the least used sector.
+    _active = (used[1] < used[0]) ? 1u : 0u;
+  }
+  _writeOff = used[_active];
+
+  LOGI(TAG, "Journal: newest seq=%lu sector=%u used=%lu/%lu bytes",
+       (unsigned long)_latestSeq,
+       (unsigned)_active,
+       (unsigned long)_writeOff,
+       (unsigned long)_sectorSize);
+}
+
+bool SettingsJournal::loadLatest(void* out, size_t len, size_t* loadedLen)
+{
+  if (!begin() || _latestSeq == 0u) {
+    return false;
+  }
+
+  const bool prefixOk = (loadedLen != nullptr) && (_latestLen < len);
+  if (_latestLen != len && !prefixOk) {
+    LOGW(TAG, "Newest record has %lu bytes, expected %u", (unsigned long)_latestLen, (unsigned)len);
+    return false;
+  }
+
+  if (_flash.read(out, _latestAddr + (uint32_t)sizeof(RecordHeader), _latestLen) != 0) {
+    return false;
+  }
+  if (loadedLen != nullptr) {
+    *loadedLen = _latestLen;
+  }
+  return true;
+}
+
+/**
+ * @brief Program header + payload page by page (flash needs page-sized writes).
+ */
+bool SettingsJournal::programRecord(uint32_t addr, const RecordHeader& h, const uint8_t* payload)
+{
+  const uint8_t  erased = (uint8_t)_flash.get_erase_value();
+  const uint32_t total  = (uint32_t)sizeof(h) + h.len;
+  const uint32_t stride = strideFor(h.len);
+
+  uint8_t page[kMaxPageBytes];
+  for (uint32_t pos = 0; pos < stride; pos += _pageSize) {
+    memset(page, erased, _pageSize);
+    for (uint32_t i = 0; i < _pageSize && (pos + i) < total; i++) {
+      const uint32_t at = pos + i;
+      page[i] = (at < sizeof(h)) ? ((const uint8_t*)&h)[at] : payload[at - sizeof(h)];
+    }
+    if (_flash.program(page, addr + pos, _pageSize) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SettingsJournal::append(const void* data, size_t len)
+{
+  if (!begin()) {
+    return false;
+  }
+
+  const uint32_t stride = strideFor((uint32_t)len);
+  if (stride > _sectorSize) {
+    LOGE(TAG, "Record too large (%u bytes)", (unsigned)len);
+    return false;
+  }
+
+  if (_writeOff + stride > _sectorSize) {
+    // Compaction: the newest record moves to a freshly erased sector. The
+    // current sector keeps the previous record until the new one is written.
+    const uint8_t next = (uint8_t)((_active + 1u) % kSectorCount);
+    LOGI(TAG, "Sector %u full, compacting into sector %u", (unsigned)_active, (unsigned)next);
+    if (_flash.erase(_sectorBase[next], _sectorSize) != 0) {
+      LOGE(TAG, "Flash erase failed");
+      return false;
+    }
+    _eraseCount++;
+    metrics::count(metrics::Counter::FlashErases);
+    _active   = next;
+    _writeOff = 0;
+  }
+
+  RecordHeader h;
+  h.magic = _magic;
+  h.seq   = _latestSeq + 1u;
+  h.len   = (uint32_t)len;
+  h.crc   = crc32((const uint8_t*)&h.seq, sizeof(h.seq));
+  h.crc   = crc32((const uint8_t*)&h.len, sizeof(h.len), h.crc);
+  h.crc   = crc32((const uint8_t*)data, len, h.crc);
+
+  const uint32_t addr = _sectorBase[_active] + _writeOff;
+  // Whatever happens, never write over this slot again.
+  _writeOff += stride;
+
+  metrics::count(metrics::Counter::FlashWrites);
+  if (!programRecord(addr, h, (const uint8_t*)data)) {
+    LOGE(TAG, "Flash program failed");
+    return false;
+  }
+
+  RecordHeader check;
+  if (_flash.read(&check, addr, sizeof(check)) != 0 || check.crc != h.crc || recordCrc(addr, check) != h.crc) {
+    LOGE(TAG, "Read-back verify failed");
+    return false;
+  }
+
+  _latestSeq  = h.seq;
+  _latestAddr = addr;
+  _latestLen  = h.len;
+  return true;
+}
@@ -2,21 +2,17 @@
 
 #include "Logger.h"
 #include "AppConfig.h"
+#include "SettingsSchema.h"
+#include "TimeUtil.h"
 #include <Arduino.h>
 #include <platform/ScopedLock.h>
 #include <mbed.h>
 #include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
 static const char* TAG = "SET";
-static constexpr uint32_t kMinAwareTimeoutS   = 60u;
-static constexpr uint32_t kDefaultAwareTimeoutS = 600u;
-static constexpr uint32_t kMinDefaultSleepS   = 60u;
-static constexpr uint32_t kDefaultSleepS      = 3600u;
-static constexpr uint32_t kMinStatusIntervalS = 30u;
-static constexpr uint32_t kDefaultStatusIntervalS = 120u;
-static constexpr uint32_t kMaxSleepDurationS  = 43200u;
 
 namespace {
 bool parseDoubleFromText(const char* text, double& out)
@@ -94,29 +90,17 @@ bool numericEqualsFloat(const JsonVariantConst valueNode, float current)
 }
 } // namespace
 
+/** @brief Pre-journal layout: one blob at the start of the last sector (version 1 settings). */
 struct StoredBlob {
   uint32_t    magic;
   uint32_t    crc;
   AppSettings settings;
 };
 
-static constexpr uint32_t SETTINGS_MAGIC = 0x53455453;  // 'SETS'
+// Version 1 settings ended before the schedule fields.
+static constexpr size_t kLegacySettingsBytes = offsetof(AppSettings, sched_interval_s);
 
-/**
- * @brief Compute CRC32.
- */
-uint32_t SettingsManager::crc32(const uint8_t* data, size_t len)
-{
-  uint32_t crc = 0xFFFFFFFFu;
-  for (size_t i = 0; i < len; i++) {
-    crc ^= data[i];
-    for (int b = 0; b < 8; b++) {
-      const uint32_t mask = -(crc & 1u);
-      crc = (crc >> 1) ^ (0xEDB88320u & mask);
-    }
-  }
-  return ~crc;
-}
+static constexpr uint32_t SETTINGS_MAGIC = 0x53455453;  // 'SETS'
 
 /**
  * @brief Initialize settings store.
@@ -147,187 +131,346 @@ void SettingsManager::begin()
 AppSettings SettingsManager::getCopy() const
 {
   mbed::ScopedLock<rtos::Mutex> lock(_mx);
-  return _s;
+  return effectiveUnlocked();
 }
 
 /**
- * @brief Apply JSON patch to settings.
+ * @brief Stored settings with the session override on top.
  */
-bool SettingsManager::applyJson(const char* json, bool persist)
+AppSettings SettingsManager::effectiveUnlocked() const
 {
-  if (json == nullptr) {
-    return false;
+  AppSettings s = _s;
+  if (_sessionSampleMs > 0u) {
+    s.sample_period_ms = _sessionSampleMs;
   }
-
-  JsonDocument doc;
-  const DeserializationError err = deserializeJson(doc, json);
-  if (err) {
-    LOGW(TAG, "JSON parse failed: %s", err.c_str());
-    return false;
+  if (_sessionAggS > 0u) {
+    s.agg_period_s = _sessionAggS;
   }
+  return s;
+}
+
+/**
+ * @brief Stored settings only (what is persisted and reported to the server).
+ */
+AppSettings SettingsManager::storedCopy() const
+{
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  return _s;
+}
 
+void SettingsManager::setSessionOverride(uint32_t samplePeriodMs, uint32_t aggPeriodS)
+{
   mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  const AppSettings before = effectiveUnlocked();
+  _sessionSampleMs         = samplePeriodMs;
+  _sessionAggS             = aggPeriodS;
+  notifyUnlocked(before, effectiveUnlocked());
+}
+
+/**
+ * @brief Stage patch keys into stage; false if a recognized key has a bad value.
+ */
+bool SettingsManager::stagePatchUnlocked(JsonObjectConst patch, AppSettings& stage, uint32_t& touched) const
+{
+  bool ok = true;
+
+  // One pass over the patch; unknown keys are ignored.
+  for (JsonPairConst kv : patch) {
+    const char* key = kv.key().c_str();
+    const settingsschema::Field* f = settingsschema::find(key);
+    if (f != nullptr) {
+      if (settingsschema::set(stage, *f, kv.value())) {
+        touched |= (1u << settingsschema::indexOf(*f));
+      } else {
+        LOGW(TAG, "Invalid value for %s", key);
+        ok = false;
+      }
+    } else if (strcmp(key, "aggregationMethod") == 0 && kv.value().is<const char*>()) {
+      LOGI(TAG, "aggregationMethod override requested: %s", kv.value().as<const char*>());
+    }
+  }
+  return ok;
+}
 
-  if (doc["sensorAddress"].is<uint8_t>()) {
-    _s.sensor_addr = doc["sensorAddress"].as<uint8_t>();
+/**
+ * @brief Clamp the staged copy and check cross-field rules.
+ */
+bool SettingsManager::validateStageUnlocked(AppSettings& stage) const
+{
+  for (size_t i = 0; i < settingsschema::fieldCount(); i++) {
+    settingsschema::clamp(stage, settingsschema::field(i));
   }
-  if (doc["sensorBaudrate"].is<uint32_t>()) {
-    _s.sensor_baud = doc["sensorBaudrate"].as<uint32_t>();
+
+  if (stage.mqtt_host[0] == '\0' || stage.mqtt_port == 0u) {
+    LOGW(TAG, "Rejected: MQTT host/port must be set");
+    return false;
   }
-  if (doc["sensorWarmupMs"].is<uint32_t>()) {
-    _s.sensor_warmup_ms = doc["sensorWarmupMs"].as<uint32_t>();
+  if (!Logger::validLevels(stage.log_levels)) {
+    LOGW(TAG, "Rejected: bad logLevels \"%s\"", stage.log_levels);
+    return false;
   }
-  if (doc["sensorType"].is<uint32_t>()) {
-    _s.sensor_type = doc["sensorType"].as<uint32_t>();
+  return true;
+}
+
+/**
+ * @brief Copy the touched fields into _s; one revision bump and one save if anything changed.
+ */
+bool SettingsManager::commitStageUnlocked(const AppSettings& stage, uint32_t touched, bool persist,
+                                          uint8_t* changedSectionsOut)
+{
+  const AppSettings before = _s;
+  for (size_t i = 0; i < settingsschema::fieldCount(); i++) {
+    if ((touched & (1u << i)) != 0u) {
+      settingsschema::copyField(_s, stage, settingsschema::field(i));
+    }
   }
+  clampRuntimeSettingsUnlocked();
 
-  if (doc["samplingInterval"].is<uint32_t>()) {
-    _s.sample_period_ms = doc["samplingInterval"].as<uint32_t>();
+  const uint8_t changed = settingsschema::changedSections(before, _s);
+  if (changedSectionsOut != nullptr) {
+    *changedSectionsOut = changed;
   }
-  if (doc["aggPeriodS"].is<uint32_t>()) {
-    _s.agg_period_s = doc["aggPeriodS"].as<uint32_t>();
+
+  // Repeated patches (e.g. the sampling parameters sent on every session
+  // start) must not wake the menu or the comms reconnect logic.
+  if (changed == 0u) {
+    LOGD(TAG, "Settings patch changed nothing");
+    return true;
   }
-  if (doc["aggregationMethod"].is<const char*>()) {
-    LOGI(TAG, "aggregationMethod override requested: %s", doc["aggregationMethod"].as<const char*>());
+  _revision++;
+  notifyUnlocked(before);
+
+  if (persist) {
+    return save();
   }
+  return true;
+}
 
-  if (doc["simPin"].is<const char*>()) {
-    strncpy(_s.sim_pin, doc["simPin"].as<const char*>(), sizeof(_s.sim_pin));
-    _s.sim_pin[sizeof(_s.sim_pin) - 1] = '\0';
+/**
+ * @brief Apply JSON patch to settings (stage, validate, commit).
+ */
+bool SettingsManager::applyJson(const char* json, bool persist, uint8_t* changedSectionsOut)
+{
+  if (changedSectionsOut != nullptr) {
+    *changedSectionsOut = 0;
   }
-  if (doc["apn"].is<const char*>()) {
-    strncpy(_s.apn, doc["apn"].as<const char*>(), sizeof(_s.apn));
-    _s.apn[sizeof(_s.apn) - 1] = '\0';
+  if (json == nullptr) {
+    return false;
   }
-  if (doc["apnUser"].is<const char*>()) {
-    strncpy(_s.apn_user, doc["apnUser"].as<const char*>(), sizeof(_s.apn_user));
-    _s.apn_user[sizeof(_s.apn_user) - 1] = '\0';
+
+  JsonDocument doc;
+  const DeserializationError err = deserializeJson(doc, json);
+  if (err) {
+    LOGW(TAG, "JSON parse failed: %s", err.c_str());
+    return false;
   }
-  if (doc["apnPass"].is<const char*>()) {
-    strncpy(_s.apn_pass, doc["apnPass"].as<const char*>(), sizeof(_s.apn_pass));
-    _s.apn_pass[sizeof(_s.apn_pass) - 1] = '\0';
+
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+
+  AppSettings stage   = _s;
+  uint32_t    touched = 0;
+  if (!stagePatchUnlocked(doc.as<JsonObjectConst>(), stage, touched) || !validateStageUnlocked(stage)) {
+    return false;
   }
+  return commitStageUnlocked(stage, touched, persist, changedSectionsOut);
+}
 
-  if (doc["mqttHost"].is<const char*>()) {
-    strncpy(_s.mqtt_host, doc["mqttHost"].as<const char*>(), sizeof(_s.mqtt_host));
-    _s.mqtt_host[sizeof(_s.mqtt_host) - 1] = '\0';
+SettingsManager::CfgResult SettingsManager::applyCfgMessage(const char* json, bool persist)
+{
+  CfgResult res;
+  if (json == nullptr) {
+    return res;
   }
-  if (doc["mqttPort"].is<uint16_t>()) {
-    _s.mqtt_port = doc["mqttPort"].as<uint16_t>();
+
+  JsonDocument doc;
+  const DeserializationError err = deserializeJson(doc, json);
+  if (err) {
+    LOGW(TAG, "JSON parse failed: %s", err.c_str());
+    return res;
   }
-  if (doc["mqttUser"].is<const char*>()) {
-    strncpy(_s.mqtt_user, doc["mqttUser"].as<const char*>(), sizeof(_s.mqtt_user));
-    _s.mqtt_user[sizeof(_s.mqtt_user) - 1] = '\0';
+
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+
+  const char* txn = doc["txn"] | "";
+  if (strcmp(txn, "rollback") == 0) {
+    rollbackTransaction();
+    res.ok = true;
+    return res;
   }
-  if (doc["mqttPass"].is<const char*>()) {
-    strncpy(_s.mqtt_pass, doc["mqttPass"].as<const char*>(), sizeof(_s.mqtt_pass));
-    _s.mqtt_pass[sizeof(_s.mqtt_pass) - 1] = '\0';
+
+  if (strcmp(txn, "begin") == 0 && !_txOpen) {
+    (void)beginTransaction();
   }
-  if (doc["mqttClientId"].is<const char*>()) {
-    strncpy(_s.mqtt_client_id, doc["mqttClientId"].as<const char*>(), sizeof(_s.mqtt_client_id));
-    _s.mqtt_client_id[sizeof(_s.mqtt_client_id) - 1] = '\0';
+
+  if (_txOpen) {
+    uint32_t touched = _txTouched;
+    if (!stagePatchUnlocked(doc.as<JsonObjectConst>(), _txStage, touched)) {
+      _txValid = false;
+    }
+    _txTouched = touched;
+
+    if (strcmp(txn, "commit") != 0) {
+      res.ok = _txValid;
+      return res;
+    }
+    res.ok        = commitTransaction(persist, &res.changedSections);
+    res.committed = res.ok;
+    return res;
   }
 
-  if (doc["deviceName"].is<const char*>()) {
-    strncpy(_s.device_name, doc["deviceName"].as<const char*>(), sizeof(_s.device_name));
-    _s.device_name[sizeof(_s.device_name) - 1] = '\0';
+  AppSettings stage   = _s;
+  uint32_t    touched = 0;
+  if (!stagePatchUnlocked(doc.as<JsonObjectConst>(), stage, touched) || !validateStageUnlocked(stage)) {
+    return res;
   }
+  res.ok        = commitStageUnlocked(stage, touched, persist, &res.changedSections);
+  res.committed = res.ok;
+  return res;
+}
 
-  if (doc["awareTimeoutS"].is<uint32_t>()) {
-    _s.aware_timeout_s = doc["awareTimeoutS"].as<uint32_t>();
+bool SettingsManager::beginTransaction()
+{
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (_txOpen) {
+    return false;
   }
-  if (doc["defaultSleepS"].is<uint32_t>()) {
-    _s.default_sleep_s = doc["defaultSleepS"].as<uint32_t>();
+
+  _txStage   = _s;
+  _txTouched = 0;
+  _txStartMs = timeutil::nowMs();
+  _txOpen    = true;
+  _txValid   = true;
+  LOGI(TAG, "Settings transaction begin");
+  return true;
+}
+
+bool SettingsManager::patchTransaction(const char* json)
+{
+  if (json == nullptr) {
+    return false;
   }
-  if (doc["statusIntervalS"].is<uint32_t>()) {
-    _s.status_interval_s = doc["statusIntervalS"].as<uint32_t>();
+
+  JsonDocument doc;
+  if (deserializeJson(doc, json)) {
+    mbed::ScopedLock<rtos::Mutex> lock(_mx);
+    _txValid = false;
+    return false;
   }
-  if (doc["lowBattMinV"].is<float>()) {
-    _s.low_batt_min_v = doc["lowBattMinV"].as<float>();
+
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (!_txOpen) {
+    return false;
   }
-  if (doc["maxChargingCurrent"].is<uint16_t>()) {
-    _s.max_charging_current = doc["maxChargingCurrent"].as<uint16_t>();
+
+  uint32_t touched = _txTouched;
+  if (!stagePatchUnlocked(doc.as<JsonObjectConst>(), _txStage, touched)) {
+    _txValid = false;
   }
-  if (doc["maxChargingVoltage"].is<float>()) {
-    _s.max_charging_voltage = doc["maxChargingVoltage"].as<float>();
+  _txTouched = touched;
+  return _txValid;
+}
+
+bool SettingsManager::validateTransaction()
+{
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (!_txOpen || !_txValid) {
+    return false;
   }
-  if (doc["emergencyDelayS"].is<uint32_t>()) {
-    _s.emergency_delay_s = doc["emergencyDelayS"].as<uint32_t>();
+
+  AppSettings probe = _txStage;
+  return validateStageUnlocked(probe);
+}
+
+bool SettingsManager::commitTransaction(bool persist, uint8_t* changedSectionsOut)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (changedSectionsOut != nullptr) {
+    *changedSectionsOut = 0;
   }
-  if (doc["emergencySleepS"].is<uint32_t>()) {
-    _s.emergency_sleep_s = doc["emergencySleepS"].as<uint32_t>();
+  if (!_txOpen) {
+    return false;
   }
-  if (doc["maxForcedSleepS"].is<uint32_t>()) {
-    _s.max_forced_sleep_s = doc["maxForcedSleepS"].as<uint32_t>();
+  _txOpen = false;
+
+  // Validate the result as it will look after commit (current values + staged keys).
+  AppSettings merged = _s;
+  for (size_t i = 0; i < settingsschema::fieldCount(); i++) {
+    if ((_txTouched & (1u << i)) != 0u) {
+      settingsschema::copyField(merged, _txStage, settingsschema::field(i));
+    }
   }
-  if (doc["maxUnackedPackets"].is<uint32_t>()) {
-    _s.max_unacked_packets = doc["maxUnackedPackets"].as<uint32_t>();
+  if (!_txValid || !validateStageUnlocked(merged)) {
+    LOGW(TAG, "Settings transaction rejected");
+    return false;
   }
 
-  clampRuntimeSettingsUnlocked();
-  _revision++;
+  LOGI(TAG, "Settings transaction commit");
+  return commitStageUnlocked(merged, _txTouched, persist, changedSectionsOut);
+}
 
-  if (persist) {
-    return save();
+void SettingsManager::rollbackTransaction()
+{
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (_txOpen) {
+    LOGI(TAG, "Settings transaction rollback");
+  }
+  _txOpen    = false;
+  _txTouched = 0;
+}
+
+void SettingsManager::expireStaleTransaction()
+{
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (_txOpen && (uint32_t)(timeutil::nowMs() - _txStartMs) > CFG_TXN_TIMEOUT_MS) {
+    LOGW(TAG, "Settings transaction timed out");
+    rollbackTransaction();
   }
-  return true;
 }
 
 /**
- * @brief Save settings to flash (single-sector scheme).
+ * @brief Append settings to the flash journal (erases only when a sector fills up).
  */
 bool SettingsManager::save()
 {
   mbed::ScopedLock<rtos::Mutex> lock(_mx);
 
-  mbed::FlashIAP flash;
-  if (flash.init() != 0) {
-    LOGE(TAG, "Flash init failed");
-    return false;
+  const uint32_t crc = SettingsJournal::crc32((const uint8_t*)&_s, sizeof(_s));
+  if (_hasPersisted && crc == _persistedCrc) {
+    LOGD(TAG, "Settings unchanged, flash write skipped");
+    return true;
   }
 
-  const uint32_t flashSize  = flash.get_flash_size();
-  const uint32_t sectorSize = flash.get_sector_size(flash.get_flash_start() + flashSize - 1);
-  const uint32_t base       = flash.get_flash_start() + flashSize - sectorSize;
-
-  StoredBlob blob;
-  blob.magic    = SETTINGS_MAGIC;
-  blob.settings = _s;
-  blob.crc      = crc32((const uint8_t*)&blob.settings, sizeof(blob.settings));
-
-  if (flash.erase(base, sectorSize) != 0) {
-    LOGE(TAG, "Flash erase failed");
-    flash.deinit();
+  if (!_journal.append(&_s, sizeof(_s))) {
+    LOGE(TAG, "Settings save failed");
     return false;
   }
 
-  const uint32_t pageSize = flash.get_page_size();
-  const uint8_t* p = (const uint8_t*)&blob;
-  size_t remaining = sizeof(blob);
-  uint32_t addr = base;
-
-  while (remaining > 0) {
-    const size_t chunk = (remaining > pageSize) ? pageSize : remaining;
-    if (flash.program(p, addr, chunk) != 0) {
-      LOGE(TAG, "Flash program failed");
-      flash.deinit();
-      return false;
-    }
-    addr += chunk;
-    p += chunk;
-    remaining -= chunk;
-  }
-
-  flash.deinit();
-  LOGI(TAG, "Settings saved");
+  _hasPersisted = true;
+  _persistedCrc = crc;
+  LOGI(TAG, "Settings saved (seq=%lu)", (unsigned long)_journal.latestSeq());
   return true;
 }
 
 /**
- * @brief Load settings from flash if valid.
+ * @brief Load the newest valid settings record, falling back to the legacy blob.
  */
 bool SettingsManager::loadFromFlash()
 {
+  AppSettings loaded;
+  size_t      loadedLen = 0;
+  if (_journal.loadLatest(&loaded, sizeof(loaded), &loadedLen)) {
+    _s            = loaded;
+    _hasPersisted = true;
+    _persistedCrc = SettingsJournal::crc32((const uint8_t*)&_s, sizeof(_s));
+    if (loadedLen < sizeof(_s)) {
+      // Older layout: fields appended since then keep their defaults.
+      LOGI(TAG, "Upgrading settings record v%lu (%u bytes)", (unsigned long)_s.version, (unsigned)loadedLen);
+      _s.version = AppSettings().version;
+      (void)save();
+    }
+    return true;
+  }
+
   mbed::FlashIAP flash;
   if (flash.init() != 0) {
     return false;
@@ -345,14 +488,20 @@ bool SettingsManager::loadFromFlash()
   }
 
   const uint32_t got = blob->crc;
-  const uint32_t exp = crc32((const uint8_t*)&blob->settings, sizeof(blob->settings));
+  const uint32_t exp = SettingsJournal::crc32((const uint8_t*)&blob->settings, kLegacySettingsBytes);
   if (got != exp) {
     flash.deinit();
     return false;
   }
 
-  _s = blob->settings;
+  _s = AppSettings();
+  memcpy(&_s, &blob->settings, kLegacySettingsBytes);
+  _s.version = AppSettings().version;
   flash.deinit();
+
+  // Migrate once; the journal never overwrites the legacy blob until compaction.
+  LOGI(TAG, "Migrating legacy settings blob to journal");
+  (void)save();
   return true;
 }
 
@@ -368,37 +517,32 @@ void SettingsManager::setDefaults()
 
 void SettingsManager::clampRuntimeSettingsUnlocked()
 {
-  if (_s.sample_period_ms < MIN_SAMPLE_PERIOD_MS) {
-    _s.sample_period_ms = MIN_SAMPLE_PERIOD_MS;
-  }
-
-  if (_s.aware_timeout_s < kMinAwareTimeoutS) {
-    _s.aware_timeout_s = kDefaultAwareTimeoutS;
-  }
-  if (_s.default_sleep_s < kMinDefaultSleepS) {
-    _s.default_sleep_s = kDefaultSleepS;
-  }
-  if (_s.status_interval_s < kMinStatusIntervalS) {
-    _s.status_interval_s = kDefaultStatusIntervalS;
-  }
-
-  if (_s.sensor_addr == 0u || _s.sensor_addr > 247u) {
-    _s.sensor_addr = 1u;
-  }
-  if (_s.max_forced_sleep_s == 0u || _s.max_forced_sleep_s > kMaxSleepDurationS) {
-    _s.max_forced_sleep_s = kMaxSleepDurationS;
-  }
-  if (_s.emergency_sleep_s == 0u || _s.emergency_sleep_s > kMaxSleepDurationS) {
-    _s.emergency_sleep_s = kMaxSleepDurationS;
+  for (size_t i = 0; i < settingsschema::fieldCount(); i++) {
+    settingsschema::clamp(_s, settingsschema::field(i));
   }
 }
 
 void SettingsManager::setRuntime(const AppSettings& s)
 {
   mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  const AppSettings before = _s;
   _s = s;
   clampRuntimeSettingsUnlocked();
-  _revision++;
+  if (changedSince(before)) {
+    _revision++;
+    notifyUnlocked(before);
+  }
+}
+
+/**
+ * @brief True if any field differs from a snapshot taken under the same lock.
+ *
+ * Both copies come from the same bytes and strings are written with strncpy
+ * (zero-padded), so a byte compare is a field compare.
+ */
+bool SettingsManager::changedSince(const AppSettings& before) const
+{
+  return memcmp(&before, &_s, sizeof(_s)) != 0;
 }
 
 /**
@@ -407,8 +551,10 @@ void SettingsManager::setRuntime(const AppSettings& s)
 void SettingsManager::factoryReset()
 {
   mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  const AppSettings before = _s;
   setDefaults();
   _revision++;
+  notifyUnlocked(before);
   (void)save();
 }
 
@@ -418,62 +564,79 @@ uint32_t SettingsManager::revision() const
   return _revision;
 }
 
-static const char* maskIfSet(const char* v)
+bool SettingsManager::subscribe(SettingsSubscription& sub)
 {
-  return (v != nullptr && v[0] != '\0') ? "***" : "";
+  mbed::ScopedLock<rtos::Mutex> lock(_mx);
+  if (_subCount >= kMaxSubscribers) {
+    LOGE(TAG, "No free settings subscription slot");
+    return false;
+  }
+  _subs[_subCount++] = &sub;
+  return true;
 }
 
-void SettingsManager::addMaskedConfigFields(JsonDocument& doc, ConfigSection section) const
+/**
+ * @brief Tell subscribers which groups changed relative to before.
+ *
+ * Runs under _mx; it only touches atomics, event flags and non-blocking
+ * wake hooks, so no subscriber code that could wait runs under the lock.
+ */
+void SettingsManager::notifyUnlocked(const AppSettings& before)
 {
-  const AppSettings s = getCopy();
-  const bool includeAll = (section == ConfigSection::All);
+  notifyUnlocked(before, _s);
+}
 
-  if (includeAll || section == ConfigSection::Network) {
-    doc["apn"]     = s.apn;
-    doc["simPin"]  = maskIfSet(s.sim_pin);
-    doc["apnUser"] = maskIfSet(s.apn_user);
-    doc["apnPass"] = maskIfSet(s.apn_pass);
+void SettingsManager::notifyUnlocked(const AppSettings& before, const AppSettings& after)
+{
+  const uint8_t groups = settingsschema::changedGroups(before, after);
+  if (groups == 0u) {
+    return;
   }
 
-  if (includeAll || section == ConfigSection::Mqtt) {
-    doc["mqttHost"]     = s.mqtt_host;
-    doc["mqttPort"]     = s.mqtt_port;
-    doc["mqttClientId"] = s.mqtt_client_id;
-    doc["mqttUser"]     = maskIfSet(s.mqtt_user);
-    doc["mqttPass"]     = maskIfSet(s.mqtt_pass);
+  for (size_t i = 0; i < _subCount; i++) {
+    SettingsSubscription& sub = *_subs[i];
+    const uint8_t         hit = groups & sub.interest;
+    if (hit == 0u) {
+      continue;
+    }
+    sub.pending.fetch_or(hit);
+    if (sub.flags != nullptr) {
+      sub.flags->set(sub.flag);
+    }
+    if (sub.wake != nullptr) {
+      sub.wake(sub.wakeCtx);
+    }
   }
+}
 
-  if (includeAll || section == ConfigSection::Device) {
-    doc["deviceName"]     = s.device_name;
-    doc["sensorAddress"]  = s.sensor_addr;
-    doc["sensorBaudrate"] = s.sensor_baud;
-    doc["sensorWarmupMs"] = s.sensor_warmup_ms;
-    doc["sensorType"]     = s.sensor_type;
-  }
+void SettingsManager::addMaskedConfigFields(JsonDocument& doc, ConfigSection section) const
+{
+  const AppSettings s = storedCopy();
 
-  if (includeAll || section == ConfigSection::Schedule) {
-    doc["samplingInterval"] = s.sample_period_ms;
-    doc["aggPeriodS"]      = s.agg_period_s;
-    doc["awareTimeoutS"]   = s.aware_timeout_s;
-    doc["defaultSleepS"]   = s.default_sleep_s;
-    doc["statusIntervalS"] = s.status_interval_s;
+  for (size_t i = 0; i < settingsschema::fieldCount(); i++) {
+    const settingsschema::Field& f = settingsschema::field(i);
+    if (settingsschema::inSection(f, section)) {
+      settingsschema::addToJson(doc, s, f);
+    }
   }
+}
 
-  if (includeAll || section == ConfigSection::Power) {
-    doc["lowBattMinV"]        = s.low_batt_min_v;
-    doc["maxChargingCurrent"] = s.max_charging_current;
-    doc["maxChargingVoltage"] = s.max_charging_voltage;
-    doc["emergencyDelayS"]    = s.emergency_delay_s;
-    doc["emergencySleepS"]    = s.emergency_sleep_s;
-    doc["maxForcedSleepS"]    = s.max_forced_sleep_s;
-    doc["maxUnackedPackets"]  = s.max_unacked_packets;
-  }
+uint32_t SettingsManager::configDigest() const
+{
+  const AppSettings s = storedCopy();
+  return settingsschema::digest(s);
+}
+
+size_t SettingsManager::encodeConfigSnapshot(uint8_t* out, size_t outLen) const
+{
+  const AppSettings s = storedCopy();
+  return settingsschema::encodeSnapshot(s, out, outLen);
 }
 
 bool SettingsManager::onIsItemSelectedEvent(const JsonVariantConst itemRetVal)
 {
-  const char* prop = itemRetVal["prop"] | "";
-  if (prop[0] == '\0') {
+  const settingsschema::Field* f = settingsschema::find(itemRetVal["prop"] | "");
+  if (f == nullptr || !settingsschema::isNumeric(*f)) {
     return false;
   }
 
@@ -482,108 +645,23 @@ bool SettingsManager::onIsItemSelectedEvent(const JsonVariantConst itemRetVal)
     return false;
   }
 
-  const AppSettings s = getCopy();
-
-  if (strcmp(prop, "sensorAddress") == 0) {
-    return numericEqualsInteger(valueNode, s.sensor_addr);
-  }
-  if (strcmp(prop, "sensorBaudrate") == 0) {
-    return numericEqualsInteger(valueNode, s.sensor_baud);
-  }
-  if (strcmp(prop, "sensorWarmupMs") == 0) {
-    return numericEqualsInteger(valueNode, s.sensor_warmup_ms);
-  }
-  if (strcmp(prop, "sensorType") == 0) {
-    return numericEqualsInteger(valueNode, s.sensor_type);
-  }
-  if (strcmp(prop, "samplingInterval") == 0) {
-    return numericEqualsInteger(valueNode, s.sample_period_ms);
-  }
-  if (strcmp(prop, "aggPeriodS") == 0) {
-    return numericEqualsInteger(valueNode, s.agg_period_s);
-  }
-  if (strcmp(prop, "mqttPort") == 0) {
-    return numericEqualsInteger(valueNode, s.mqtt_port);
-  }
-  if (strcmp(prop, "awareTimeoutS") == 0) {
-    return numericEqualsInteger(valueNode, s.aware_timeout_s);
-  }
-  if (strcmp(prop, "defaultSleepS") == 0) {
-    return numericEqualsInteger(valueNode, s.default_sleep_s);
-  }
-  if (strcmp(prop, "statusIntervalS") == 0) {
-    return numericEqualsInteger(valueNode, s.status_interval_s);
-  }
-  if (strcmp(prop, "lowBattMinV") == 0) {
-    return numericEqualsFloat(valueNode, s.low_batt_min_v);
-  }
-  if (strcmp(prop, "maxChargingCurrent") == 0) {
-    return numericEqualsInteger(valueNode, s.max_charging_current);
-  }
-  if (strcmp(prop, "maxChargingVoltage") == 0) {
-    return numericEqualsFloat(valueNode, s.max_charging_voltage);
+  const AppSettings s = storedCopy();
+  if (f->type == settingsschema::FieldType::F32) {
+    return numericEqualsFloat(valueNode, settingsschema::getFloat(s, *f));
   }
-  if (strcmp(prop, "emergencyDelayS") == 0) {
-    return numericEqualsInteger(valueNode, s.emergency_delay_s);
-  }
-  if (strcmp(prop, "emergencySleepS") == 0) {
-    return numericEqualsInteger(valueNode, s.emergency_sleep_s);
-  }
-  if (strcmp(prop, "maxForcedSleepS") == 0) {
-    return numericEqualsInteger(valueNode, s.max_forced_sleep_s);
-  }
-  if (strcmp(prop, "maxUnackedPackets") == 0) {
-    return numericEqualsInteger(valueNode, s.max_unacked_packets);
-  }
-
-  return false;
+  return numericEqualsInteger(valueNode, settingsschema::getUnsigned(s, *f));
 }
 
 bool SettingsManager::getStringSettingValue(const char* prop, String& outValue)
 {
   outValue = "";
-  if (prop == nullptr || prop[0] == '\0') {
-    return false;
-  }
 
-  const AppSettings s = getCopy();
-
-  if (strcmp(prop, "simPin") == 0) {
-    outValue = s.sim_pin;
-    return true;
-  }
-  if (strcmp(prop, "apn") == 0) {
-    outValue = s.apn;
-    return true;
-  }
-  if (strcmp(prop, "apnUser") == 0) {
-    outValue = s.apn_user;
-    return true;
-  }
-  if (strcmp(prop, "apnPass") == 0) {
-    outValue = s.apn_pass;
-    return true;
-  }
-  if (strcmp(prop, "mqttHost") == 0) {
-    outValue = s.mqtt_host;
-    return true;
-  }
-  if (strcmp(prop, "mqttUser") == 0) {
-    outValue = s.mqtt_user;
-    return true;
-  }
-  if (strcmp(prop, "mqttPass") == 0) {
-    outValue = s.mqtt_pass;
-    return true;
-  }
-  if (strcmp(prop, "mqttClientId") == 0) {
-    outValue = s.mqtt_client_id;
-    return true;
-  }
-  if (strcmp(prop, "deviceName") == 0) {
-    outValue = s.device_name;
-    return true;
+  const settingsschema::Field* f = settingsschema::find(prop);
+  if (f == nullptr || f->type != settingsschema::FieldType::Str) {
+    return false;
   }
 
-  return false;
+  const AppSettings s = storedCopy();
+  outValue = settingsschema::getString(s, *f);
+  return true;
 }
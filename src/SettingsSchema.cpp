@@ -0,0 +1,340 @@
+#include "SettingsSchema.h"
+
+#include "AppConfig.h"
+
+#include <string.h>
+
+namespace settingsschema {
+namespace {
+
+using Section = SettingsManager::ConfigSection;
+using Group   = SettingsGroup;
+
+static constexpr uint32_t kNoMax                  = 0xFFFFFFFFu;
+static constexpr uint32_t kMinAwareTimeoutS       = 60u;
+static constexpr uint32_t kDefaultAwareTimeoutS   = 600u;
+static constexpr uint32_t kMinDefaultSleepS       = 60u;
+static constexpr uint32_t kDefaultSleepS          = 3600u;
+static constexpr uint32_t kMinStatusIntervalS     = 30u;
+static constexpr uint32_t kDefaultStatusIntervalS = 120u;
+static constexpr uint32_t kMaxSleepDurationS      = 43200u;
+
+#define SETTING_MEMBER(m) (uint16_t)offsetof(AppSettings, m), (uint8_t)sizeof(AppSettings::m)
+
+// Rows are grouped by section in config publishing order.
+static constexpr Field kFields[] = {
+  // Network
+  {"apn",                SETTING_MEMBER(apn),                  FieldType::Str, Section::Network,  Group::Network,  false, 0u, 0u, 0u},
+  {"simPin",             SETTING_MEMBER(sim_pin),              FieldType::Str, Section::Network,  Group::Network,  true,  0u, 0u, 0u},
+  {"apnUser",            SETTING_MEMBER(apn_user),             FieldType::Str, Section::Network,  Group::Network,  true,  0u, 0u, 0u},
+  {"apnPass",            SETTING_MEMBER(apn_pass),             FieldType::Str, Section::Network,  Group::Network,  true,  0u, 0u, 0u},
+
+  // MQTT
+  {"mqttHost",           SETTING_MEMBER(mqtt_host),            FieldType::Str, Section::Mqtt,     Group::Network,  false, 0u, 0u, 0u},
+  {"mqttPort",           SETTING_MEMBER(mqtt_port),            FieldType::U16, Section::Mqtt,     Group::Network,  false, 0u, kNoMax, 0u},
+  {"mqttClientId",       SETTING_MEMBER(mqtt_client_id),       FieldType::Str, Section::Mqtt,     Group::Network,  false, 0u, 0u, 0u},
+  {"mqttUser",           SETTING_MEMBER(mqtt_user),            FieldType::Str, Section::Mqtt,     Group::Network,  true,  0u, 0u, 0u},
+  {"mqttPass",           SETTING_MEMBER(mqtt_pass),            FieldType::Str, Section::Mqtt,     Group::Network,  true,  0u, 0u, 0u},
+
+  // Device / sensor
+  {"deviceName",         SETTING_MEMBER(device_name),          FieldType::Str, Section::Device,   Group::Network,  false, 0u, 0u, 0u},
+  {"sensorAddress",      SETTING_MEMBER(sensor_addr),          FieldType::U8,  Section::Device,   Group::Sensor,   false, 1u, 247u, 1u},
+  {"sensorBaudrate",     SETTING_MEMBER(sensor_baud),          FieldType::U32, Section::Device,   Group::Sensor,   false, 0u, kNoMax, 0u},
+  {"sensorWarmupMs",     SETTING_MEMBER(sensor_warmup_ms),     FieldType::U32, Section::Device,   Group::Sensor,   false, 0u, kNoMax, 0u},
+  {"sensorType",         SETTING_MEMBER(sensor_type),          FieldType::U32, Section::Device,   Group::Sensor,   false, 0u, kNoMax, 0u},
+  {"logLevels",          SETTING_MEMBER(log_levels),           FieldType::Str, Section::Device,   Group::Logging,  false, 0u, 0u, 0u},
+
+  // Schedule
+  {"samplingInterval",   SETTING_MEMBER(sample_period_ms),     FieldType::U32, Section::Schedule, Group::Schedule, false, MIN_SAMPLE_PERIOD_MS, kNoMax, MIN_SAMPLE_PERIOD_MS},
+  {"aggPeriodS",         SETTING_MEMBER(agg_period_s),         FieldType::U32, Section::Schedule, Group::Schedule, false, 0u, kNoMax, 0u},
+  {"awareTimeoutS",      SETTING_MEMBER(aware_timeout_s),      FieldType::U32, Section::Schedule, Group::Schedule, false, kMinAwareTimeoutS, kNoMax, kDefaultAwareTimeoutS},
+  {"defaultSleepS",      SETTING_MEMBER(default_sleep_s),      FieldType::U32, Section::Schedule, Group::Schedule, false, kMinDefaultSleepS, kNoMax, kDefaultSleepS},
+  {"statusIntervalS",    SETTING_MEMBER(status_interval_s),    FieldType::U32, Section::Schedule, Group::Schedule, false, kMinStatusIntervalS, kNoMax, kDefaultStatusIntervalS},
+  {"schedIntervalS",     SETTING_MEMBER(sched_interval_s),     FieldType::U32, Section::Schedule, Group::Schedule, false, 0u, kMaxSleepDurationS, 0u},
+  {"schedDurationS",     SETTING_MEMBER(sched_duration_s),     FieldType::U32, Section::Schedule, Group::Schedule, false, 0u, kMaxSleepDurationS, 0u},
+  {"schedSamplingInterval", SETTING_MEMBER(sched_sample_period_ms), FieldType::U32, Section::Schedule, Group::Schedule, false, 0u, kNoMax, 0u},
+  {"schedAggPeriodS",    SETTING_MEMBER(sched_agg_period_s),   FieldType::U32, Section::Schedule, Group::Schedule, false, 0u, kNoMax, 0u},
+
+  // Power
+  {"lowBattMinV",        SETTING_MEMBER(low_batt_min_v),       FieldType::F32, Section::Power,    Group::Power,    false, 0u, 0u, 0u},
+  {"maxChargingCurrent", SETTING_MEMBER(max_charging_current), FieldType::U16, Section::Power,    Group::Power,    false, 0u, kNoMax, 0u},
+  {"maxChargingVoltage", SETTING_MEMBER(max_charging_voltage), FieldType::F32, Section::Power,    Group::Power,    false, 0u, 0u, 0u},
+  {"emergencyDelayS",    SETTING_MEMBER(emergency_delay_s),    FieldType::U32, Section::Power,    Group::Power,    false, 0u, kNoMax, 0u},
+  {"emergencySleepS",    SETTING_MEMBER(emergency_sleep_s),    FieldType::U32, Section::Power,    Group::Power,    false, 1u, kMaxSleepDurationS, kMaxSleepDurationS},
+  {"maxForcedSleepS",    SETTING_MEMBER(max_forced_sleep_s),   FieldType::U32, Section::Power,    Group::Power,    false, 1u, kMaxSleepDurationS, kMaxSleepDurationS},
+  {"maxUnackedPackets",  SETTING_MEMBER(max_unacked_packets),  FieldType::U32, Section::Power,    Group::Schedule, false, 0u, kNoMax, 0u},
+  {"lowPowerIdle",       SETTING_MEMBER(low_power_idle),       FieldType::U8,  Section::Power,    Group::Power,    false, 0u, 1u, 1u},
+};
+
+#undef SETTING_MEMBER
+
+static constexpr size_t kFieldCount = sizeof(kFields) / sizeof(kFields[0]);
+static_assert(kFieldCount <= 32, "touched-field masks are uint32_t");
+
+inline uint8_t* memberPtr(AppSettings& s, const Field& f)
+{
+  return (uint8_t*)&s + f.offset;
+}
+
+inline const uint8_t* memberPtr(const AppSettings& s, const Field& f)
+{
+  return (const uint8_t*)&s + f.offset;
+}
+
+const char* maskIfSet(const char* v)
+{
+  return (v != nullptr && v[0] != '\0') ? "***" : "";
+}
+
+} // namespace
+
+size_t fieldCount()
+{
+  return kFieldCount;
+}
+
+const Field& field(size_t i)
+{
+  return kFields[i];
+}
+
+const Field* find(const char* key)
+{
+  if (key == nullptr) {
+    return nullptr;
+  }
+
+  for (size_t i = 0; i < kFieldCount; i++) {
+    // First-character check avoids most strcmp calls.
+    if (kFields[i].key[0] == key[0] && strcmp(kFields[i].key, key) == 0) {
+      return &kFields[i];
+    }
+  }
+  return nullptr;
+}
+
+size_t indexOf(const Field& f)
+{
+  return (size_t)(&f - &kFields[0]);
+}
+
+void copyField(AppSettings& dst, const AppSettings& src, const Field& f)
+{
+  memcpy(memberPtr(dst, f), memberPtr(src, f), f.size);
+}
+
+uint8_t changedSections(const AppSettings& a, const AppSettings& b)
+{
+  uint8_t mask = 0;
+  for (size_t i = 0; i < kFieldCount; i++) {
+    const Field& f = kFields[i];
+    if (memcmp(memberPtr(a, f), memberPtr(b, f), f.size) != 0) {
+      mask |= SettingsManager::sectionBit(f.section);
+    }
+  }
+  return mask;
+}
+
+uint8_t changedGroups(const AppSettings& a, const AppSettings& b)
+{
+  uint8_t mask = 0;
+  for (size_t i = 0; i < kFieldCount; i++) {
+    const Field& f = kFields[i];
+    if (memcmp(memberPtr(a, f), memberPtr(b, f), f.size) != 0) {
+      mask |= settingsGroupBit(f.group);
+    }
+  }
+  return mask;
+}
+
+bool inSection(const Field& f, SettingsManager::ConfigSection section)
+{
+  return section == Section::All || f.section == section;
+}
+
+uint32_t getUnsigned(const AppSettings& s, const Field& f)
+{
+  const uint8_t* p = memberPtr(s, f);
+  switch (f.type) {
+    case FieldType::U8:
+      return *p;
+    case FieldType::U16: {
+      uint16_t v;
+      memcpy(&v, p, sizeof(v));
+      return v;
+    }
+    case FieldType::U32: {
+      uint32_t v;
+      memcpy(&v, p, sizeof(v));
+      return v;
+    }
+    default:
+      return 0u;
+  }
+}
+
+float getFloat(const AppSettings& s, const Field& f)
+{
+  if (f.type != FieldType::F32) {
+    return 0.0f;
+  }
+  float v;
+  memcpy(&v, memberPtr(s, f), sizeof(v));
+  return v;
+}
+
+const char* getString(const AppSettings& s, const Field& f)
+{
+  return (f.type == FieldType::Str) ? (const char*)memberPtr(s, f) : "";
+}
+
+bool set(AppSettings& s, const Field& f, JsonVariantConst value)
+{
+  uint8_t* p = memberPtr(s, f);
+
+  switch (f.type) {
+    case FieldType::U8:
+      if (!value.is<uint8_t>()) {
+        return false;
+      }
+      *p = value.as<uint8_t>();
+      return true;
+
+    case FieldType::U16: {
+      if (!value.is<uint16_t>()) {
+        return false;
+      }
+      const uint16_t v = value.as<uint16_t>();
+      memcpy(p, &v, sizeof(v));
+      return true;
+    }
+
+    case FieldType::U32: {
+      if (!value.is<uint32_t>()) {
+        return false;
+      }
+      const uint32_t v = value.as<uint32_t>();
+      memcpy(p, &v, sizeof(v));
+      return true;
+    }
+
+    case FieldType::F32: {
+      if (!value.is<float>()) {
+        return false;
+      }
+      const float v = value.as<float>();
+      memcpy(p, &v, sizeof(v));
+      return true;
+    }
+
+    case FieldType::Str:
+      if (!value.is<const char*>()) {
+        return false;
+      }
+      strncpy((char*)p, value.as<const char*>(), f.size);
+      p[f.size - 1] = '\0';
+      return true;
+  }
+  return false;
+}
+
+void clamp(AppSettings& s, const Field& f)
+{
+  if (f.type != FieldType::U8 && f.type != FieldType::U16 && f.type != FieldType::U32) {
+    return;
+  }
+
+  const uint32_t v = getUnsigned(s, f);
+  if (v >= f.minValue && v <= f.maxValue) {
+    return;
+  }
+
+  uint8_t* p = memberPtr(s, f);
+  if (f.type == FieldType::U8) {
+    *p = (uint8_t)f.fallback;
+  } else if (f.type == FieldType::U16) {
+    const uint16_t fb = (uint16_t)f.fallback;
+    memcpy(p, &fb, sizeof(fb));
+  } else {
+    memcpy(p, &f.fallback, sizeof(f.fallback));
+  }
+}
+
+void addToJson(JsonDocument& doc, const AppSettings& s, const Field& f)
+{
+  switch (f.type) {
+    case FieldType::Str: {
+      const char* v = getString(s, f);
+      doc[f.key] = f.secret ? maskIfSet(v) : v;
+      break;
+    }
+    case FieldType::F32:
+      doc[f.key] = getFloat(s, f);
+      break;
+    default:
+      doc[f.key] = getUnsigned(s, f);
+      break;
+  }
+}
+
+uint32_t digest(const AppSettings& s)
+{
+  uint32_t crc = 0u;
+
+  for (size_t i = 0; i < kFieldCount; i++) {
+    const Field& f = kFields[i];
+    switch (f.type) {
+      case FieldType::Str: {
+        const char* v = f.secret ? maskIfSet(getString(s, f)) : getString(s, f);
+        crc = SettingsJournal::crc32((const uint8_t*)v, strlen(v) + 1u, crc);
+        break;
+      }
+      case FieldType::F32: {
+        const float v = getFloat(s, f);
+        crc = SettingsJournal::crc32((const uint8_t*)&v, sizeof(v), crc);
+        break;
+      }
+      default: {
+        const uint32_t v = getUnsigned(s, f);
+        crc = SettingsJournal::crc32((const uint8_t*)&v, sizeof(v), crc);
+        break;
+      }
+    }
+  }
+  return crc;
+}
+
+size_t encodeSnapshot(const AppSettings& s, uint8_t* out, size_t outLen)
+{
+  if (out == nullptr || outLen == 0) {
+    return 0;
+  }
+
+  JsonDocument doc;
+  JsonArray root = doc.to<JsonArray>();
+  root.add(kSchemaVersion);
+  root.add(digest(s));
+
+  JsonArray values = root.add<JsonArray>();
+  for (size_t i = 0; i < kFieldCount; i++) {
+    const Field& f = kFields[i];
+    switch (f.type) {
+      case FieldType::Str:
+        values.add(f.secret ? maskIfSet(getString(s, f)) : getString(s, f));
+        break;
+      case FieldType::F32:
+        values.add(getFloat(s, f));
+        break;
+      default:
+        values.add(getUnsigned(s, f));
+        break;
+    }
+  }
+
+  if (measureMsgPack(doc) > outLen) {
+    return 0;
+  }
+  return serializeMsgPack(doc, out, outLen);
+}
+
+} // namespace settingsschema
@@ -4,8 +4,18 @@
 
 #include <Arduino.h> // millis(), delay()
 
+#include <chrono>
+
 namespace stoputil {
 
+static const char* TAG = "STOP";
+
+bool StopSignal::waitAck(uint32_t timeoutMs)
+{
+  const uint32_t got = _ack.wait_any_for(kAckFlag, std::chrono::milliseconds(timeoutMs));
+  return (got & osFlagsError) == 0u && (got & kAckFlag) != 0u;
+}
+
 static const char* threadStateToString(rtos::Thread::State state)
 {
   switch (state) {
@@ -33,6 +43,8 @@ static const char* threadStateToString(rtos::Thread::State state)
       return "WaitingMessageGet";
     case rtos::Thread::WaitingMessagePut:
       return "WaitingMessagePut";
+    case rtos::Thread::Deleted:
+      return "Deleted";
     default:
       return "Unknown";
   }
@@ -40,8 +52,6 @@ static const char* threadStateToString(rtos::Thread::State state)
 
 void terminateThread(const char* name, rtos::Thread& thread, uint32_t waitMs)
 {
-  static const char* TAG = "STOP";
-
   LOGI(TAG, "%s stop: terminate() begin", name);
   const auto st = thread.terminate(); // returns osStatus (type varies across toolchains)
   LOGI(TAG, "%s stop: terminate() returned %ld", name, (long)st);
@@ -61,4 +71,23 @@ void terminateThread(const char* name, rtos::Thread& thread, uint32_t waitMs)
   LOGW(TAG, "%s stop: state still %s", name, threadStateToString(s));
 }
 
+bool awaitStop(const char* name, rtos::Thread& thread, StopSignal& signal, uint32_t ackTimeoutMs)
+{
+  if (thread.get_state() == rtos::Thread::Deleted) {
+    return true;
+  }
+
+  const uint32_t start = (uint32_t)millis();
+  if (!signal.waitAck(ackTimeoutMs)) {
+    LOGW(TAG, "%s stop: no ack within %lu ms, terminating", name, (unsigned long)ackTimeoutMs);
+    terminateThread(name, thread);
+    return false;
+  }
+
+  // The thread returns right after acknowledging.
+  (void)thread.join();
+  LOGI(TAG, "%s stop: flushed and exited in %lu ms", name, (unsigned long)((uint32_t)millis() - start));
+  return true;
+}
+
 } // namespace stoputil
@@ -0,0 +1,48 @@
+#include "ThreadProfile.h"
+
+void ThreadProfile::running(uint32_t nowUs)
+{
+  if (_running) {
+    return;
+  }
+  _running = true;
+  _sinceUs = nowUs;
+}
+
+void ThreadProfile::waiting(uint32_t nowUs)
+{
+  if (!_running) {
+    return;
+  }
+  _running = false;
+  _windowUs += nowUs - _sinceUs;
+}
+
+void ThreadProfile::stack(uint32_t sizeBytes, uint32_t freeBytes)
+{
+  _stackSize = sizeBytes;
+  if (freeBytes == 0u || freeBytes > sizeBytes) {
+    return;
+  }
+  if (_stackFree == 0u || freeBytes < _stackFree) {
+    _stackFree = freeBytes;
+  }
+}
+
+void ThreadProfile::roll(uint32_t nowUs, uint32_t windowMs)
+{
+  if (_running) {
+    _windowUs += nowUs - _sinceUs;
+    _sinceUs = nowUs;
+  }
+
+  _busyTotalUs += _windowUs;
+  if (windowMs > 0u) {
+    uint64_t permille = (uint64_t)_windowUs / windowMs;
+    _cpu              = (uint16_t)((permille > 1000u) ? 1000u : permille);
+    if (_cpu > _cpuPeak) {
+      _cpuPeak = _cpu;
+    }
+  }
+  _windowUs = 0;
+}
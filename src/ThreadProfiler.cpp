@@ -0,0 +1,94 @@
+#include "ThreadProfiler.h"
+#include "ThreadProfile.h"
+
+#include <Arduino.h>
+#include <cmsis_os2.h>
+#include <mbed.h>
+#include <platform/ScopedLock.h>
+
+namespace threadprof {
+namespace {
+
+static const char* const kNames[kSlotCount] = {"main", "Orch", "SENS", "AGG", "UI"};
+
+static rtos::Mutex   g_mx;
+static ThreadProfile g_prof[kSlotCount];
+static osThreadId_t  g_tid[kSlotCount];
+static uint32_t      g_windowStartMs = 0;
+
+bool alive(osThreadId_t tid)
+{
+  if (tid == nullptr) {
+    return false;
+  }
+  const osThreadState_t st = osThreadGetState(tid);
+  return st != osThreadTerminated && st != osThreadError && st != osThreadInactive;
+}
+
+} // namespace
+
+void attach(Slot slot)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  const size_t i = (size_t)slot;
+  g_tid[i]       = osThreadGetId();
+  g_prof[i].stack(osThreadGetStackSize(g_tid[i]), osThreadGetStackSpace(g_tid[i]));
+  g_prof[i].running(micros());
+}
+
+void waiting(Slot slot)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  g_prof[(size_t)slot].waiting(micros());
+}
+
+void running(Slot slot)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  g_prof[(size_t)slot].running(micros());
+}
+
+void sample(uint32_t nowMs)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  // Window on the kernel clock: it keeps counting through Stop mode, micros() does not.
+  const uint32_t windowMs = nowMs - g_windowStartMs;
+  g_windowStartMs         = nowMs;
+  const uint32_t nowUs    = micros();
+  for (size_t i = 0; i < kSlotCount; i++) {
+    if (alive(g_tid[i])) {
+      g_prof[i].stack(osThreadGetStackSize(g_tid[i]), osThreadGetStackSpace(g_tid[i]));
+    }
+    g_prof[i].roll(nowUs, windowMs);
+  }
+}
+
+bool stats(Slot slot, Stats& out)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  const size_t i = (size_t)slot;
+  if (g_tid[i] == nullptr) {
+    return false;
+  }
+  const ThreadProfile& p = g_prof[i];
+  out.name               = kNames[i];
+  out.stackSize          = p.stackSize();
+  out.stackPeak          = p.stackPeak();
+  out.cpuPermille        = p.cpuPermille();
+  out.peakCpuPermille    = p.peakCpuPermille();
+  out.busyMs             = p.busyMs();
+  return true;
+}
+
+void addToJson(JsonDocument& doc)
+{
+  mbed::ScopedLock<rtos::Mutex> lock(g_mx);
+  JsonArray stk = doc["stk"].to<JsonArray>();
+  JsonArray cpu = doc["cpu"].to<JsonArray>();
+  for (size_t i = 0; i < kSlotCount; i++) {
+    stk.add(g_prof[i].stackPeak());
+    cpu.add(g_prof[i].cpuPermille());
+  }
+}
+
+} // namespace threadprof
@@ -6,6 +6,7 @@
 #include "TimeUtil.h"
 #include "BoardHal.h"
 #include "StopUtil.h"
+#include "ThreadProfiler.h"
 #include <Arduino.h>
 #include <platform/ScopedLock.h>
 #include <cmsis_os2.h>
@@ -58,13 +59,18 @@ void UiThread::onItemSelectedEvent(const JsonVariantConst itemRetVal)
   strncpy(e.topic, topic, sizeof(e.topic));
   e.topic[sizeof(e.topic) - 1] = '\0';
 
-  const size_t n = serializeJson(itemRetVal, e.value, sizeof(e.value));
+  char value[PAYLOAD_MEDIUM_BYTES];
+  const size_t n = serializeJson(itemRetVal, value, sizeof(value));
   if (n == 0) {
-    e.value[0] = '\0';
+    value[0] = '\0';
   } else {
-    e.value[sizeof(e.value) - 1] = '\0';
+    value[sizeof(value) - 1] = '\0';
   }
 
+  if (!payloadpool::store(value, e.value)) {
+    LOGW(TAG, "Menu event dropped: payload pool exhausted");
+    return;
+  }
   _eventBus.publishUi(e);
 }
 
@@ -96,10 +102,12 @@ void UiThread::post_key(BoardHal::Button b)
     v = "down";
   }
 
-  strncpy(e.value, v, sizeof(e.value));
   e.topic[sizeof(e.topic) - 1] = '\0';
-  e.value[sizeof(e.value) - 1] = '\0';
 
+  if (!payloadpool::store(v, e.value)) {
+    LOGW(TAG, "Key event dropped: payload pool exhausted");
+    return;
+  }
   _eventBus.publishUi(e);
 }
 
@@ -108,10 +116,12 @@ void UiThread::post_key(BoardHal::Button b)
  */
 void UiThread::run()
 {
+  threadprof::attach(threadprof::Slot::Ui);
   LOGI(TAG, "Thread started");
 
   Display::getInstance().beginHardware();
-  _lastSettingsRevision = _settings.revision();
+  _settingsSub.interest = kAllSettingsGroups;
+  (void)_settings.subscribe(_settingsSub);
   const AppSettings s = _settings.getCopy();
   _runtimeStatus.setAwareWindow(timeutil::nowMs(), s.aware_timeout_s);
 
@@ -124,9 +134,12 @@ void UiThread::run()
   _statusMode = true;
   renderStatus();
 
-  while (true) {
-    // Wait for button activity or periodic wakeup.
-    (void)BoardHal::waitForButtonEvent(200);
+  while (!_stop.requested()) {
+    // Wait for button activity (IRQ) or the status refresh.
+    {
+      threadprof::Wait wait(threadprof::Slot::Ui);
+      (void)BoardHal::waitForButtonEvent(UI_IDLE_REFRESH_MS);
+    }
 
     BoardHal::Button b;
     while (BoardHal::popButton(b)) {
@@ -154,18 +167,20 @@ void UiThread::run()
     if (_statusMode) {
       renderStatus();
     } else if (menuReady) {
-      const uint32_t settingsRevision = _settings.revision();
-      if (settingsRevision != _lastSettingsRevision) {
-        _lastSettingsRevision = settingsRevision;
+      if (_settingsSub.consume() != 0u) {
         _menu.refresh();
       }
     }
   }
+
+  LOGI(TAG, "Thread stopped");
+  _stop.acknowledge();
 }
 
 void UiThread::stop()
 {
-  stoputil::terminateThread("UiThread", _thread);
+  _stop.request();
+  (void)stoputil::awaitStop("UiThread", _thread, _stop, THREAD_STOP_ACK_MS);
 }
 
 LcdMenu::Key UiThread::toMenuKey(BoardHal::Button b) const
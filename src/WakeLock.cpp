@@ -0,0 +1,44 @@
+#include "WakeLock.h"
+
+#include <mbed.h>
+#include <atomic>
+
+namespace wakelock {
+
+namespace {
+
+static std::atomic<uint16_t> g_count[kHolderCount];
+
+} // namespace
+
+void acquire(Holder holder)
+{
+  // The sleep manager keeps its own count; ours is only for diagnostics.
+  sleep_manager_lock_deep_sleep();
+  g_count[(uint8_t)holder].fetch_add(1);
+}
+
+void release(Holder holder)
+{
+  std::atomic<uint16_t>& c = g_count[(uint8_t)holder];
+  uint16_t cur = c.load();
+  while (cur > 0u) {
+    if (c.compare_exchange_weak(cur, (uint16_t)(cur - 1u))) {
+      sleep_manager_unlock_deep_sleep();
+      return;
+    }
+  }
+}
+
+uint8_t heldMask()
+{
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < kHolderCount; i++) {
+    if (g_count[i].load() > 0u) {
+      mask |= (uint8_t)(1u << i);
+    }
+  }
+  return mask;
+}
+
+} // namespace wakelock
@@ -5,6 +5,9 @@
 #include <Arduino_LowPowerPortentaH7.h>
 
 #include "AppConfig.h"
+#include "BootTimeline.h"
+#include "CrashLog.h"
+#include "EnergyLedger.h"
 #include "Logger.h"
 #include "Messages.h"
 #include "ConsoleCommands.h"
@@ -16,6 +19,7 @@
 #include "BoardHal.h"
 
 #include "SystemContext.h"
+#include "ThreadProfiler.h"
 
 #include "AggregatorThread.h"
 #include "CommsPump.h"
@@ -46,6 +50,9 @@ REDIRECT_STDOUT_TO(SerialUSB);
 void setup()
 {
 #if defined(CORE_CM7)
+  boottimeline::mark("setup");
+  threadprof::attach(threadprof::Slot::Main);
+
   if (!g_board.begin()) {
     while (1) {
     }
@@ -53,15 +60,36 @@ void setup()
 
   bootM4();
 
-  Display::getInstance().beginHardware();
-  Display::getInstance().showSplash(HASTIG_AI_REVISION);
+  // What did the previous run end with? A controlled hibernate allows the warm path.
+  restartReason.begin();
+  const WakeContext wake = restartReason.bootContext();
+  const bool        warm = restartReason.isWarmWake();
+  crashlog::begin(wake.reason, warm && (wake.flags & kWakeFlagCrashLogParked) != 0u);
+  boottimeline::mark("board");
+
+  if (!warm) {
+    // On a warm wake the UI thread brings the display up with the status screen.
+    Display::getInstance().beginHardware();
+    Display::getInstance().showSplash(HASTIG_AI_REVISION);
+    boottimeline::mark("display");
+  }
 
   Serial.begin(115200);
   Logger::begin(Serial, 115200);
-  delay(2500);
-  Logger::set_runtime_level(Logger::Level::Debug);
+  // Give a USB serial monitor a chance to attach; on battery nobody is listening.
+  if (!warm && g_board.isUSBPowered()) {
+    const uint32_t waitStart = millis();
+    while (!Serial && (uint32_t)(millis() - waitStart) < BOOT_SERIAL_WAIT_MS) {
+      delay(10);
+    }
+  }
+  boottimeline::mark("serial");
 
   LOGI(TAG, "=== Hastig-H7-1 Boot (AI Revision: %s) ===", HASTIG_AI_REVISION);
+  LOGI(TAG, "Restart reason: %s%s (wake #%lu)",
+       RestartReasonStore::name(wake.reason),
+       warm ? ", warm wake" : "",
+       (unsigned long)wake.wakeCount);
 
   sysCtx.powerManager.setOrchestrator(sysCtx.orchestrator);
 
@@ -73,21 +101,45 @@ void setup()
     sysCtx.settings.factoryReset();
     BoardHal::blinkDualLedFeedback();
   }
+  boottimeline::mark("buttons");
 
   sysCtx.settings.begin();
-
-  // Configure PMIC/charger based on settings.
-  BoardHal::configurePmicFromSettings(sysCtx.settings, g_battery, g_charger);
-
-  // Print current config at boot.
-  printSettingsToSerial(sysCtx.settings, Serial);
+  (void)Logger::setLevels(sysCtx.settings.getCopy().log_levels);
+  boottimeline::mark("settings");
+
+  // Configure PMIC/charger based on settings (before the modem draws current).
+  // The PMIC keeps its registers through standby, so a warm wake with
+  // unchanged settings can skip it.
+  if (!warm || wake.settingsDigest != sysCtx.settings.configDigest()) {
+    BoardHal::configurePmicFromSettings(sysCtx.settings, g_battery, g_charger);
+    boottimeline::mark("pmic");
+  }
 
   sysCtx.sessionClock.begin();
 
-  restartReason.begin();
   // Mark startup as unexpected reboot until we perform a controlled hibernate.
   restartReason.write(RestartReasonCode::UnexpectedReboot);
 
+  // Energy totals carry over; the hibernate itself is charged from the gauge's capacity drop.
+  energyledger::restore(wake.energyUah, wake.energyTrackedS);
+  if (warm && wake.capacityMah > 0u) {
+    const uint32_t nowMah  = g_battery.remainingCapacity();
+    const uint32_t usedUah = (wake.capacityMah > nowMah) ? (wake.capacityMah - nowMah) * 1000u : 0u;
+    energyledger::addCharge(energyledger::Bucket::Hibernating, usedUah, wake.sleepS);
+  }
+
+  sysCtx.commsPump.setRestartReason(RestartReasonStore::name(wake.reason));
+  if (warm && (wake.flags & kWakeFlagSampleOnWake) != 0u) {
+    // Scheduled session: sample first, attach the modem only for the upload.
+    const AppSettings s = sysCtx.settings.getCopy();
+    if (Orchestrator::scheduleEnabled(s)) {
+      sysCtx.commsPump.holdOffline(s.sensor_warmup_ms + s.sched_duration_s * 1000u);
+    }
+    sysCtx.orchestrator.startSamplingOnBoot();
+  }
+
+  // Threads first, so display/menu, sensor warmup and orchestrator start-up
+  // run while this (main) context performs the modem attach below.
   sysCtx.uiThread.start();
 
   sysCtx.commsPump.begin();
@@ -98,8 +150,23 @@ void setup()
 
   // Enable IRQ-based button detection (prepared for future changes).
   BoardHal::enableButtonIrq();
+  boottimeline::mark("threads");
+
+  // Print current config at boot.
+  printSettingsToSerial(sysCtx.settings, Serial);
+
+  // GSM must run in the main context; start the attach now instead of on the
+  // first loop(). Failure is fine, loopOnce() keeps retrying.
+  (void)sysCtx.commsPump.attachNetwork();
+
+  powerutil::setIdleDeepSleep(sysCtx.settings.getCopy().low_power_idle != 0u);
+  if (!g_board.isUSBPowered()) {
+    powerutil::enableIdleDeepSleep();
+  }
 
+  boottimeline::mark("ready");
   LOGI(TAG, "Startup complete");
+  boottimeline::log();
 #else
   LowPower.standbyM4();
 #endif
@@ -117,6 +184,7 @@ void loop()
   // Execute sleep transaction if requested by Orchestrator.
   sysCtx.powerManager.service();
 
-  // Keep loop responsive; other RTOS threads run independently.
-  rtos::ThisThread::sleep_for(std::chrono::milliseconds(20));
+  // Sleep until comms has something to do; other RTOS threads run independently.
+  threadprof::Wait wait(threadprof::Slot::Main);
+  rtos::ThisThread::sleep_for(std::chrono::milliseconds(sysCtx.commsPump.idleWaitMs()));
 }
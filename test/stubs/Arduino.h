@@ -0,0 +1,42 @@
+#pragma once
+
+// Host stand-in for the Arduino core (native test env only).
+
+#include <mbed.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+enum : int { D0 = 0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, D14 };
+
+class Stream {
+public:
+  virtual ~Stream() = default;
+};
+
+class String {
+public:
+  String() = default;
+  String(const char* s) : _s(s != nullptr ? s : "") {}
+  String& operator=(const char* s)
+  {
+    _s = (s != nullptr) ? s : "";
+    return *this;
+  }
+  String& operator+=(const char* s)
+  {
+    _s += s;
+    return *this;
+  }
+  const char* c_str() const { return _s.c_str(); }
+  unsigned    length() const { return (unsigned)_s.size(); }
+  bool        operator==(const char* s) const { return _s == s; }
+
+private:
+  std::string _s;
+};
+
+inline unsigned long millis()
+{
+  return (unsigned long)rtos::Kernel::Clock::nowMs;
+}
@@ -0,0 +1,117 @@
+// Definitions behind the host stand-ins (native test env only).
+
+#include <mbed.h>
+
+#include "Logger.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace mbed {
+
+FlashIAP::Counts FlashIAP::counts = {};
+
+namespace {
+
+uint8_t* g_flash = nullptr;
+
+uint8_t* mem(uint32_t addr)
+{
+  return g_flash + (addr - FlashIAP::kStart);
+}
+
+bool inRange(uint32_t addr, uint32_t size)
+{
+  return addr >= FlashIAP::kStart && size <= FlashIAP::kSize && (addr - FlashIAP::kStart) <= FlashIAP::kSize - size;
+}
+
+} // namespace
+
+int FlashIAP::init()
+{
+  if (g_flash == nullptr) {
+    void* p = mmap((void*)(uintptr_t)kStart, kSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != (void*)(uintptr_t)kStart) {
+      fprintf(stderr, "fake flash: cannot map at 0x%08lx\n", (unsigned long)kStart);
+      abort();
+    }
+    g_flash = (uint8_t*)p;
+    memset(g_flash, 0xFF, kSize);
+  }
+  return 0;
+}
+
+int FlashIAP::read(void* buffer, uint32_t addr, uint32_t size)
+{
+  if (!inRange(addr, size)) {
+    return -1;
+  }
+  counts.reads++;
+  memcpy(buffer, mem(addr), size);
+  return 0;
+}
+
+int FlashIAP::program(const void* buffer, uint32_t addr, uint32_t size)
+{
+  if (!inRange(addr, size) || (addr % kPageSize) != 0u || (size % kPageSize) != 0u) {
+    return -1;
+  }
+  counts.programs++;
+  counts.programBytes += size;
+  const uint8_t* src = (const uint8_t*)buffer;
+  uint8_t*       dst = mem(addr);
+  for (uint32_t i = 0; i < size; i++) {
+    dst[i] &= src[i];  // NOR: programming only clears bits
+  }
+  return 0;
+}
+
+int FlashIAP::erase(uint32_t addr, uint32_t size)
+{
+  if (!inRange(addr, size) || (addr % kSectorSize) != 0u || (size % kSectorSize) != 0u) {
+    return -1;
+  }
+  counts.erases++;
+  memset(mem(addr), 0xFF, size);
+  return 0;
+}
+
+void FlashIAP::wipe()
+{
+  FlashIAP f;
+  (void)f.init();
+  memset(g_flash, 0xFF, kSize);
+  counts = Counts{};
+}
+
+} // namespace mbed
+
+// Logger: everything is filtered out; level specs are checked by the real
+// parser only on the device.
+Logger::LevelTable   Logger::_tables[2] = {{Logger::Level::None, Logger::Level::None, Logger::Level::None, 0, {}},
+                                           {Logger::Level::None, Logger::Level::None, Logger::Level::None, 0, {}}};
+std::atomic<uint8_t> Logger::_active{0};
+
+Logger::Level Logger::tagLevel(const LevelTable& t, const char*)
+{
+  return t.global;
+}
+
+Logger::Record* Logger::claim(Level, const char*, const char*)
+{
+  return nullptr;
+}
+
+void Logger::publish(Record*) {}
+
+bool Logger::validLevels(const char* spec)
+{
+  return spec != nullptr;
+}
+
+uint32_t Logger::dropped()
+{
+  return 0u;
+}
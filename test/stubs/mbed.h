@@ -0,0 +1,104 @@
+#pragma once
+
+// Host stand-in for the parts of mbed-os the pure-logic units and the
+// settings/flash path use. Only for the native test env.
+
+#include <chrono>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  osPriorityIdle        = 1,
+  osPriorityLow         = 8,
+  osPriorityBelowNormal = 16,
+  osPriorityNormal      = 24,
+  osPriorityAboveNormal = 32,
+  osPriorityHigh        = 40,
+  osPriorityRealtime    = 48,
+} osPriority;
+
+namespace rtos {
+
+class Mutex {
+public:
+  void lock() { _m.lock(); }
+  void unlock() { _m.unlock(); }
+  bool trylock() { return _m.try_lock(); }
+
+private:
+  std::recursive_mutex _m;  // rtos::Mutex is recursive
+};
+
+class EventFlags {
+public:
+  uint32_t set(uint32_t flags) { return _flags |= flags; }
+  uint32_t clear(uint32_t flags = 0x7FFFFFFFu)
+  {
+    const uint32_t old = _flags;
+    _flags &= ~flags;
+    return old;
+  }
+  uint32_t get() const { return _flags; }
+
+private:
+  uint32_t _flags = 0;
+};
+
+namespace Kernel {
+struct Clock {
+  using duration   = std::chrono::milliseconds;
+  using rep        = duration::rep;
+  using period     = duration::period;
+  using time_point = std::chrono::time_point<Clock, duration>;
+  static constexpr bool is_steady = true;
+
+  /** @brief Test-controlled uptime. */
+  static time_point now() { return time_point(duration(nowMs)); }
+  static inline uint64_t nowMs = 0;
+};
+} // namespace Kernel
+
+} // namespace rtos
+
+namespace mbed {
+
+/**
+ * @brief RAM-backed FlashIAP with NOR semantics (program only clears bits)
+ * and per-call counters.
+ *
+ * The array is mapped at the STM32H7 flash address, because settings code
+ * reads the legacy blob straight through a pointer.
+ */
+class FlashIAP {
+public:
+  static constexpr uint32_t kStart      = 0x08000000u;
+  static constexpr uint32_t kSectorSize = 128u * 1024u;
+  static constexpr uint32_t kSize       = 8u * kSectorSize;
+  static constexpr uint32_t kPageSize   = 32u;
+
+  struct Counts {
+    uint32_t programs;      ///< program() calls (one per page)
+    uint32_t programBytes;
+    uint32_t erases;        ///< erase() calls
+    uint32_t reads;
+  };
+
+  int init();
+  int deinit() { return 0; }
+  int read(void* buffer, uint32_t addr, uint32_t size);
+  int program(const void* buffer, uint32_t addr, uint32_t size);
+  int erase(uint32_t addr, uint32_t size);
+
+  uint32_t get_page_size() const { return kPageSize; }
+  uint32_t get_sector_size(uint32_t) const { return kSectorSize; }
+  uint32_t get_flash_start() const { return kStart; }
+  uint32_t get_flash_size() const { return kSize; }
+  uint8_t  get_erase_value() const { return 0xFFu; }
+
+  /** @brief Whole array back to erased; counters to zero. */
+  static void   wipe();
+  static Counts counts;
+};
+
+} // namespace mbed
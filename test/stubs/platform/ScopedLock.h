@@ -0,0 +1,18 @@
+#pragma once
+
+namespace mbed {
+
+template <typename Lockable>
+class ScopedLock {
+public:
+  explicit ScopedLock(Lockable& l) : _l(l) { _l.lock(); }
+  ~ScopedLock() { _l.unlock(); }
+
+  ScopedLock(const ScopedLock&)            = delete;
+  ScopedLock& operator=(const ScopedLock&) = delete;
+
+private:
+  Lockable& _l;
+};
+
+} // namespace mbed
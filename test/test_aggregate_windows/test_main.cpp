@@ -0,0 +1,208 @@
+#include <unity.h>
+
+#include "AggregateAccumulator.h"
+
+#include <deque>
+#include <map>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+// Host test: the aggregator's window handling against sessions that stop at
+// random points. Samples travel through a FIFO like the sensor mailbox; at a
+// stop the flush takes what is queued, and the samples still in flight arrive
+// afterwards, either while aggregation is off or once the next session runs.
+
+namespace {
+
+struct Sim {
+  AggregateAssembler        windows;
+  std::deque<SensorSampleMsg> mail;
+  std::vector<AggregateMsg> out;
+
+  uint32_t session = 0;  ///< SessionClock's session number
+  uint32_t relMs   = 0;
+  std::map<uint32_t, uint32_t> produced;  ///< session -> samples
+
+  static void idFor(uint32_t session, char* buf, size_t len)
+  {
+    snprintf(buf, len, "srv-%lu", (unsigned long)session);
+  }
+
+  void startSession()
+  {
+    session++;
+    relMs = 0;
+  }
+
+  // AggregatorThread::noteSession()
+  void noteSession()
+  {
+    char id[sizeof(AggregateMsg::sessionId)];
+    idFor(session, id, sizeof(id));
+    windows.noteSession(session, id);
+  }
+
+  void produce()
+  {
+    SensorSampleMsg s;
+    memset(&s, 0, sizeof(s));
+    relMs += 1000u;
+    s.relMs   = relMs;
+    s.session = session;
+    strcpy(s.k0, "t");
+    s.v0 = (float)session;  // lets the test see which sessions an aggregate mixed
+    s.ok = true;
+    mail.push_back(s);
+    produced[session]++;
+  }
+
+  // AggregatorThread::take() for the oldest queued sample.
+  void takeOne()
+  {
+    AggregateMsg closed;
+    if (windows.add(mail.front(), closed)) {
+      TEST_ASSERT_TRUE(closed.partial);
+      out.push_back(closed);
+    }
+    mail.pop_front();
+  }
+
+  void drain()
+  {
+    while (!mail.empty()) {
+      takeOne();
+    }
+  }
+
+  // AggregatorThread::closeWindow()
+  void closeWindow(bool partial)
+  {
+    noteSession();
+    AggregateMsg a;
+    if (windows.close(partial, a)) {
+      TEST_ASSERT_EQUAL(partial, a.partial);
+      out.push_back(a);
+    }
+  }
+};
+
+void check(const Sim& sim)
+{
+  std::map<uint32_t, uint32_t> seen;
+  for (const AggregateMsg& a : sim.out) {
+    // One session per aggregate, stamped with that session's id.
+    TEST_ASSERT_EQUAL_FLOAT(a.v0_min, a.v0_max);
+    const uint32_t session = (uint32_t)a.v0_min;
+    char id[sizeof(AggregateMsg::sessionId)];
+    Sim::idFor(session, id, sizeof(id));
+    TEST_ASSERT_EQUAL_STRING(id, a.sessionId);
+    TEST_ASSERT_TRUE(a.rel_start_ms <= a.rel_end_ms);
+    seen[session] += a.n;
+  }
+  // Every sample in exactly one aggregate.
+  TEST_ASSERT_EQUAL(sim.produced.size(), seen.size());
+  for (const auto& p : sim.produced) {
+    TEST_ASSERT_EQUAL(p.second, seen[p.first]);
+  }
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_stragglers_keep_their_session()
+{
+  Sim sim;
+  sim.startSession();
+  sim.noteSession();
+  for (int i = 0; i < 5; i++) {
+    sim.produce();
+  }
+  sim.drain();
+
+  // Stop: one sample still in flight when the flush runs.
+  sim.closeWindow(true);
+  sim.produce();
+
+  // The next session starts before the straggler is taken.
+  sim.startSession();
+  sim.noteSession();
+  sim.produce();
+  sim.drain();
+  sim.closeWindow(false);
+
+  TEST_ASSERT_EQUAL(3, sim.out.size());
+  TEST_ASSERT_EQUAL(5, sim.out[0].n);
+  TEST_ASSERT_EQUAL_STRING("srv-1", sim.out[1].sessionId);
+  TEST_ASSERT_EQUAL(1, sim.out[1].n);
+  TEST_ASSERT_TRUE(sim.out[1].partial);
+  TEST_ASSERT_EQUAL_STRING("srv-2", sim.out[2].sessionId);
+  check(sim);
+}
+
+void test_random_stop_points()
+{
+  std::mt19937 rng(20260418u);
+  auto roll = [&rng](uint32_t n) { return (uint32_t)(rng() % n); };
+
+  Sim sim;
+  for (int round = 0; round < 500; round++) {
+    sim.startSession();
+
+    // Stragglers of the previous stop, taken while aggregation is still off
+    // (the disabled thread emits them at once) or with the new session running.
+    const bool enabledFirst = roll(2) == 0u;
+    if (!enabledFirst) {
+      sim.drain();
+      sim.closeWindow(true);
+    }
+
+    // Enabled: windows close at their period end, the stop comes at any sample.
+    sim.noteSession();
+    const uint32_t samples = roll(40);
+    for (uint32_t i = 0; i < samples; i++) {
+      sim.produce();
+      if (roll(3) == 0u) {
+        sim.takeOne();
+      }
+      if (roll(10) == 0u) {
+        sim.drain();
+        sim.closeWindow(false);
+        sim.noteSession();
+      }
+    }
+
+    // The thread keeps up with the sampler: only samples in flight at a
+    // stop reach it after the session has changed.
+    sim.drain();
+
+    if (roll(5) == 0u) {
+      // startSampling while sampling: no stop, the session just changes
+      // under the open window.
+      continue;
+    }
+
+    // Stop: the flush closes the window, up to two samples are in flight.
+    sim.closeWindow(true);
+    const uint32_t inFlight = roll(3);
+    for (uint32_t i = 0; i < inFlight; i++) {
+      sim.produce();
+    }
+  }
+  sim.drain();
+  sim.closeWindow(true);
+
+  check(sim);
+  TEST_ASSERT_EQUAL(0, sim.windows.pending());
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_stragglers_keep_their_session);
+  RUN_TEST(test_random_stop_points);
+  return UNITY_END();
+}
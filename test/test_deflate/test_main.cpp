@@ -0,0 +1,205 @@
+#include <unity.h>
+
+#include "Deflate.h"
+
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Host test: round trips through a small inflater for the one block type
+// compress() writes (final block, fixed Huffman tables, RFC 1951 3.2.6).
+
+namespace {
+
+static const uint16_t kLenBase[29]   = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                        31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t  kLenExtra[29]  = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                        2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t kDistBase[30]  = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                        33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t  kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+struct BitReader {
+  const uint8_t* p;
+  size_t         len;
+  size_t         bit = 0;
+  bool           bad = false;
+
+  uint32_t bits(uint8_t n)
+  {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < n; i++, bit++) {
+      if (bit / 8u >= len) {
+        bad = true;
+        return 0;
+      }
+      v |= (uint32_t)((p[bit / 8u] >> (bit % 8u)) & 1u) << i;
+    }
+    return v;
+  }
+
+  /** @brief Huffman codes are packed most significant bit first. */
+  uint32_t code(uint8_t n)
+  {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < n; i++) {
+      v = (v << 1) | bits(1);
+    }
+    return v;
+  }
+};
+
+/** @brief Fixed literal/length symbol; -1 on a bad code. */
+int symbol(BitReader& r)
+{
+  uint32_t c = r.code(7);
+  if (c <= 0x17u) {
+    return (int)(256u + c);
+  }
+  c = (c << 1) | r.code(1);
+  if (c >= 0x30u && c <= 0xBFu) {
+    return (int)(c - 0x30u);
+  }
+  if (c >= 0xC0u && c <= 0xC7u) {
+    return (int)(280u + c - 0xC0u);
+  }
+  c = (c << 1) | r.code(1);
+  if (c >= 0x190u && c <= 0x1FFu) {
+    return (int)(144u + c - 0x190u);
+  }
+  return -1;
+}
+
+bool inflate(const uint8_t* in, size_t len, std::vector<uint8_t>& out)
+{
+  BitReader r{in, len};
+  if (r.bits(1) != 1u || r.bits(2) != 1u) {
+    return false;
+  }
+  while (!r.bad) {
+    const int sym = symbol(r);
+    if (sym < 0 || sym > 285) {
+      return false;
+    }
+    if (sym < 256) {
+      out.push_back((uint8_t)sym);
+      continue;
+    }
+    if (sym == 256) {
+      return true;
+    }
+    const int      li   = sym - 257;
+    const uint32_t n    = kLenBase[li] + r.bits(kLenExtra[li]);
+    const uint32_t di   = r.code(5);
+    if (di >= 30u) {
+      return false;
+    }
+    const uint32_t dist = kDistBase[di] + r.bits(kDistExtra[di]);
+    if (dist > out.size()) {
+      return false;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+      out.push_back(out[out.size() - dist]);
+    }
+  }
+  return false;
+}
+
+std::string logText(size_t bytes)
+{
+  std::string s;
+  uint32_t    t = 1000;
+  while (s.size() < bytes) {
+    char line[96];
+    snprintf(line, sizeof(line), "[%lu] SENS: Produced sample t=%lu temp=%.2f hum=%.2f ok=1\n",
+             (unsigned long)t, (unsigned long)(t - 1000u), 20.0 + (t % 70u) / 10.0, 40.0 + (t % 13u));
+    s += line;
+    if (t % 7000u == 0u) {
+      s += "[" + std::to_string(t) + "] COMMS: Published aggregate to hastig/node-1/data\n";
+    }
+    t += 1000u;
+  }
+  s.resize(bytes);
+  return s;
+}
+
+void roundTrip(const uint8_t* in, size_t len, size_t* packedOut = nullptr)
+{
+  static uint8_t packed[deflate::kMaxInput + deflate::kMaxInput / 4u + 16u];
+  const size_t   n = deflate::compress(in, len, packed, sizeof(packed));
+  TEST_ASSERT_TRUE(n > 0u);
+
+  std::vector<uint8_t> back;
+  TEST_ASSERT_TRUE(inflate(packed, n, back));
+  TEST_ASSERT_EQUAL(len, back.size());
+  TEST_ASSERT_TRUE(len == 0u || memcmp(in, back.data(), len) == 0);
+  if (packedOut != nullptr) {
+    *packedOut = n;
+  }
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_log_text_round_trip_and_ratio()
+{
+  const std::string text = logText(4096);
+  size_t            n    = 0;
+  roundTrip((const uint8_t*)text.data(), text.size(), &n);
+  // Header comment: log text shrinks to about a third.
+  TEST_ASSERT_TRUE(n * 3u <= text.size());
+}
+
+void test_edge_inputs_round_trip()
+{
+  roundTrip((const uint8_t*)"", 0);
+  roundTrip((const uint8_t*)"a", 1);
+  roundTrip((const uint8_t*)"abcabcabcabcabcabc", 18);
+
+  // Long runs exercise distance 1 and the 258-byte length cap.
+  std::vector<uint8_t> run(2000, 'x');
+  roundTrip(run.data(), run.size());
+
+  // Incompressible input grows (9-bit literals) but must still decode.
+  std::mt19937         rng(48u);
+  std::vector<uint8_t> noise(deflate::kMaxInput);
+  for (uint8_t& b : noise) {
+    b = (uint8_t)rng();
+  }
+  roundTrip(noise.data(), noise.size());
+}
+
+void test_repeats_beyond_the_window_round_trip()
+{
+  // Repeats further back than the match window must not be referenced.
+  const std::string block = logText(5000);
+  const std::string text  = block + block + block.substr(0, 3000);
+  roundTrip((const uint8_t*)text.data(), text.size());
+}
+
+void test_limits()
+{
+  static uint8_t in[deflate::kMaxInput + 1u];
+  uint8_t        out[64];
+  TEST_ASSERT_EQUAL(0, deflate::compress(in, sizeof(in), out, sizeof(out)));
+
+  // Output that does not fit cap is reported as 0, never truncated.
+  const std::string text = logText(1024);
+  TEST_ASSERT_EQUAL(0, deflate::compress((const uint8_t*)text.data(), text.size(), out, sizeof(out)));
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_log_text_round_trip_and_ratio);
+  RUN_TEST(test_edge_inputs_round_trip);
+  RUN_TEST(test_repeats_beyond_the_window_round_trip);
+  RUN_TEST(test_limits);
+  return UNITY_END();
+}
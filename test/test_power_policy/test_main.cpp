@@ -0,0 +1,204 @@
+#include <unity.h>
+
+#include "PowerPolicy.h"
+
+#include <algorithm>
+#include <vector>
+
+// Host test: battery traces replayed through PowerPolicy::update(). Checks
+// that factors are always one of the quantised steps, that stepping up is
+// immediate and stepping down waits for consecutive lower targets, and that
+// the same trace always gives the same decisions.
+
+namespace {
+
+static constexpr float    kLowBattV = 2.8f;
+static constexpr uint32_t kSecMs    = 1000u;
+static constexpr uint32_t kMinMs    = 60u * kSecMs;
+static constexpr uint16_t kSteps[]  = {1000, 1250, 1500, 2000, 3000, 4000, 6000, 8000};
+
+PowerPolicy::Reading reading(uint32_t tMs, float soc, float currentMa = -30.0f, float minV = 3.3f)
+{
+  PowerPolicy::Reading r;
+  r.tMs            = tMs;
+  r.socPct         = soc;
+  r.currentMa      = currentMa;
+  r.minimumVoltage = minV;
+  return r;
+}
+
+bool isStep(uint16_t permille)
+{
+  for (uint16_t s : kSteps) {
+    if (s == permille) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t stepIndex(uint16_t permille)
+{
+  for (size_t i = 0; i < sizeof(kSteps) / sizeof(kSteps[0]); i++) {
+    if (kSteps[i] == permille) {
+      return i;
+    }
+  }
+  return 99u;
+}
+
+// A node on 30 mA average draining from 100 % to 5 % in ~2 days, then
+// charging back; one reading per 15 min with the gauge's 1 % granularity
+// and a little noise.
+std::vector<PowerPolicy::Reading> recordedTrace()
+{
+  std::vector<PowerPolicy::Reading> t;
+  uint32_t                          ms  = 0;
+  float                             soc = 100.0f;
+  for (int i = 0; soc > 5.0f; i++) {
+    const float noise = ((i % 5) == 2) ? 1.0f : 0.0f;
+    t.push_back(reading(ms, (float)(int)soc + noise));
+    soc -= 0.5f;
+    ms += 15u * kMinMs;
+  }
+  for (int i = 0; soc < 90.0f; i++) {
+    t.push_back(reading(ms, (float)(int)soc, 150.0f));
+    soc += 2.0f;
+    ms += 15u * kMinMs;
+  }
+  return t;
+}
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_full_battery_stays_nominal(void)
+{
+  PowerPolicy p;
+  for (uint32_t i = 0; i < 200u; i++) {
+    TEST_ASSERT_EQUAL_UINT16(PowerPolicy::kNominal, p.update(reading(i * 15u * kMinMs, 95.0f, -5.0f), kLowBattV));
+  }
+}
+
+void test_soc_maps_to_smallest_covering_step(void)
+{
+  // Without a trend (readings closer than the trend interval) the target is
+  // 8^((60 - soc) / 50), rounded up to a step.
+  static const struct {
+    float    soc;
+    uint16_t permille;
+  } kCases[] = {
+      {60.0f, 1000}, {55.0f, 1250}, {52.0f, 1500}, {45.0f, 2000}, {40.0f, 3000},
+      {30.0f, 4000}, {20.0f, 6000}, {15.0f, 8000}, {10.0f, 8000}, {0.0f, 8000},
+  };
+  for (const auto& c : kCases) {
+    PowerPolicy p;
+    TEST_ASSERT_EQUAL_UINT16(c.permille, p.update(reading(0u, c.soc), kLowBattV));
+  }
+}
+
+void test_noisy_gauge_does_not_thrash(void)
+{
+  // Readings a second apart: no trend forms, only SoC sets the target.
+  PowerPolicy p;
+  uint32_t    t = 0;
+
+  TEST_ASSERT_EQUAL_UINT16(3000u, p.update(reading(t += kSecMs, 40.0f), kLowBattV));
+
+  // 40 % wants 3000, 45 % wants 2000: alternating never relaxes.
+  for (int i = 0; i < 20; i++) {
+    TEST_ASSERT_EQUAL_UINT16(3000u, p.update(reading(t += kSecMs, (i & 1) ? 40.0f : 45.0f), kLowBattV));
+  }
+
+  // Three lower targets in a row: one step down, on the third.
+  TEST_ASSERT_EQUAL_UINT16(3000u, p.update(reading(t += kSecMs, 45.0f), kLowBattV));
+  TEST_ASSERT_EQUAL_UINT16(3000u, p.update(reading(t += kSecMs, 45.0f), kLowBattV));
+  TEST_ASSERT_EQUAL_UINT16(2000u, p.update(reading(t += kSecMs, 45.0f), kLowBattV));
+
+  // A much lower target still relaxes one step per kRelaxUpdates.
+  const uint16_t expect[] = {2000, 2000, 1500, 1500, 1500, 1250, 1250, 1250, 1000, 1000};
+  for (uint16_t e : expect) {
+    TEST_ASSERT_EQUAL_UINT16(e, p.update(reading(t += kSecMs, 80.0f), kLowBattV));
+  }
+
+  // Stepping up skips straight to the target.
+  TEST_ASSERT_EQUAL_UINT16(6000u, p.update(reading(t += kSecMs, 20.0f), kLowBattV));
+}
+
+void test_voltage_sag_is_immediate_max(void)
+{
+  PowerPolicy p;
+  TEST_ASSERT_EQUAL_UINT16(1000u, p.update(reading(0u, 90.0f), kLowBattV));
+  TEST_ASSERT_EQUAL_UINT16(8000u, p.update(reading(kMinMs, 90.0f, -30.0f, kLowBattV + 0.05f), kLowBattV));
+  TEST_ASSERT_EQUAL_UINT16(8000u, p.update(reading(2u * kMinMs, 90.0f), kLowBattV));  // relaxes slowly
+}
+
+void test_recorded_trace_replay(void)
+{
+  const std::vector<PowerPolicy::Reading> trace = recordedTrace();
+
+  PowerPolicy           p;
+  std::vector<uint16_t> out;
+  size_t                relaxRun = 0;
+  uint16_t              prev     = PowerPolicy::kNominal;
+  for (const PowerPolicy::Reading& r : trace) {
+    const uint16_t f = p.update(r, kLowBattV);
+    out.push_back(f);
+    TEST_ASSERT_TRUE(isStep(f));
+
+    if (f < prev) {
+      // Down by exactly one step, and not sooner than kRelaxUpdates readings.
+      TEST_ASSERT_EQUAL_UINT32(stepIndex(prev) - 1u, stepIndex(f));
+      TEST_ASSERT_GREATER_OR_EQUAL(3u, relaxRun + 1u);
+      relaxRun = 0;
+    } else {
+      relaxRun = (f == prev) ? relaxRun + 1u : 0u;
+    }
+    prev = f;
+  }
+
+  // The drain trend stretches before SoC alone would: at 90 % the SoC
+  // target is nominal, but at -2 %/h the floor is inside kHorizonH.
+  for (size_t i = 0; i < trace.size(); i++) {
+    if (trace[i].currentMa < 0.0f && trace[i].socPct <= 90.0f) {
+      TEST_ASSERT_GREATER_THAN(1000u, out[i]);
+      break;
+    }
+  }
+  TEST_ASSERT_TRUE(p.socPerHour() > 0.0f);  // ends charging
+  TEST_ASSERT_EQUAL_UINT16(8000u, *std::max_element(out.begin(), out.end()));
+  TEST_ASSERT_EQUAL_UINT16(1000u, out.back());  // recharged to 90 %
+
+  // Deterministic: a second replay gives the same decisions.
+  PowerPolicy again;
+  for (size_t i = 0; i < trace.size(); i++) {
+    TEST_ASSERT_EQUAL_UINT16(out[i], again.update(trace[i], kLowBattV));
+  }
+
+  // reset() forgets trend and step.
+  p.reset();
+  TEST_ASSERT_EQUAL_UINT16(PowerPolicy::kNominal, p.stretchPermille());
+  TEST_ASSERT_TRUE(p.socPerHour() == 0.0f);
+}
+
+void test_scale_rounds_and_saturates(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(15000u, PowerPolicy::scale(15000u, 1000u));
+  TEST_ASSERT_EQUAL_UINT32(18750u, PowerPolicy::scale(15000u, 1250u));
+  TEST_ASSERT_EQUAL_UINT32(2u, PowerPolicy::scale(1u, 1500u));  // 1.5 rounds up
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, PowerPolicy::scale(0xF0000000u, 8000u));
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_full_battery_stays_nominal);
+  RUN_TEST(test_soc_maps_to_smallest_covering_step);
+  RUN_TEST(test_noisy_gauge_does_not_thrash);
+  RUN_TEST(test_voltage_sag_is_immediate_max);
+  RUN_TEST(test_recorded_trace_replay);
+  RUN_TEST(test_scale_rounds_and_saturates);
+  return UNITY_END();
+}
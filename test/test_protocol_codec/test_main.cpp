@@ -0,0 +1,87 @@
+#include <unity.h>
+
+#include "ProtocolCodec.h"
+
+#include <string.h>
+
+// Host test: every kCmd* string decodes to its Command::Type, and near
+// misses (prefixes, extra characters, wrong case) do not.
+
+using protocol::Command;
+
+namespace {
+
+struct Expect {
+  const char*   name;
+  Command::Type type;
+};
+
+static const Expect kAll[] = {
+    {protocol::kCmdKeepSampling, Command::Type::keepSampling},
+    {protocol::kCmdStartSampling, Command::Type::startSampling},
+    {protocol::kCmdStopSampling, Command::Type::stopSampling},
+    {protocol::kCmdGetConfig, Command::Type::getConfig},
+    {protocol::kCmdHibernate, Command::Type::hibernate},
+    {protocol::kCmdNudge, Command::Type::nudge},
+    {protocol::kCmdResetBatteryStatistics, Command::Type::resetBatteryStatistics},
+    {protocol::kCmdFactoryReset, Command::Type::factoryReset},
+};
+
+Command::Type decode(const char* s)
+{
+  return protocol::decodeType(s, strlen(s));
+}
+
+} // namespace
+
+void setUp() {}
+void tearDown() {}
+
+void test_every_command_decodes()
+{
+  for (const Expect& e : kAll) {
+    TEST_ASSERT_EQUAL((int)e.type, (int)decode(e.name));
+  }
+}
+
+void test_near_misses_are_unknown()
+{
+  char buf[64];
+  for (const Expect& e : kAll) {
+    const size_t n = strlen(e.name);
+
+    TEST_ASSERT_EQUAL((int)Command::Type::unknown, (int)protocol::decodeType(e.name, n - 1u));
+
+    memcpy(buf, e.name, n);
+    buf[n]     = 'x';
+    buf[n + 1] = '\0';
+    TEST_ASSERT_EQUAL((int)Command::Type::unknown, (int)decode(buf));
+
+    memcpy(buf, e.name, n + 1u);
+    buf[0] = (char)(buf[0] - 'a' + 'A');
+    TEST_ASSERT_EQUAL((int)Command::Type::unknown, (int)decode(buf));
+  }
+  TEST_ASSERT_EQUAL((int)Command::Type::unknown, (int)decode(""));
+  TEST_ASSERT_EQUAL((int)Command::Type::unknown, (int)protocol::decodeType(nullptr, 0));
+}
+
+void test_decode_command_payload()
+{
+  static const char kJson[] = "{\"type\":\"startSampling\",\"samplingInterval\":5000,\"sessionID\":\"abc\"}";
+  Command cmd;
+  TEST_ASSERT_TRUE(protocol::decodeCommand((const uint8_t*)kJson, strlen(kJson), cmd));
+  TEST_ASSERT_EQUAL((int)Command::Type::startSampling, (int)cmd.type);
+  TEST_ASSERT_TRUE(cmd.hasSamplingInterval);
+  TEST_ASSERT_EQUAL(5000, cmd.samplingInterval);
+  TEST_ASSERT_TRUE(cmd.hasSessionId);
+  TEST_ASSERT_EQUAL_STRING("abc", cmd.sessionId);
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_every_command_decodes);
+  RUN_TEST(test_near_misses_are_unknown);
+  RUN_TEST(test_decode_command_payload);
+  return UNITY_END();
+}
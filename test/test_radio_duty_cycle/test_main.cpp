@@ -0,0 +1,307 @@
+#include <unity.h>
+
+#include "AggregateDrain.h"
+#include "RadioDutyCycle.h"
+
+#include <deque>
+#include <vector>
+
+// Host test: a fake modem driven the way CommsPump::loopOnce() drives the
+// real one. The radio is awake exactly while a window is open; queued
+// aggregates go out through AggregateDrain, the unit CommsPump uses, so only
+// while the radio is awake and the link is up.
+
+namespace {
+
+static constexpr uint32_t kPeriodMs = 15u * 60u * 1000u;
+static constexpr uint32_t kWindowMs = 10000u;
+static constexpr uint32_t kTickMs   = 100u;
+
+struct FakeModem : AggregateDrain::Port {
+  bool                       awake    = false;
+  bool                       link     = true;  ///< attach/MQTT succeed when awake
+  uint32_t                   failNext = 0;     ///< publishes that fail (socket stall)
+  uint32_t                   nowMs    = 0;
+  std::vector<uint32_t>      wakes;            ///< sleep -> awake transitions
+  std::vector<uint32_t>      sleeps;           ///< awake -> sleep transitions
+  std::vector<uint32_t>      published;        ///< publish times
+  std::vector<uint32_t>      order;            ///< AggregateMsg::n of what went out
+  std::deque<AggregateMsg*>  mail;
+  uint32_t                   freed = 0;
+
+  ~FakeModem() override
+  {
+    for (AggregateMsg* a : mail) {
+      delete a;
+    }
+  }
+
+  void setAwake(bool on, uint32_t t)
+  {
+    if (on == awake) {
+      return;
+    }
+    awake = on;
+    (on ? wakes : sleeps).push_back(t);
+  }
+
+  void queue(uint32_t n)
+  {
+    AggregateMsg* a = new AggregateMsg();
+    a->n            = n;
+    mail.push_back(a);
+  }
+
+  AggregateMsg* take() override
+  {
+    if (mail.empty()) {
+      return nullptr;
+    }
+    AggregateMsg* a = mail.front();
+    mail.pop_front();
+    return a;
+  }
+
+  void release(AggregateMsg* a) override
+  {
+    delete a;
+    freed++;
+  }
+
+  bool linkUp() override { return awake && link; }
+
+  bool publish(const AggregateMsg& a) override
+  {
+    if (failNext > 0u) {
+      failNext--;
+      return false;
+    }
+    published.push_back(nowMs);
+    order.push_back(a.n);
+    return true;
+  }
+};
+
+// One pump pass.
+void pump(RadioDutyCycle& duty, AggregateDrain& drain, FakeModem& modem, uint32_t nowMs)
+{
+  const bool open = duty.isWindowOpen(nowMs);
+  modem.setAwake(open, nowMs);
+  if (!open) {
+    return;
+  }
+  modem.nowMs = nowMs;
+  (void)drain.run(modem, 4u);
+}
+
+bool inWindow(uint32_t anchorMs, uint32_t tMs)
+{
+  return ((tMs - anchorMs) % kPeriodMs) < kWindowMs;
+}
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_unanchored_or_disabled_is_always_open(void)
+{
+  RadioDutyCycle duty;
+  duty.configure(true, kPeriodMs, kWindowMs);
+  TEST_ASSERT_TRUE(duty.isWindowOpen(123456u));  // no connect yet
+
+  RadioDutyCycle off;
+  off.configure(false, kPeriodMs, kWindowMs);
+  off.anchor(0u);
+  TEST_ASSERT_TRUE(off.isWindowOpen(kWindowMs + 1u));
+  TEST_ASSERT_EQUAL_UINT16(60u, off.keepAliveS(60u));
+}
+
+void test_wakes_align_to_anchor(void)
+{
+  RadioDutyCycle duty;
+  AggregateDrain drain;
+  FakeModem      modem;
+  duty.configure(true, kPeriodMs, kWindowMs);
+
+  const uint32_t anchorMs = 5000u;
+  duty.anchor(anchorMs);
+
+  const uint32_t endMs = anchorMs + 4u * kPeriodMs;
+  for (uint32_t t = anchorMs; t < endMs; t += kTickMs) {
+    pump(duty, drain, modem, t);
+  }
+
+  // First pass finds the window open; then one wake per period, on the dot.
+  TEST_ASSERT_EQUAL_size_t(4u, modem.wakes.size());
+  TEST_ASSERT_EQUAL_size_t(4u, modem.sleeps.size());
+  for (size_t k = 0; k < modem.wakes.size(); k++) {
+    TEST_ASSERT_EQUAL_UINT32(anchorMs + k * kPeriodMs, modem.wakes[k]);
+    TEST_ASSERT_EQUAL_UINT32(anchorMs + k * kPeriodMs + kWindowMs, modem.sleeps[k]);
+  }
+}
+
+void test_next_window_lands_on_wake(void)
+{
+  RadioDutyCycle duty;
+  duty.configure(true, kPeriodMs, kWindowMs);
+  duty.anchor(0u);
+
+  TEST_ASSERT_EQUAL_UINT32(0u, duty.msUntilNextWindow(kWindowMs - 1u));
+  for (uint32_t t = kWindowMs; t < 3u * kPeriodMs; t += 7919u) {
+    const uint32_t wait = duty.msUntilNextWindow(t);
+    if (wait == 0u) {
+      TEST_ASSERT_TRUE(duty.isWindowOpen(t));
+      continue;
+    }
+    TEST_ASSERT_FALSE(duty.isWindowOpen(t + wait - 1u));
+    TEST_ASSERT_TRUE(duty.isWindowOpen(t + wait));
+    TEST_ASSERT_EQUAL_UINT32(0u, (t + wait) % kPeriodMs);
+  }
+}
+
+void test_data_leaves_only_in_windows(void)
+{
+  RadioDutyCycle duty;
+  AggregateDrain drain;
+  FakeModem      modem;
+  duty.configure(true, kPeriodMs, kWindowMs);
+
+  const uint32_t anchorMs = 0u;
+  duty.anchor(anchorMs);
+
+  uint32_t produced = 0;
+  for (uint32_t t = anchorMs; t < anchorMs + 3u * kPeriodMs; t += kTickMs) {
+    if (t % 60000u == 30000u) {  // one aggregate a minute, off the window edge
+      modem.queue(++produced);
+    }
+    pump(duty, drain, modem, t);
+  }
+  // The next window flushes the rest, a few per pass.
+  for (uint32_t t = anchorMs + 3u * kPeriodMs; t < anchorMs + 3u * kPeriodMs + kWindowMs; t += kTickMs) {
+    pump(duty, drain, modem, t);
+  }
+
+  TEST_ASSERT_EQUAL_size_t(0u, modem.mail.size());
+  TEST_ASSERT_EQUAL_size_t(produced, modem.published.size());
+  for (uint32_t t : modem.published) {
+    TEST_ASSERT_TRUE(inWindow(anchorMs, t));
+  }
+}
+
+void test_urgent_window_keeps_schedule(void)
+{
+  RadioDutyCycle duty;
+  AggregateDrain drain;
+  FakeModem      modem;
+  duty.configure(true, kPeriodMs, kWindowMs);
+  duty.anchor(0u);
+
+  const uint32_t urgentMs = kPeriodMs / 2u;
+  for (uint32_t t = 0u; t < 2u * kPeriodMs; t += kTickMs) {
+    if (t == urgentMs) {
+      duty.openNow(t);
+    }
+    pump(duty, drain, modem, t);
+  }
+
+  TEST_ASSERT_EQUAL_size_t(3u, modem.wakes.size());
+  TEST_ASSERT_EQUAL_UINT32(0u, modem.wakes[0]);
+  TEST_ASSERT_EQUAL_UINT32(urgentMs, modem.wakes[1]);
+  TEST_ASSERT_EQUAL_UINT32(urgentMs + kWindowMs, modem.sleeps[1]);
+  TEST_ASSERT_EQUAL_UINT32(kPeriodMs, modem.wakes[2]);  // schedule not shifted
+}
+
+void test_link_down_keeps_backlog(void)
+{
+  RadioDutyCycle duty;
+  AggregateDrain drain;
+  FakeModem      modem;
+  duty.configure(true, kPeriodMs, kWindowMs);
+  duty.anchor(0u);
+
+  modem.queue(1u);
+  modem.queue(2u);
+  modem.queue(3u);
+  modem.link = false;
+  for (uint32_t t = 0u; t < kPeriodMs; t += kTickMs) {
+    pump(duty, drain, modem, t);
+  }
+  TEST_ASSERT_EQUAL_size_t(3u, modem.mail.size());
+  TEST_ASSERT_EQUAL_size_t(0u, modem.published.size());
+
+  modem.link = true;
+  pump(duty, drain, modem, kPeriodMs);
+  TEST_ASSERT_EQUAL_size_t(0u, modem.mail.size());
+  TEST_ASSERT_EQUAL_size_t(3u, modem.published.size());
+}
+
+void test_failed_publish_keeps_aggregate(void)
+{
+  RadioDutyCycle duty;
+  AggregateDrain drain;
+  FakeModem      modem;
+  duty.configure(true, kPeriodMs, kWindowMs);
+  duty.anchor(0u);
+
+  modem.queue(1u);
+  modem.queue(2u);
+  modem.queue(3u);
+  modem.failNext = 2u;  // a stalled socket on a live link
+
+  pump(duty, drain, modem, 0u);
+  TEST_ASSERT_TRUE(drain.holding());
+  TEST_ASSERT_EQUAL_size_t(0u, modem.published.size());
+  TEST_ASSERT_EQUAL_UINT32(0u, modem.freed);
+
+  // Window closes before the retry succeeds: still held, nothing lost.
+  pump(duty, drain, modem, kTickMs);
+  TEST_ASSERT_TRUE(drain.holding());
+  pump(duty, drain, modem, kWindowMs);
+  TEST_ASSERT_TRUE(drain.holding());
+  TEST_ASSERT_EQUAL_size_t(0u, modem.published.size());
+
+  pump(duty, drain, modem, kPeriodMs);
+  TEST_ASSERT_FALSE(drain.holding());
+  TEST_ASSERT_EQUAL_size_t(3u, modem.order.size());
+  TEST_ASSERT_EQUAL_UINT32(1u, modem.order[0]);
+  TEST_ASSERT_EQUAL_UINT32(2u, modem.order[1]);
+  TEST_ASSERT_EQUAL_UINT32(3u, modem.order[2]);
+  TEST_ASSERT_EQUAL_UINT32(3u, modem.freed);
+}
+
+void test_pass_is_capped(void)
+{
+  AggregateDrain drain;
+  FakeModem      modem;
+  modem.awake = true;
+  for (uint32_t i = 1u; i <= 6u; i++) {
+    modem.queue(i);
+  }
+  TEST_ASSERT_EQUAL_UINT8(4u, drain.run(modem, 4u));
+  TEST_ASSERT_EQUAL_UINT8(2u, drain.run(modem, 4u));
+  TEST_ASSERT_EQUAL_UINT8(0u, drain.run(modem, 4u));
+}
+
+void test_keepalive_spans_sleep(void)
+{
+  RadioDutyCycle duty;
+  duty.configure(true, kPeriodMs, kWindowMs);
+  TEST_ASSERT_GREATER_OR_EQUAL(kPeriodMs / 1000u, duty.keepAliveS(60u));
+  TEST_ASSERT_EQUAL_UINT16(1350u, duty.keepAliveS(60u));
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_unanchored_or_disabled_is_always_open);
+  RUN_TEST(test_wakes_align_to_anchor);
+  RUN_TEST(test_next_window_lands_on_wake);
+  RUN_TEST(test_data_leaves_only_in_windows);
+  RUN_TEST(test_urgent_window_keeps_schedule);
+  RUN_TEST(test_link_down_keeps_backlog);
+  RUN_TEST(test_failed_publish_keeps_aggregate);
+  RUN_TEST(test_pass_is_capped);
+  RUN_TEST(test_keepalive_spans_sleep);
+  return UNITY_END();
+}
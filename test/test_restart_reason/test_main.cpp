@@ -0,0 +1,126 @@
+#include <unity.h>
+
+#include "RestartReason.h"
+
+// Host test: RestartReasonStore on its simulated backup registers (the
+// non-STM32H7 backend). A "reboot" is a fresh store whose begin() reads
+// what the previous one left behind.
+
+namespace {
+
+WakeContext reboot(RestartReasonStore& store)
+{
+  store = RestartReasonStore();
+  store.begin();
+  return store.bootContext();
+}
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Must run first: the registers start zeroed, like after a battery swap.
+void test_power_on_reads_as_cold(void)
+{
+  RestartReasonStore store;
+  const WakeContext  ctx = reboot(store);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)RestartReasonCode::PowerOn, (uint32_t)ctx.reason);
+  TEST_ASSERT_EQUAL_UINT32(0u, ctx.wakeCount);
+  TEST_ASSERT_FALSE(store.isWarmWake());
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)RestartReasonCode::PowerOn, (uint32_t)store.read());
+}
+
+void test_context_survives_hibernate(void)
+{
+  RestartReasonStore store;
+  store.begin();
+
+  WakeContext out;
+  out.reason          = RestartReasonCode::LowPowerWakeup;
+  out.sleepS          = 3600u;
+  out.wakeCount       = 7u;
+  out.settingsDigest  = 0xCAFEF00Du;
+  out.flags           = kWakeFlagSampleOnWake;
+  for (size_t i = 0; i < WakeContext::kEnergyBuckets; i++) {
+    out.energyUah[i] = 1000u * (uint32_t)(i + 1u);
+  }
+  out.energyTrackedS = 86400u;
+  out.capacityMah    = 1800u;
+  store.writeContext(out);
+
+  const WakeContext in = reboot(store);
+  TEST_ASSERT_TRUE(store.isWarmWake());
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)out.reason, (uint32_t)in.reason);
+  TEST_ASSERT_EQUAL_UINT32(out.sleepS, in.sleepS);
+  TEST_ASSERT_EQUAL_UINT32(out.wakeCount, in.wakeCount);
+  TEST_ASSERT_EQUAL_UINT32(out.settingsDigest, in.settingsDigest);
+  TEST_ASSERT_EQUAL_UINT32(out.flags, in.flags);
+  TEST_ASSERT_EQUAL_MEMORY(out.energyUah, in.energyUah, sizeof(out.energyUah));
+  TEST_ASSERT_EQUAL_UINT32(out.energyTrackedS, in.energyTrackedS);
+  TEST_ASSERT_EQUAL_UINT32(out.capacityMah, in.capacityMah);
+}
+
+void test_write_reason_keeps_context(void)
+{
+  RestartReasonStore store;
+  store.begin();
+
+  WakeContext out;
+  out.reason          = RestartReasonCode::Forced;
+  out.settingsDigest  = 0xABCDu;
+  out.wakeCount       = 3u;
+  store.writeContext(out);
+
+  // main() marks a running system so a crash is not mistaken for a wake.
+  store.write(RestartReasonCode::UnexpectedReboot);
+  TEST_ASSERT_EQUAL_UINT32((uint32_t)RestartReasonCode::UnexpectedReboot, (uint32_t)store.read());
+
+  const WakeContext in = reboot(store);
+  TEST_ASSERT_FALSE(store.isWarmWake());
+  TEST_ASSERT_EQUAL_UINT32(0xABCDu, in.settingsDigest);
+  TEST_ASSERT_EQUAL_UINT32(3u, in.wakeCount);
+}
+
+void test_warm_reasons(void)
+{
+  static const struct {
+    RestartReasonCode code;
+    bool              warm;
+  } kCases[] = {
+      {RestartReasonCode::UnexpectedReboot, false},
+      {RestartReasonCode::LowPowerWakeup, true},
+      {RestartReasonCode::NoNetwork, true},
+      {RestartReasonCode::Forced, true},
+      {RestartReasonCode::EmergencyPowerSave, true},
+      {RestartReasonCode::BrownOut, false},
+      {RestartReasonCode::PowerOn, false},
+  };
+
+  RestartReasonStore store;
+  store.begin();
+  for (const auto& c : kCases) {
+    store.write(c.code);
+    (void)reboot(store);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)c.code, (uint32_t)store.bootContext().reason);
+    TEST_ASSERT_EQUAL(c.warm, store.isWarmWake());
+  }
+}
+
+void test_names(void)
+{
+  TEST_ASSERT_EQUAL_STRING("lowPowerWakeup", RestartReasonStore::name(RestartReasonCode::LowPowerWakeup));
+  TEST_ASSERT_EQUAL_STRING("brownOut", RestartReasonStore::name(RestartReasonCode::BrownOut));
+  TEST_ASSERT_EQUAL_STRING("powerOn", RestartReasonStore::name((RestartReasonCode)99u));
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_power_on_reads_as_cold);
+  RUN_TEST(test_context_survives_hibernate);
+  RUN_TEST(test_write_reason_keeps_context);
+  RUN_TEST(test_warm_reasons);
+  RUN_TEST(test_names);
+  return UNITY_END();
+}
@@ -0,0 +1,139 @@
+#include <unity.h>
+
+#include "RetainedLog.h"
+
+#include <string.h>
+#include <string>
+
+// Host test: a static buffer stands in for the no-init RAM region. A reset
+// is simulated by attaching a second RetainedLog to the same buffer, the way
+// the device attaches to what the previous run left behind.
+
+namespace {
+
+static constexpr size_t kText = 256; // power of two, like CRASHLOG_RAM_BYTES
+
+alignas(32) static uint8_t g_region[sizeof(RetainedLog::Header) + kText];
+
+void appendLine(RetainedLog& log, const std::string& s)
+{
+  log.append(s.data(), s.size());
+  log.append("\n", 1u);
+}
+
+std::string excerpt(const RetainedLog& log, size_t max)
+{
+  char         buf[kText];
+  const size_t n = log.excerpt(buf, max);
+  return std::string(buf, n);
+}
+
+} // namespace
+
+void setUp()
+{
+  // Power-on: whatever the RAM happens to hold.
+  memset(g_region, 0xA5, sizeof(g_region));
+}
+
+void tearDown() {}
+
+void test_power_on_formats()
+{
+  RetainedLog log(g_region, sizeof(g_region));
+  TEST_ASSERT_FALSE(log.attach());
+  TEST_ASSERT_EQUAL(0, log.used());
+  TEST_ASSERT_EQUAL(0, log.boots());
+}
+
+void test_text_survives_reset()
+{
+  {
+    RetainedLog before(g_region, sizeof(g_region));
+    TEST_ASSERT_FALSE(before.attach());
+    appendLine(before, "boot");
+    appendLine(before, "watchdog about to bite");
+  }
+
+  RetainedLog after(g_region, sizeof(g_region));
+  TEST_ASSERT_TRUE(after.attach());
+  TEST_ASSERT_EQUAL(1, after.boots());
+  TEST_ASSERT_EQUAL_STRING("boot\nwatchdog about to bite\n", excerpt(after, kText).c_str());
+
+  // An excerpt shorter than the text starts on a line boundary.
+  TEST_ASSERT_EQUAL_STRING("watchdog about to bite\n", excerpt(after, 25).c_str());
+
+  // A reset before anything new was logged still keeps the ring.
+  RetainedLog again(g_region, sizeof(g_region));
+  TEST_ASSERT_TRUE(again.attach());
+  TEST_ASSERT_EQUAL(2, again.boots());
+}
+
+void test_wrapped_ring_keeps_newest_lines()
+{
+  RetainedLog before(g_region, sizeof(g_region));
+  (void)before.attach();
+  std::string all;
+  for (int i = 0; i < 100; i++) {
+    const std::string line = "line " + std::to_string(i);
+    appendLine(before, line);
+    all += line + "\n";
+  }
+  TEST_ASSERT_EQUAL(kText, before.used());
+
+  RetainedLog after(g_region, sizeof(g_region));
+  TEST_ASSERT_TRUE(after.attach());
+  const std::string got = excerpt(after, kText);
+  TEST_ASSERT_TRUE(got.size() < kText);
+  TEST_ASSERT_TRUE(got.rfind("line ", 0) == 0);
+  TEST_ASSERT_EQUAL_STRING(all.substr(all.size() - got.size()).c_str(), got.c_str());
+}
+
+void test_scrambled_header_formats()
+{
+  RetainedLog before(g_region, sizeof(g_region));
+  (void)before.attach();
+  appendLine(before, "lost in standby");
+
+  // Standby or power loss: the header no longer checks out.
+  RetainedLog::Header* hdr = (RetainedLog::Header*)g_region;
+  hdr->check ^= 0x10u;
+
+  RetainedLog after(g_region, sizeof(g_region));
+  TEST_ASSERT_FALSE(after.attach());
+  TEST_ASSERT_EQUAL(0, after.used());
+
+  // A region formatted for another capacity is not taken over either.
+  RetainedLog smaller(g_region, sizeof(g_region) - 64u);
+  TEST_ASSERT_FALSE(smaller.attach());
+}
+
+void test_last_write_covers_appended_bytes()
+{
+  RetainedLog log(g_region, sizeof(g_region));
+  (void)log.attach();
+  std::string fill(kText - 4u, 'x');
+  log.append(fill.data(), fill.size());
+
+  size_t      len = 0;
+  const void* at  = log.lastWrite(len);
+  TEST_ASSERT_TRUE(at == g_region + sizeof(RetainedLog::Header));
+  TEST_ASSERT_EQUAL(fill.size(), len);
+
+  // Wrapping append: the whole text area is reported.
+  log.append("0123456789", 10u);
+  at = log.lastWrite(len);
+  TEST_ASSERT_TRUE(at == g_region + sizeof(RetainedLog::Header));
+  TEST_ASSERT_EQUAL(kText, len);
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_power_on_formats);
+  RUN_TEST(test_text_survives_reset);
+  RUN_TEST(test_wrapped_ring_keeps_newest_lines);
+  RUN_TEST(test_scrambled_header_formats);
+  RUN_TEST(test_last_write_covers_appended_bytes);
+  return UNITY_END();
+}
@@ -0,0 +1,167 @@
+#include <unity.h>
+
+#include "SettingsManager.h"
+
+#include <mbed.h>
+#include <stdio.h>
+
+// Host test: SettingsManager + SettingsJournal on a RAM-backed FlashIAP
+// (test/stubs), counting the flash operations a realistic command trace
+// costs. Only patches that change a value may reach flash.
+
+namespace {
+
+using Flash = mbed::FlashIAP;
+
+// One record: header + AppSettings, rounded up to whole pages.
+uint32_t recordStride()
+{
+  const uint32_t raw = 16u + (uint32_t)sizeof(AppSettings);
+  return ((raw + Flash::kPageSize - 1u) / Flash::kPageSize) * Flash::kPageSize;
+}
+
+uint32_t writes()
+{
+  return Flash::counts.programs / (recordStride() / Flash::kPageSize);
+}
+
+} // namespace
+
+void setUp(void)
+{
+  Flash::wipe();
+}
+
+void tearDown(void) {}
+
+void test_first_boot_writes_defaults_once(void)
+{
+  SettingsManager s;
+  s.begin();
+  TEST_ASSERT_EQUAL_UINT32(1u, writes());
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.erases);
+
+  // Next boot finds the record and writes nothing.
+  Flash::counts = Flash::Counts{};
+  SettingsManager again;
+  again.begin();
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.programs);
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.erases);
+}
+
+void test_session_trace_costs_one_write_per_real_change(void)
+{
+  SettingsManager s;
+  s.begin();
+  Flash::counts = Flash::Counts{};
+
+  const uint32_t rev0 = s.revision();
+
+  // 100 sessions, each started with the sampling parameters it already has.
+  char patch[96];
+  for (int i = 0; i < 100; i++) {
+    snprintf(patch, sizeof(patch), "{\"samplingInterval\":%lu,\"aggPeriodS\":%lu}",
+             (unsigned long)s.getCopy().sample_period_ms, (unsigned long)s.getCopy().agg_period_s);
+    TEST_ASSERT_TRUE(s.applyJson(patch, true));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.programs);
+  TEST_ASSERT_EQUAL_UINT32(rev0, s.revision());
+
+  // /cfg echoing current values, unknown keys and an explicit save(): no write.
+  TEST_ASSERT_TRUE(s.applyCfgMessage("{\"mqttHost\":\"mqtt.vamotech.no\",\"mqttPort\":1883}", true).ok);
+  TEST_ASSERT_TRUE(s.applyCfgMessage("{\"aggregationMethod\":\"avg\"}", true).ok);
+  TEST_ASSERT_TRUE(s.save());
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.programs);
+  TEST_ASSERT_EQUAL_UINT32(rev0, s.revision());
+
+  // A rejected patch changes nothing.
+  TEST_ASSERT_FALSE(s.applyJson("{\"mqttPort\":\"x\"}", true));
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.programs);
+
+  // A real change: one record, one revision.
+  TEST_ASSERT_TRUE(s.applyJson("{\"aggPeriodS\":60}", true));
+  TEST_ASSERT_EQUAL_UINT32(1u, writes());
+  TEST_ASSERT_EQUAL_UINT32(rev0 + 1u, s.revision());
+
+  // Runtime-only change, then the same value persisted: one more write.
+  TEST_ASSERT_TRUE(s.applyJson("{\"statusIntervalS\":300}", false));
+  TEST_ASSERT_EQUAL_UINT32(1u, writes());
+  TEST_ASSERT_TRUE(s.save());
+  TEST_ASSERT_EQUAL_UINT32(2u, writes());
+
+  // Transaction over three messages: one write at commit.
+  TEST_ASSERT_TRUE(s.applyCfgMessage("{\"txn\":\"begin\",\"apn\":\"internet\"}", true).ok);
+  TEST_ASSERT_TRUE(s.applyCfgMessage("{\"apnUser\":\"u\"}", true).ok);
+  TEST_ASSERT_EQUAL_UINT32(2u, writes());
+  const SettingsManager::CfgResult r = s.applyCfgMessage("{\"txn\":\"commit\",\"apnPass\":\"p\"}", true);
+  TEST_ASSERT_TRUE(r.committed);
+  TEST_ASSERT_EQUAL_UINT32(3u, writes());
+  TEST_ASSERT_EQUAL_UINT32(rev0 + 3u, s.revision());
+
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.erases);
+}
+
+void test_erase_only_when_sector_fills(void)
+{
+  SettingsManager s;
+  s.begin();  // record 1
+
+  const uint32_t perSector = Flash::kSectorSize / recordStride();
+  char           patch[48];
+  for (uint32_t i = 1; i < perSector; i++) {
+    snprintf(patch, sizeof(patch), "{\"statusIntervalS\":%lu}", (unsigned long)(1000u + i));
+    TEST_ASSERT_TRUE(s.applyJson(patch, true));
+    // Unchanged repeat in between, as the orchestrator sends them.
+    TEST_ASSERT_TRUE(s.applyJson(patch, true));
+  }
+  TEST_ASSERT_EQUAL_UINT32(perSector, writes());
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.erases);
+
+  TEST_ASSERT_TRUE(s.applyJson("{\"statusIntervalS\":999}", true));
+  TEST_ASSERT_EQUAL_UINT32(1u, Flash::counts.erases);
+
+  // The newest value survives a reboot.
+  SettingsManager again;
+  again.begin();
+  TEST_ASSERT_EQUAL_UINT32(999u, again.getCopy().status_interval_s);
+}
+
+void test_session_override_never_persisted(void)
+{
+  SettingsManager s;
+  s.begin();
+  Flash::counts = Flash::Counts{};
+
+  const AppSettings stored = s.getCopy();
+  const uint32_t    digest = s.configDigest();
+
+  s.setSessionOverride(5000u, 120u);
+  TEST_ASSERT_EQUAL_UINT32(5000u, s.getCopy().sample_period_ms);
+  TEST_ASSERT_EQUAL_UINT32(120u, s.getCopy().agg_period_s);
+  TEST_ASSERT_EQUAL_UINT32(digest, s.configDigest());
+
+  // Anything saved during the session writes the stored values only.
+  TEST_ASSERT_TRUE(s.save());
+  TEST_ASSERT_EQUAL_UINT32(0u, Flash::counts.programs);
+  TEST_ASSERT_TRUE(s.applyJson("{\"statusIntervalS\":600}", true));
+  TEST_ASSERT_EQUAL_UINT32(1u, writes());
+
+  s.setSessionOverride(0u, 0u);
+  TEST_ASSERT_EQUAL_UINT32(stored.sample_period_ms, s.getCopy().sample_period_ms);
+
+  SettingsManager again;
+  again.begin();
+  TEST_ASSERT_EQUAL_UINT32(stored.sample_period_ms, again.getCopy().sample_period_ms);
+  TEST_ASSERT_EQUAL_UINT32(stored.agg_period_s, again.getCopy().agg_period_s);
+  TEST_ASSERT_EQUAL_UINT32(600u, again.getCopy().status_interval_s);
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_first_boot_writes_defaults_once);
+  RUN_TEST(test_session_trace_costs_one_write_per_real_change);
+  RUN_TEST(test_erase_only_when_sector_fills);
+  RUN_TEST(test_session_override_never_persisted);
+  return UNITY_END();
+}
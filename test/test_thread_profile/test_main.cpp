@@ -0,0 +1,150 @@
+#include <unity.h>
+
+#include "ThreadProfile.h"
+
+// Host test: running()/waiting()/roll() driven with hand-picked timestamps.
+// Checks the busy share per window (including a span still open at roll and
+// a window that wraps the microsecond clock), the peak and total, and the
+// stack watermark with and without a reading.
+
+namespace {
+
+static constexpr uint32_t kMsUs = 1000u;
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_busy_share_per_window(void)
+{
+  ThreadProfile p;
+  p.running(0u);
+  p.waiting(100u * kMsUs);
+  p.running(400u * kMsUs);
+  p.waiting(500u * kMsUs);
+  p.roll(1000u * kMsUs, 1000u);
+
+  TEST_ASSERT_EQUAL_UINT16(200u, p.cpuPermille());
+  TEST_ASSERT_EQUAL_UINT16(200u, p.peakCpuPermille());
+  TEST_ASSERT_EQUAL_UINT32(200u, p.busyMs());
+}
+
+void test_repeated_calls_are_ignored(void)
+{
+  ThreadProfile p;
+  p.waiting(50u * kMsUs);  // not running yet
+  p.running(100u * kMsUs);
+  p.running(300u * kMsUs); // already running: keeps the first start
+  p.waiting(400u * kMsUs);
+  p.waiting(900u * kMsUs); // already waiting
+  p.roll(1000u * kMsUs, 1000u);
+
+  TEST_ASSERT_EQUAL_UINT16(300u, p.cpuPermille());
+}
+
+void test_open_span_splits_at_roll(void)
+{
+  ThreadProfile p;
+  p.running(800u * kMsUs);
+  p.roll(1000u * kMsUs, 1000u);
+  TEST_ASSERT_EQUAL_UINT16(200u, p.cpuPermille());
+
+  // Still running: the next window counts from the roll, not from 800 ms.
+  p.waiting(1500u * kMsUs);
+  p.roll(2000u * kMsUs, 1000u);
+  TEST_ASSERT_EQUAL_UINT16(500u, p.cpuPermille());
+  TEST_ASSERT_EQUAL_UINT16(500u, p.peakCpuPermille());
+  TEST_ASSERT_EQUAL_UINT32(700u, p.busyMs());
+}
+
+void test_window_rollover_keeps_peak(void)
+{
+  ThreadProfile p;
+  p.running(0u);
+  p.waiting(900u * kMsUs);
+  p.roll(1000u * kMsUs, 1000u);
+  TEST_ASSERT_EQUAL_UINT16(900u, p.cpuPermille());
+
+  // An idle window resets the share but not the peak or the total.
+  p.roll(2000u * kMsUs, 1000u);
+  TEST_ASSERT_EQUAL_UINT16(0u, p.cpuPermille());
+  TEST_ASSERT_EQUAL_UINT16(900u, p.peakCpuPermille());
+  TEST_ASSERT_EQUAL_UINT32(900u, p.busyMs());
+}
+
+void test_microsecond_clock_wrap(void)
+{
+  ThreadProfile p;
+  const uint32_t start = 0xFFFFFFFFu - 100u * kMsUs + 1u;
+  p.running(start);
+  p.waiting(start + 250u * kMsUs); // wraps past zero
+  p.roll(start + 1000u * kMsUs, 1000u);
+
+  TEST_ASSERT_EQUAL_UINT16(250u, p.cpuPermille());
+}
+
+void test_share_is_capped_and_zero_window_ignored(void)
+{
+  ThreadProfile p;
+  p.running(0u);
+  p.waiting(3000u * kMsUs);
+  p.roll(3000u * kMsUs, 1000u); // window shorter than the busy time
+  TEST_ASSERT_EQUAL_UINT16(1000u, p.cpuPermille());
+
+  p.running(3000u * kMsUs);
+  p.waiting(3100u * kMsUs);
+  p.roll(3100u * kMsUs, 0u);    // no share, busy time still counted
+  TEST_ASSERT_EQUAL_UINT16(1000u, p.cpuPermille());
+  TEST_ASSERT_EQUAL_UINT32(3100u, p.busyMs());
+}
+
+void test_stack_peak_is_lowest_free(void)
+{
+  ThreadProfile p;
+  TEST_ASSERT_EQUAL_UINT32(0u, p.stackPeak());
+
+  p.stack(4096u, 3000u);
+  TEST_ASSERT_EQUAL_UINT32(4096u, p.stackSize());
+  TEST_ASSERT_EQUAL_UINT32(1096u, p.stackPeak());
+
+  p.stack(4096u, 2000u);
+  TEST_ASSERT_EQUAL_UINT32(2096u, p.stackPeak());
+
+  // A later, higher reading does not lower the peak.
+  p.stack(4096u, 3500u);
+  TEST_ASSERT_EQUAL_UINT32(2096u, p.stackPeak());
+}
+
+void test_stack_without_watermark(void)
+{
+  ThreadProfile p;
+
+  // freeBytes == 0 means the kernel has no watermark: size only, no peak.
+  p.stack(2048u, 0u);
+  TEST_ASSERT_EQUAL_UINT32(2048u, p.stackSize());
+  TEST_ASSERT_EQUAL_UINT32(0u, p.stackPeak());
+
+  // An impossible reading (more free than the stack) is ignored too.
+  p.stack(2048u, 4096u);
+  TEST_ASSERT_EQUAL_UINT32(0u, p.stackPeak());
+
+  // A zero reading after a real one keeps the real one.
+  p.stack(2048u, 1024u);
+  p.stack(2048u, 0u);
+  TEST_ASSERT_EQUAL_UINT32(1024u, p.stackPeak());
+}
+
+int main(int, char**)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_busy_share_per_window);
+  RUN_TEST(test_repeated_calls_are_ignored);
+  RUN_TEST(test_open_span_splits_at_roll);
+  RUN_TEST(test_window_rollover_keeps_peak);
+  RUN_TEST(test_microsecond_clock_wrap);
+  RUN_TEST(test_share_is_capped_and_zero_window_ignored);
+  RUN_TEST(test_stack_peak_is_lowest_free);
+  RUN_TEST(test_stack_without_watermark);
+  return UNITY_END();
+}
@@ -16,8 +16,10 @@ import json
 import math
 import os
 import signal
+import struct
 import sys
 import time
+import zlib
 from dataclasses import dataclass
 from typing import Any, Dict, Optional
 
@@ -29,8 +31,16 @@ except ImportError:
 
 
 MIN_SAMPLE_PERIOD_MS = 200
+CFG_TXN_TIMEOUT_MS = 60000
 MAX_CONFIG_PAYLOAD_BYTES = 320
 CONFIG_CHUNK_TOTAL = 5
+METRICS_PUBLISH_INTERVAL_S = 900
+
+# Firmware metrics::Counter order.
+METRIC_SAMPLES = 0
+METRIC_AGGREGATES = 2
+METRIC_PUBLISHES = 3
+METRIC_MQTT_CONNECTS = 5
 
 MODE_AWARE = "aware"
 MODE_SAMPLING = "sampling"
@@ -92,7 +102,7 @@ def mask_if_set(text: str) -> str:
 
 @dataclass
 class AppSettings:
-    version: int = 1
+    version: int = 4
 
     sensor_addr: int = 1
     sensor_baud: int = 9600
@@ -127,24 +137,96 @@ class AppSettings:
     max_forced_sleep_s: int = 43200
     max_unacked_packets: int = 10
 
-    def clamp_runtime(self) -> None:
-        if self.sample_period_ms < MIN_SAMPLE_PERIOD_MS:
-            self.sample_period_ms = MIN_SAMPLE_PERIOD_MS
+    sched_interval_s: int = 0
+    sched_duration_s: int = 0
+    sched_sample_period_ms: int = 0
+    sched_agg_period_s: int = 0
 
-        if self.aware_timeout_s < 60:
-            self.aware_timeout_s = 600
-        if self.default_sleep_s < 60:
-            self.default_sleep_s = 3600
-        if self.status_interval_s < 30:
-            self.status_interval_s = 120
+    log_levels: str = "info"
 
-        if self.sensor_addr <= 0 or self.sensor_addr > 247:
-            self.sensor_addr = 1
+    low_power_idle: int = 1
 
-        if self.max_forced_sleep_s <= 0 or self.max_forced_sleep_s > 43200:
-            self.max_forced_sleep_s = 43200
-        if self.emergency_sleep_s <= 0 or self.emergency_sleep_s > 43200:
-            self.emergency_sleep_s = 43200
+    def clamp_runtime(self) -> None:
+        for f in SETTINGS_SCHEMA:
+            if f.type in ("u8", "u16", "u32"):
+                v = getattr(self, f.attr)
+                if v < f.min_value or v > f.max_value:
+                    setattr(self, f.attr, f.fallback)
+
+
+@dataclass(frozen=True)
+class SettingsField:
+    """Mirror of one row of the firmware schema (src/SettingsSchema.cpp)."""
+
+    key: str
+    attr: str
+    type: str  # "u8" | "u16" | "u32" | "f32" | "str"
+    section: str
+    secret: bool = False
+    max_len: int = 0  # str: capacity without NUL
+    min_value: int = 0
+    max_value: int = 0xFFFFFFFF
+    fallback: int = 0
+
+
+MAX_SLEEP_DURATION_S = 43200
+
+# Same rows and order as the firmware table.
+SETTINGS_SCHEMA = (
+    SettingsField("apn", "apn", "str", "network", max_len=63),
+    SettingsField("simPin", "sim_pin", "str", "network", secret=True, max_len=15),
+    SettingsField("apnUser", "apn_user", "str", "network", secret=True, max_len=31),
+    SettingsField("apnPass", "apn_pass", "str", "network", secret=True, max_len=31),
+    SettingsField("mqttHost", "mqtt_host", "str", "mqtt", max_len=63),
+    SettingsField("mqttPort", "mqtt_port", "u16", "mqtt"),
+    SettingsField("mqttClientId", "mqtt_client_id", "str", "mqtt", max_len=47),
+    SettingsField("mqttUser", "mqtt_user", "str", "mqtt", secret=True, max_len=31),
+    SettingsField("mqttPass", "mqtt_pass", "str", "mqtt", secret=True, max_len=31),
+    SettingsField("deviceName", "device_name", "str", "device", max_len=47),
+    SettingsField("sensorAddress", "sensor_addr", "u8", "device", min_value=1, max_value=247, fallback=1),
+    SettingsField("sensorBaudrate", "sensor_baud", "u32", "device"),
+    SettingsField("sensorWarmupMs", "sensor_warmup_ms", "u32", "device"),
+    SettingsField("sensorType", "sensor_type", "u32", "device"),
+    SettingsField("logLevels", "log_levels", "str", "device", max_len=47),
+    SettingsField("samplingInterval", "sample_period_ms", "u32", "schedule",
+                  min_value=MIN_SAMPLE_PERIOD_MS, fallback=MIN_SAMPLE_PERIOD_MS),
+    SettingsField("aggPeriodS", "agg_period_s", "u32", "schedule"),
+    SettingsField("awareTimeoutS", "aware_timeout_s", "u32", "schedule", min_value=60, fallback=600),
+    SettingsField("defaultSleepS", "default_sleep_s", "u32", "schedule", min_value=60, fallback=3600),
+    SettingsField("statusIntervalS", "status_interval_s", "u32", "schedule", min_value=30, fallback=120),
+    SettingsField("schedIntervalS", "sched_interval_s", "u32", "schedule", max_value=MAX_SLEEP_DURATION_S),
+    SettingsField("schedDurationS", "sched_duration_s", "u32", "schedule", max_value=MAX_SLEEP_DURATION_S),
+    SettingsField("schedSamplingInterval", "sched_sample_period_ms", "u32", "schedule"),
+    SettingsField("schedAggPeriodS", "sched_agg_period_s", "u32", "schedule"),
+    SettingsField("lowBattMinV", "low_batt_min_v", "f32", "power"),
+    SettingsField("maxChargingCurrent", "max_charging_current", "u16", "power"),
+    SettingsField("maxChargingVoltage", "max_charging_voltage", "f32", "power"),
+    SettingsField("emergencyDelayS", "emergency_delay_s", "u32", "power"),
+    SettingsField("emergencySleepS", "emergency_sleep_s", "u32", "power",
+                  min_value=1, max_value=MAX_SLEEP_DURATION_S, fallback=MAX_SLEEP_DURATION_S),
+    SettingsField("maxForcedSleepS", "max_forced_sleep_s", "u32", "power",
+                  min_value=1, max_value=MAX_SLEEP_DURATION_S, fallback=MAX_SLEEP_DURATION_S),
+    SettingsField("maxUnackedPackets", "max_unacked_packets", "u32", "power"),
+    SettingsField("lowPowerIdle", "low_power_idle", "u8", "power", max_value=1, fallback=1),
+)
+
+SETTINGS_BY_KEY = {f.key: f for f in SETTINGS_SCHEMA}
+SETTINGS_SCHEMA_VERSION = 4
+
+
+def config_digest(s: "AppSettings") -> int:
+    """CRC32 over masked values in schema order, identical to settingsschema::digest."""
+    crc = 0
+    for f in SETTINGS_SCHEMA:
+        value = getattr(s, f.attr)
+        if f.type == "str":
+            text = mask_if_set(value) if f.secret else value
+            crc = zlib.crc32(text.encode("utf-8") + b"\0", crc)
+        elif f.type == "f32":
+            crc = zlib.crc32(struct.pack("<f", float(value)), crc)
+        else:
+            crc = zlib.crc32(struct.pack("<I", int(value) & 0xFFFFFFFF), crc)
+    return crc & 0xFFFFFFFF
 
 
 def json_len_compact(doc: Dict[str, Any]) -> int:
@@ -183,6 +265,7 @@ class VirtualNode:
         self.topic_cfg = f"{topic_prefix}/{self.device_id}/cfg"
         self.topic_data = f"{topic_prefix}/{self.device_id}/data"
         self.topic_status = f"{topic_prefix}/{self.device_id}/status"
+        self.topic_metrics = f"{topic_prefix}/{self.device_id}/metrics"
 
         self._publish_fn = publish_fn
         self._verbose = verbose
@@ -190,6 +273,8 @@ class VirtualNode:
         self.settings = AppSettings()
         self.settings.device_name = ""
         self.settings.clamp_runtime()
+        self.cfg_txn: Optional[Dict[str, Any]] = None
+        self.cfg_txn_start_ms = 0
 
         self.cond_amplitude = max(0.0, cond_amplitude)
         self.cond_period_ms = max(1.0, cond_period_min * 60.0 * 1000.0)
@@ -197,6 +282,7 @@ class VirtualNode:
 
         self.boot_ms = now_ms()
         self.session_start_ms = self.boot_ms
+        self.boot_timeline_sent = False
         self.server_session_id: Optional[str] = None
 
         self.state = MODE_AWARE
@@ -226,6 +312,13 @@ class VirtualNode:
         self.battery_current = 0.0
         self.average_current = 0.0
 
+        # Energy ledger (firmware EnergyLedger): aware, sampling, hibernating, attach, publish, warmup.
+        self.energy_uah = [0, 0, 0, 0, 0, 0]
+        self.energy_tracked_ms = 0
+        self.remaining_mah = 2000.0
+
+        self.reset_metrics(self.boot_ms)
+
     def log(self, msg: str) -> None:
         if self._verbose:
             print(f"[{self.device_id}] {msg}")
@@ -237,6 +330,31 @@ class VirtualNode:
 
     def publish_json(self, topic: str, payload: Dict[str, Any]) -> None:
         self._publish_fn(topic, payload)
+        self.metric_counters[METRIC_PUBLISHES] += 1
+
+    def reset_metrics(self, wall_ms: int) -> None:
+        """Firmware metrics count from boot; standby restarts them."""
+        # samples, sampleErrors, aggregates, publishes, publishFails, mqttConnects, flashWrites, flashErases
+        self.metric_counters = [0] * 8
+        self.metric_counters[METRIC_MQTT_CONNECTS] = 1
+        self.last_metrics_ms = wall_ms
+
+    def publish_metrics(self, wall_ms: int) -> None:
+        payload = {
+            "type": "metrics",
+            "tsMs": self.rel_ms(wall_ms),
+            "c": list(self.metric_counters),
+            "qHw": [0] * 5,
+            "qFull": [0] * 5,
+            "pubMs": [self.metric_counters[METRIC_PUBLISHES], 0, 0, 0, 0, 0, 0, 0],
+            "pubMsMax": 1 if self.metric_counters[METRIC_PUBLISHES] else 0,
+            "logDrop": 0,
+            # main, Orch, SENS, AGG, UI (firmware ThreadProfiler)
+            "stk": [0] * 5,
+            "cpu": [0] * 5,
+        }
+        self.publish_json(self.topic_metrics, payload)
+        self.last_metrics_ms = wall_ms
 
     def publish_status(self, mode: str, extra: Optional[Dict[str, Any]] = None) -> None:
         doc: Dict[str, Any] = {
@@ -279,7 +397,13 @@ class VirtualNode:
         self.publish_status(MODE_HIBERNATING, extra)
 
     def publish_awake(self) -> None:
-        self.publish_status(MODE_AWARE, None)
+        extra: Dict[str, Any] = {"configDigest": config_digest(self.settings)}
+        if not self.boot_timeline_sent:
+            # Device sends kernel-uptime stage marks once; the simulator only has these two.
+            extra["bootMs"] = {"setup": 0, "mqtt": int(now_ms() - self.boot_ms)}
+            extra["restartReason"] = "powerOn"
+            self.boot_timeline_sent = True
+        self.publish_status(MODE_AWARE, extra)
 
     def enter_state(
         self,
@@ -290,6 +414,9 @@ class VirtualNode:
         previous = self.state
         changed = previous != new_state
 
+        if previous == MODE_SAMPLING and new_state != MODE_SAMPLING:
+            self.flush_partial_aggregate()
+
         self.state = new_state
         self.last_activity_ms = now_ms()
 
@@ -318,6 +445,7 @@ class VirtualNode:
             expected_duration_s = int(self.settings.default_sleep_s)
 
         self.hibernate_until_ms = now_ms() + int(expected_duration_s * 1000)
+        self.publish_metrics(now_ms())
         if changed:
             self.publish_hibernate_mode_change(previous, hibernate_reason, expected_duration_s)
         else:
@@ -378,7 +506,14 @@ class VirtualNode:
         self.agg_ok = self.agg_ok and bool(sample.get("ok", False))
         self.agg_n += 1
 
-    def emit_aggregate_payload(self) -> Optional[Dict[str, Any]]:
+    def flush_partial_aggregate(self) -> None:
+        """Leaving sampling mid-window: publish what was collected, marked partial."""
+        payload = self.emit_aggregate_payload(partial=True)
+        if payload is not None:
+            self.publish_json(self.topic_data, payload)
+        self.reset_aggregate_window(now_ms())
+
+    def emit_aggregate_payload(self, partial: bool = False) -> Optional[Dict[str, Any]]:
         if self.agg_n <= 0:
             return None
 
@@ -390,6 +525,8 @@ class VirtualNode:
             "n": int(self.agg_n),
             "ok": 1 if self.agg_ok else 0,
         }
+        if partial:
+            payload["partial"] = 1
         if self.server_session_id:
             payload["sessionID"] = self.server_session_id
 
@@ -430,7 +567,13 @@ class VirtualNode:
         if not due:
             return
 
+        elapsed_ms = 0 if self.last_status_ms == 0 else wall_ms - self.last_status_ms
         self.update_fake_battery()
+        # Fake currents are in A; the ledger is in µAh.
+        used_uah = int(self.average_current * 1e6 * elapsed_ms / 3.6e6)
+        self.energy_uah[1 if self.state == MODE_SAMPLING else 0] += used_uah
+        self.energy_tracked_ms += elapsed_ms
+        self.remaining_mah = max(0.0, self.remaining_mah - used_uah / 1000.0)
         payload = {
             "type": "status",
             "mode": self.state,
@@ -439,7 +582,13 @@ class VirtualNode:
             "minimumVoltage": round(self.minimum_voltage, 3),
             "batteryCurrent": round(self.battery_current, 3),
             "averageCurrent": round(self.average_current, 3),
+            "energyUah": list(self.energy_uah),
+            "idleStop": bool(self.settings.low_power_idle),
         }
+        total_uah = self.energy_uah[0] + self.energy_uah[1] + self.energy_uah[2]
+        if self.energy_tracked_ms >= 3600 * 1000 and total_uah > 0:
+            avg_ua = total_uah * 3600.0 / (self.energy_tracked_ms / 1000.0)
+            payload["daysToEmpty"] = int(self.remaining_mah * 1000.0 / avg_ua / 24.0)
         self.publish_json(self.topic_status, payload)
         self.last_status_ms = wall_ms
 
@@ -459,82 +608,21 @@ class VirtualNode:
     def apply_cfg_patch(self, doc: Dict[str, Any]) -> None:
         s = self.settings
 
-        v = parse_u32(doc.get("sensorAddress"))
-        if v is not None:
-            s.sensor_addr = int(v)
-        v = parse_u32(doc.get("sensorBaudrate"))
-        if v is not None:
-            s.sensor_baud = int(v)
-        v = parse_u32(doc.get("sensorWarmupMs"))
-        if v is not None:
-            s.sensor_warmup_ms = int(v)
-        v = parse_u32(doc.get("sensorType"))
-        if v is not None:
-            s.sensor_type = int(v)
-
-        v = parse_u32(doc.get("samplingInterval"))
-        if v is not None:
-            s.sample_period_ms = int(v)
-        v = parse_u32(doc.get("aggPeriodS"))
-        if v is not None:
-            s.agg_period_s = int(v)
-
-        if isinstance(doc.get("simPin"), str):
-            s.sim_pin = doc["simPin"][:15]
-        if isinstance(doc.get("apn"), str):
-            s.apn = doc["apn"][:63]
-        if isinstance(doc.get("apnUser"), str):
-            s.apn_user = doc["apnUser"][:31]
-        if isinstance(doc.get("apnPass"), str):
-            s.apn_pass = doc["apnPass"][:31]
-
-        if isinstance(doc.get("mqttHost"), str):
-            s.mqtt_host = doc["mqttHost"][:63]
-        v = parse_u32(doc.get("mqttPort"))
-        if v is not None:
-            s.mqtt_port = int(v)
-        if isinstance(doc.get("mqttUser"), str):
-            s.mqtt_user = doc["mqttUser"][:31]
-        if isinstance(doc.get("mqttPass"), str):
-            s.mqtt_pass = doc["mqttPass"][:31]
-        if isinstance(doc.get("mqttClientId"), str):
-            s.mqtt_client_id = doc["mqttClientId"][:47]
-
-        if isinstance(doc.get("deviceName"), str):
-            s.device_name = doc["deviceName"][:47]
-
-        v = parse_u32(doc.get("awareTimeoutS"))
-        if v is not None:
-            s.aware_timeout_s = int(v)
-        v = parse_u32(doc.get("defaultSleepS"))
-        if v is not None:
-            s.default_sleep_s = int(v)
-        v = parse_u32(doc.get("statusIntervalS"))
-        if v is not None:
-            s.status_interval_s = int(v)
-
-        fv = parse_f32(doc.get("lowBattMinV"))
-        if fv is not None:
-            s.low_batt_min_v = float(fv)
-        v = parse_u32(doc.get("maxChargingCurrent"))
-        if v is not None:
-            s.max_charging_current = int(v)
-        fv = parse_f32(doc.get("maxChargingVoltage"))
-        if fv is not None:
-            s.max_charging_voltage = float(fv)
-
-        v = parse_u32(doc.get("emergencyDelayS"))
-        if v is not None:
-            s.emergency_delay_s = int(v)
-        v = parse_u32(doc.get("emergencySleepS"))
-        if v is not None:
-            s.emergency_sleep_s = int(v)
-        v = parse_u32(doc.get("maxForcedSleepS"))
-        if v is not None:
-            s.max_forced_sleep_s = int(v)
-        v = parse_u32(doc.get("maxUnackedPackets"))
-        if v is not None:
-            s.max_unacked_packets = int(v)
+        for key, value in doc.items():
+            f = SETTINGS_BY_KEY.get(key)
+            if f is None:
+                continue
+            if f.type == "str":
+                if isinstance(value, str):
+                    setattr(s, f.attr, value[: f.max_len])
+            elif f.type == "f32":
+                fv = parse_f32(value)
+                if fv is not None:
+                    setattr(s, f.attr, float(fv))
+            else:
+                v = parse_u32(value)
+                if v is not None:
+                    setattr(s, f.attr, int(v))
 
         s.clamp_runtime()
 
@@ -542,50 +630,37 @@ class VirtualNode:
         s = self.settings
         doc: Dict[str, Any] = {}
 
-        include_all = section == "all"
-
-        if include_all or section == "network":
-            doc["apn"] = s.apn
-            doc["simPin"] = mask_if_set(s.sim_pin)
-            doc["apnUser"] = mask_if_set(s.apn_user)
-            doc["apnPass"] = mask_if_set(s.apn_pass)
-
-        if include_all or section == "mqtt":
-            doc["mqttHost"] = s.mqtt_host
-            doc["mqttPort"] = s.mqtt_port
-            doc["mqttClientId"] = s.mqtt_client_id
-            doc["mqttUser"] = mask_if_set(s.mqtt_user)
-            doc["mqttPass"] = mask_if_set(s.mqtt_pass)
-
-        if include_all or section == "device":
-            doc["deviceName"] = s.device_name
-            doc["sensorAddress"] = s.sensor_addr
-            doc["sensorBaudrate"] = s.sensor_baud
-            doc["sensorWarmupMs"] = s.sensor_warmup_ms
-            doc["sensorType"] = s.sensor_type
-
-        if include_all or section == "schedule":
-            doc["samplingInterval"] = s.sample_period_ms
-            doc["aggPeriodS"] = s.agg_period_s
-            doc["awareTimeoutS"] = s.aware_timeout_s
-            doc["defaultSleepS"] = s.default_sleep_s
-            doc["statusIntervalS"] = s.status_interval_s
-
-        if include_all or section == "power":
-            doc["lowBattMinV"] = s.low_batt_min_v
-            doc["maxChargingCurrent"] = s.max_charging_current
-            doc["maxChargingVoltage"] = s.max_charging_voltage
-            doc["emergencyDelayS"] = s.emergency_delay_s
-            doc["emergencySleepS"] = s.emergency_sleep_s
-            doc["maxForcedSleepS"] = s.max_forced_sleep_s
-            doc["maxUnackedPackets"] = s.max_unacked_packets
+        for f in SETTINGS_SCHEMA:
+            if section != "all" and f.section != section:
+                continue
+            value = getattr(s, f.attr)
+            doc[f.key] = mask_if_set(value) if f.secret else value
 
         return doc
 
-    def publish_config_snapshot(self) -> None:
+    def publish_config_digest(self, digest: int, unchanged: bool) -> None:
+        self.publish_json(
+            self.topic_status,
+            {
+                "type": "configDigest",
+                "tsMs": self.rel_ms(),
+                "schema": SETTINGS_SCHEMA_VERSION,
+                "digest": digest,
+                "unchanged": unchanged,
+            },
+        )
+
+    def publish_config_snapshot(self, known_digest: Optional[int] = None) -> None:
+        # "format":"msgpack" is answered with JSON here; the simulator only publishes JSON.
+        digest = config_digest(self.settings)
+        if known_digest is not None and known_digest == digest:
+            self.publish_config_digest(digest, True)
+            return
+
         full_doc = {
             "type": "config",
             "tsMs": self.rel_ms(),
+            "digest": digest,
         }
         full_doc.update(self.add_masked_config_fields("all"))
 
@@ -610,6 +685,7 @@ class VirtualNode:
             }
             doc.update(self.add_masked_config_fields(section))
             self.publish_json(self.topic_status, doc)
+        self.publish_config_digest(digest, False)
 
     def handle_cmd_payload(self, payload_text: str) -> None:
         try:
@@ -658,7 +734,7 @@ class VirtualNode:
             return
 
         if cmd_type == "getConfig":
-            self.publish_config_snapshot()
+            self.publish_config_snapshot(parse_u32(doc.get("digest")))
             return
 
         if cmd_type == "hibernate":
@@ -691,15 +767,36 @@ class VirtualNode:
         if not isinstance(doc, dict):
             return
 
+        # Staged transactions: {"txn":"begin"} ... {"txn":"commit"} | {"txn":"rollback"}
+        txn = doc.pop("txn", None)
+        if self.cfg_txn is not None and (now_ms() - self.cfg_txn_start_ms) > CFG_TXN_TIMEOUT_MS:
+            self.log("cfg transaction timed out")
+            self.cfg_txn = None
+        if txn == "rollback":
+            self.cfg_txn = None
+            return
+        if txn == "begin" and self.cfg_txn is None:
+            self.cfg_txn = {}
+            self.cfg_txn_start_ms = now_ms()
+        if self.cfg_txn is not None:
+            self.cfg_txn.update(doc)
+            if txn == "commit":
+                staged, self.cfg_txn = self.cfg_txn, None
+                self.apply_cfg_patch(staged)
+            return
+
         self.apply_cfg_patch(doc)
 
     def tick(self, wall_ms: int) -> None:
         if self.state == MODE_HIBERNATING:
             if wall_ms >= self.hibernate_until_ms:
+                self.reset_metrics(wall_ms)
                 self.enter_state(MODE_AWARE)
             return
 
         self.publish_periodic_status_if_due(wall_ms)
+        if (wall_ms - self.last_metrics_ms) >= METRICS_PUBLISH_INTERVAL_S * 1000:
+            self.publish_metrics(wall_ms)
 
         if (wall_ms - self.last_activity_ms) > (self.settings.aware_timeout_s * 1000):
             self.enter_state(MODE_HIBERNATING, "inactivity", self.settings.default_sleep_s)
@@ -712,6 +809,7 @@ class VirtualNode:
         while wall_ms >= self.next_sample_ms:
             sample = self.fake_sensor_sample(self.next_sample_ms)
             self.add_sample(sample)
+            self.metric_counters[METRIC_SAMPLES] += 1
             self.next_sample_ms += sample_period_ms
 
         agg_window_ms = int(self.settings.agg_period_s * 1000)
@@ -719,6 +817,7 @@ class VirtualNode:
             aggregate_payload = self.emit_aggregate_payload()
             if aggregate_payload is not None:
                 self.publish_json(self.topic_data, aggregate_payload)
+                self.metric_counters[METRIC_AGGREGATES] += 1
                 self.last_activity_ms = wall_ms
                 self.unacked_aggregate_count += 1
 